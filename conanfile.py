@@ -5,6 +5,8 @@ from conan.tools.cmake import cmake_layout
 class Recipe(ConanFile):
     settings = ["os", "compiler", "build_type", "arch"]
     generators = ["CMakeToolchain", "CMakeDeps"]
+    options = {"zstd": [True, False]}
+    default_options = {"zstd": True}
     requires = [
         "fmt/11.1.3",
         "spdlog/1.15.1",
@@ -14,5 +16,9 @@ class Recipe(ConanFile):
         "cli11/2.4.1",
     ]
 
+    def requirements(self):
+        if self.options.zstd:
+            self.requires("zstd/1.5.7")
+
     def layout(self):
         cmake_layout(self)
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+#include "qoiview/pipeline.hpp"
+
+#include <qoipp/common.hpp>
+#include <qoipp/stream.hpp>
+
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// files stored in uncompressed tar archives, read in place without extracting them
+// a member is named like a file in a directory, `shots.tar/frames/0001.qoi`, and is accepted by `open` and
+// `read_header`
+namespace qoiview::archive
+{
+    // a regular file in an archive, its data is `size` bytes starting `offset` bytes into the archive
+    struct Member
+    {
+        std::string   name;    // as stored, with '/' separators
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::int64_t  time;    // modification time in seconds since the epoch
+    };
+
+    // a file or a member, positioned at its first byte
+    struct Stream
+    {
+        std::ifstream  handle;
+        std::uintmax_t size;
+        bool           member;    // reading past `size` runs into the next member
+    };
+
+    // a file or a member opened for decoding, `reader` pulls the data following the header, decompressed
+    struct Input
+    {
+        std::optional<Stream> stream;
+        pipeline::Reader      reader;
+        qoipp::StreamDecoder  decoder;
+        qoipp::Desc           desc;
+    };
+
+    struct Status
+    {
+        std::uintmax_t     size;
+        fs::file_time_type time;
+    };
+
+    // a regular file named *.tar
+    bool is_archive(const fs::path& path);
+
+    // regular files of an archive in stored order; the index of its headers is cached in $XDG_CACHE_HOME/qoiview
+    // and rebuilt once the archive's size or time changes, throws std::runtime_error if it's unreadable or malformed
+    std::vector<Member> members(const fs::path& archive);
+
+    // `path` if it exists, otherwise the member it names in an archive; nullopt if neither can be opened
+    std::optional<Stream> open(const fs::path& path);
+
+    // `open` with every format stage in front of the decoder, then read the header into `input.decoder`, converting
+    // to `channels` if given; filled in place, the decoder can't be moved once initialized
+    qoipp::Result<void> open_input(Input& input, const fs::path& path, std::optional<qoipp::Channels> channels = {});
+
+    // `fs::file_size` and `fs::last_write_time` that also work for members, which carry the time stored in the archive
+    std::optional<Status> status(const fs::path& path);
+
+    // `qoipp::read_header` that also works for members and zstd-compressed files
+    qoipp::Result<qoipp::Desc> read_header(const fs::path& path);
+}
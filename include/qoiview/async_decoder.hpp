@@ -1,13 +1,18 @@
 #pragma once
 
+#include "qoiview/archive.hpp"
+#include "qoiview/cache.hpp"
+#include "qoiview/channel.hpp"
 #include "qoiview/common.hpp"
+#include "qoiview/histogram.hpp"
+#include "qoiview/pipeline.hpp"
 
 #include <qoipp/stream.hpp>
 
 #include <condition_variable>
-#include <fstream>
 #include <mutex>
 #include <thread>
+#include <variant>
 
 namespace qoiview
 {
@@ -15,28 +20,50 @@ namespace qoiview
     {
     public:
         using Ord = std::memory_order;
+        using Id  = std::uint64_t;
 
         struct Task
         {
+            Id          id;
             fs::path    path;
             qoipp::Desc desc;
         };
 
-        struct Work
+        // decoding of image `Event::id` begins, its buffer is cleared
+        struct Prepared
+        {
+            qoipp::Desc                  desc;
+            std::shared_ptr<const Image> image;    // filled in by the bands that follow
+        };
+
+        // rows [start, start + count) of image `Event::id` are decoded
+        struct Band
         {
             qoipp::ByteCSpan data;
             std::size_t      start;
             std::size_t      count;
         };
 
-        struct File
+        // no more bands will be produced for image `Event::id`
+        struct Finished
+        {
+            bool truncated;
+        };
+
+        struct Failed
+        {
+            qoipp::Error error;
+        };
+
+        struct Event
         {
-            std::ifstream handle;
-            std::size_t   size;
+            Id                                              id;
+            std::variant<Prepared, Band, Finished, Failed> payload;
         };
 
         struct Preparation
         {
+            Id               id;
             qoipp::Desc      desc;
             qoipp::ByteCSpan buffer;
         };
@@ -44,41 +71,71 @@ namespace qoiview
         AsyncDecoder() = default;
         ~AsyncDecoder() { stop(); }
 
-        void launch();
+        void launch();    // again after `stop`, a no-op while running
 
         qoipp::Result<Preparation> prepare(fs::path path);
-        std::optional<Work>        get();
+        std::optional<Event>       poll();
 
         void start();
         void stop();
 
+        // stop the current task without preparing another and let go of its pixels
+        void cancel();
+
         std::optional<Task> current() const { return m_task; }
 
+        // pixels of the current task, only complete once its Finished event has been polled
+        std::shared_ptr<const Image> image() const { return m_cached ? m_cached : m_image; }
+
+        // per-channel counts of the current task, same completeness rules as `image()`
+        const Histogram& histogram() const { return m_histogram; }
+
+        // decoded images are looked up in and stored to the cache, must outlive the decoder
+        void set_cache(DecodedCache* cache) { m_cache = cache; }
+
+        // files still being written are waited on to grow until all their pixels are decoded, instead of being shown
+        // truncated; the decoded images aren't cached since the file keeps changing while it is decoded
+        void set_follow(bool follow) { m_follow = follow; }
+
+        // counting for the histogram is handed off to the pool instead of slowing the decode, must outlive the decoder
+        void set_pool(ThreadPool* pool) { m_pool = pool; }
+
     private:
-        using Id = int32_t;
+        static constexpr auto channel_capacity = 64uz;
+        static constexpr auto histogram_bytes  = 1uz << 20;    // counted per pool job
+        static constexpr auto read_ahead_size  = 1uz << 20;    // of a compressed file, decompressed ahead from it
 
         void run(std::stop_token token);
-        bool decode();
+        void decode(std::stop_token token);
+        void serve(const Image& image, std::stop_token token);
 
         std::jthread m_thread;
 
         std::atomic<bool> m_wake     = false;
-        std::atomic<bool> m_cancel   = false;
         std::atomic<bool> m_complete = true;
+        std::stop_source  m_cancel;
 
         std::mutex              m_mutex;
         std::condition_variable m_cv;
 
-        qoipp::StreamDecoder     m_decoder;
-        std::optional<Task>      m_task;
-        std::optional<File>      m_file;
-        std::vector<qoipp::Byte> m_buffer;
+        qoipp::StreamDecoder           m_decoder;
+        std::optional<Task>            m_task;
+        std::optional<archive::Stream> m_file;
+        pipeline::Reader               m_reader;    // of `m_file`, the header already read from it
+        bool                           m_compressed = false;
+        std::shared_ptr<Image>         m_image;
+
+        DecodedCache*                    m_cache = nullptr;
+        std::optional<DecodedCache::Key> m_key;
+        std::shared_ptr<const Image>     m_cached;
+
+        ThreadPool* m_pool = nullptr;
+        Histogram   m_histogram;
+
+        bool m_follow = false;
 
-        qoipp::ByteVec m_in_buf   = qoipp::ByteVec(16 * 1024);
-        std::size_t    m_leftover = 0;
+        SpscChannel<Event, channel_capacity> m_channel;
 
-        std::atomic<std::size_t> m_off_out    = 0;
-        std::size_t              m_off_in     = 0;
-        std::size_t              m_line_start = 0;
+        Id m_id = 0;
     };
 }
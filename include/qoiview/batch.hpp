@@ -0,0 +1,35 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+#include "qoiview/metrics.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+
+#include <vector>
+
+namespace qoiview::batch
+{
+    // a pair of files with the same name in both directories
+    struct Frame
+    {
+        fs::path                      name;
+        qoipp::Result<metrics::Stats> result;    // MismatchedDesc if the sizes differ
+    };
+
+    struct Report
+    {
+        std::vector<Frame>    frames;    // worst first, failed pairs ahead of everything else
+        std::vector<fs::path> only_a;
+        std::vector<fs::path> only_b;
+    };
+
+    // compare two QOI files as RGBA, decoded in lockstep a band at a time so memory use doesn't grow with their size
+    qoipp::Result<metrics::Stats> compare(const fs::path& a, const fs::path& b, std::uint8_t threshold);
+
+    // compare every file in `a` with the one of the same name in `b`, handing the pairs to the workers one at a time
+    Report compare_dirs(ThreadPool& pool, const fs::path& a, const fs::path& b, std::uint8_t threshold);
+
+    // worse frames compare less: failed, then lowest PSNR, then most differing pixels
+    bool worse(const Frame& lhs, const Frame& rhs);
+}
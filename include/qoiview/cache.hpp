@@ -0,0 +1,73 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+
+#include <qoipp/common.hpp>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace qoiview
+{
+    class SharedCache;
+
+    // fully decoded RGBA image
+    struct Image
+    {
+        qoipp::Desc              desc;
+        std::vector<qoipp::Byte> data;
+
+        // read-only pixels mapped from shared memory instead of `data`, kept alive by `mapping`
+        qoipp::ByteCSpan      shared;
+        std::shared_ptr<void> mapping;
+
+        qoipp::ByteCSpan pixels() const { return mapping ? shared : qoipp::ByteCSpan{ data }; }
+    };
+
+    // thread-safe LRU cache of decoded images, bounded by the total size of their pixels
+    class DecodedCache
+    {
+    public:
+        // a file is identified by its path, size, and modification time so edited files are never served stale
+        struct Key
+        {
+            fs::path           path;
+            std::uintmax_t     size;
+            fs::file_time_type time;
+
+            bool operator==(const Key&) const = default;
+        };
+
+        static std::optional<Key> key_of(const fs::path& path);
+
+        explicit DecodedCache(std::size_t budget)
+            : m_budget{ budget }
+        {
+        }
+
+        std::shared_ptr<const Image> find(const Key& key);
+        void                         insert(Key key, std::shared_ptr<const Image> image);
+
+        std::size_t budget() const { return m_budget; }
+
+        // second tier shared with other processes, must outlive the cache
+        void attach(SharedCache* shared) { m_shared = shared; }
+
+    private:
+        void insert_local(Key key, std::shared_ptr<const Image> image);
+
+        struct Entry
+        {
+            Key                          key;
+            std::shared_ptr<const Image> image;
+        };
+
+        mutable std::mutex m_mutex;
+        std::list<Entry>   m_entries;    // most recently used first
+        std::size_t        m_budget;
+        std::size_t        m_used   = 0;
+        SharedCache*       m_shared = nullptr;
+    };
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+namespace qoiview
+{
+    // bounded lock-free queue for one producer and one consumer thread, `N` must be a power of two
+    template <typename T, std::size_t N>
+        requires (N > 1 and (N & (N - 1)) == 0)
+    class SpscChannel
+    {
+    public:
+        using Ord = std::memory_order;
+
+        // producer side; returns false if the channel is full
+        bool try_push(T value)
+        {
+            if (full()) {
+                return false;
+            }
+
+            auto tail = m_tail.load(Ord::relaxed);
+            m_slots[tail & (N - 1)] = std::move(value);
+            m_tail.store(tail + 1, Ord::release);
+
+            return true;
+        }
+
+        // producer side; blocks while the channel is full, returns false if `token` is stopped in the meantime
+        bool push(T value, std::stop_token token)
+        {
+            while (full()) {
+                if (token.stop_requested()) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return try_push(std::move(value));
+        }
+
+        // consumer side; returns nullopt if the channel is empty
+        std::optional<T> try_pop()
+        {
+            auto head = m_head.load(Ord::relaxed);
+            if (head == m_tail_cache) {
+                m_tail_cache = m_tail.load(Ord::acquire);
+                if (head == m_tail_cache) {
+                    return std::nullopt;
+                }
+            }
+
+            auto value = std::move(m_slots[head & (N - 1)]);
+            m_head.store(head + 1, Ord::release);
+
+            return value;
+        }
+
+        bool empty() const { return m_head.load(Ord::acquire) == m_tail.load(Ord::acquire); }
+
+    private:
+        static constexpr auto cache_line = 64uz;
+
+        // producer side, only reloads the consumer's position when the cached one says full
+        bool full()
+        {
+            auto tail = m_tail.load(Ord::relaxed);
+            if (tail - m_head_cache == N) {
+                m_head_cache = m_head.load(Ord::acquire);
+            }
+            return tail - m_head_cache == N;
+        }
+
+        // written by consumer
+        alignas(cache_line) std::atomic<std::size_t> m_head       = 0;
+        alignas(cache_line) std::size_t              m_tail_cache = 0;
+
+        // written by producer
+        alignas(cache_line) std::atomic<std::size_t> m_tail       = 0;
+        alignas(cache_line) std::size_t              m_head_cache = 0;
+
+        std::array<T, N> m_slots = {};
+    };
+}
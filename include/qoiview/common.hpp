@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <ranges>
 
@@ -8,4 +9,24 @@ namespace qoiview
     namespace fs = std::filesystem;
     namespace sv = std::views;
     namespace sr = std::ranges;
+
+    template <typename T = float>
+    struct Vec2
+    {
+        T x;
+        T y;
+    };
+
+    struct Color
+    {
+        std::uint8_t r;
+        std::uint8_t g;
+        std::uint8_t b;
+    };
+
+    template <typename... Fs>
+    struct Overload : Fs...
+    {
+        using Fs::operator()...;
+    };
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace qoiview::daemon
+{
+    // an invocation handed over to the daemon, paths are absolute
+    struct Request
+    {
+        std::vector<fs::path> files;
+        std::string           sort;
+        bool                  reverse    = false;
+        bool                  single     = false;
+        int                   width      = 0;    // of the window, 0 to follow the image
+        int                   height     = 0;
+        Color                 background = {};
+    };
+
+    // $XDG_RUNTIME_DIR/qoiview.sock, or a per-user path in the temp directory
+    fs::path socket_path();
+
+    // hand a request over to a running daemon, false if none is listening
+    bool forward(const fs::path& socket, const Request& request);
+
+    // passes every request received on a Unix domain socket to the handler, called from the listening thread
+    class Server
+    {
+    public:
+        using Handler = std::function<void(Request)>;
+
+        Server(fs::path socket, Handler handler);
+        ~Server();
+
+        Server(const Server&)            = delete;
+        Server& operator=(const Server&) = delete;
+
+    private:
+        void run(std::stop_token token);
+        void serve(int client);
+
+        fs::path     m_socket;
+        Handler      m_handler;
+        int          m_fd = -1;
+        std::jthread m_thread;
+    };
+}
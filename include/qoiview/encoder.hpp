@@ -0,0 +1,12 @@
+#pragma once
+
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+
+namespace qoiview::encoder
+{
+    // encode to QOI in stripes on the pool, concatenated into a single valid stream slightly larger than a serial
+    // encode: each stripe starts from the last pixel of the previous one but only uses index entries it wrote itself
+    qoipp::Result<qoipp::ByteVec> encode(ThreadPool& pool, qoipp::ByteCSpan pixels, const qoipp::Desc& desc);
+}
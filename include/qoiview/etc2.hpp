@@ -0,0 +1,43 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/common.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+
+#include <vector>
+
+// ETC2 texture compression, sampled natively by every OpenGL ES 3.0 driver
+// color uses the individual and differential modes from ETC1, alpha uses EAC; each half block only tries every
+// table against its average color, for throughput
+namespace qoiview::etc2
+{
+    enum class Format
+    {
+        Rgb,     // GL_COMPRESSED_RGB8_ETC2, 8 bytes per 4x4 block
+        Rgba,    // GL_COMPRESSED_RGBA8_ETC2_EAC, 16 bytes per 4x4 block
+    };
+
+    struct Texture
+    {
+        Format                   format;
+        Vec2<int>                size;    // of the image, the blocks cover it rounded up to a multiple of 4
+        std::vector<qoipp::Byte> blocks;
+
+        // over whole blocks, the edge pixels repeated into the padding count again
+        double        error;      // sum of squared channel differences from the image
+        std::uint64_t samples;    // channels compared, 3 or 4 per pixel
+
+        // peak signal to noise ratio in dB, infinite for an exact copy
+        double psnr() const;
+    };
+
+    constexpr std::size_t block_bytes(Format format)
+    {
+        return format == Format::Rgb ? 8 : 16;
+    }
+
+    // compress an RGBA image, as Rgb if every pixel is opaque; rows of blocks are split over the pool
+    Texture compress(ThreadPool& pool, const Image& image);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/raster.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+
+namespace qoiview
+{
+    // writes a region of a decoded image to a QOI file on a background thread
+    class Exporter
+    {
+    public:
+        // the pool must outlive the exporter
+        explicit Exporter(ThreadPool& pool)
+            : m_pool{ pool }
+        {
+        }
+
+        struct Job
+        {
+            std::shared_ptr<const Image> image;
+            raster::Mapping              mapping;    // from output pixels to image pixels
+            Vec2<int>                    size;
+            bool                         bilinear;
+            fs::path                     path;
+        };
+
+        // job for the part of `image` visible on `screen`, mapped through `view`, written to the working directory
+        // and named after `source`; at the image resolution if `native`, else at the on-screen one filtered with
+        // `bilinear`; nullopt if nothing is visible
+        static std::optional<Job> viewport(
+            std::shared_ptr<const Image> image,
+            const fs::path&              source,
+            Vec2<int>                    screen,
+            const raster::Mapping&       view,
+            bool                         native,
+            bool                         bilinear
+        );
+
+        // returns false without doing anything if the previous export is still running
+        bool submit(Job job);
+
+        bool busy() const { return m_busy.load(std::memory_order::acquire); }
+
+    private:
+        void run(const Job& job);
+
+        ThreadPool&       m_pool;
+        std::atomic<bool> m_busy = false;
+        std::jthread      m_thread;    // last so it is joined before the rest is destroyed
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/common.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// live frames pushed over a Unix domain socket instead of written to files
+// each frame is a 12-byte header then a whole QOI file: the file size as a little-endian u32 and the send time as a
+// little-endian u64 of nanoseconds on the steady clock, which the viewer shares to measure latency
+namespace qoiview::feed
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame
+    {
+        std::uint64_t                number;    // counted from 1 in order of arrival, gaps are dropped frames
+        Clock::time_point            sent;
+        std::shared_ptr<const Image> image;
+    };
+
+    // hands values over between threads when only the newest matters, one not taken in time is replaced
+    template <typename T>
+    class Latest
+    {
+    public:
+        void put(T value)
+        {
+            {
+                auto lock = std::unique_lock{ m_mutex };
+                m_value   = std::move(value);
+            }
+            m_cv.notify_one();
+        }
+
+        std::optional<T> try_take()
+        {
+            auto lock = std::unique_lock{ m_mutex };
+            return std::exchange(m_value, std::nullopt);
+        }
+
+        // waits for a value, nullopt once `token` is stopped
+        std::optional<T> take(std::stop_token token)
+        {
+            auto lock = std::unique_lock{ m_mutex };
+            m_cv.wait(lock, token, [this] { return m_value.has_value(); });
+            return std::exchange(m_value, std::nullopt);
+        }
+
+    private:
+        std::mutex                  m_mutex;
+        std::condition_variable_any m_cv;
+        std::optional<T>            m_value;
+    };
+
+    // receives and decodes the frames of one producer at a time on two threads; the newest frame always wins, so a
+    // slow viewer drops frames instead of queueing them up
+    class Receiver
+    {
+    public:
+        // throws std::runtime_error if the socket can't be listened on
+        explicit Receiver(fs::path socket);
+        ~Receiver();
+
+        Receiver(const Receiver&)            = delete;
+        Receiver& operator=(const Receiver&) = delete;
+
+        // the newest decoded frame since the last call
+        std::optional<Frame> take() { return m_decoded.try_take(); }
+
+        const fs::path& socket() const { return m_socket; }
+
+    private:
+        struct Received
+        {
+            std::uint64_t  number;
+            std::uint64_t  sent;
+            qoipp::ByteVec data;
+        };
+
+        void receive(std::stop_token token);
+        void decode(std::stop_token token);
+
+        fs::path m_socket;
+        int      m_fd = -1;
+
+        Latest<Received> m_received;
+        Latest<Frame>    m_decoded;
+
+        std::jthread m_receiver;
+        std::jthread m_decoder;
+    };
+
+    // test producer: send the files as frames at `fps` until the viewer disconnects, false if none is listening
+    bool send(const fs::path& socket, const std::vector<fs::path>& files, double fps);
+}
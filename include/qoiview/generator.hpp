@@ -0,0 +1,127 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace qoiview
+{
+    // lazy sequence produced by a coroutine with `co_yield`, it only runs when iterated so stages built from
+    // generators read and decode nothing the consumer doesn't ask for
+    template <typename T>
+    class Generator
+    {
+    public:
+        struct promise_type
+        {
+            Generator get_return_object() { return Generator{ Handle::from_promise(*this) }; }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+
+            // the yielded object lives until the coroutine is resumed, so keeping its address is enough
+            std::suspend_always yield_value(const T& value) noexcept
+            {
+                m_value = std::addressof(value);
+                return {};
+            }
+
+            void return_void() noexcept { }
+            void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+
+            template <typename U>
+            std::suspend_never await_transform(U&&) = delete;
+
+            const T*           m_value = nullptr;
+            std::exception_ptr m_exception;
+        };
+
+        using Handle = std::coroutine_handle<promise_type>;
+
+        class Iterator
+        {
+        public:
+            using value_type      = T;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() = default;
+            explicit Iterator(Handle handle)
+                : m_handle{ handle }
+            {
+            }
+
+            const T& operator*() const { return *m_handle.promise().m_value; }
+            const T* operator->() const { return m_handle.promise().m_value; }
+
+            Iterator& operator++()
+            {
+                resume(m_handle);
+                return *this;
+            }
+
+            void operator++(int) { ++*this; }
+
+            bool operator==(std::default_sentinel_t) const { return not m_handle or m_handle.done(); }
+
+        private:
+            Handle m_handle = nullptr;
+        };
+
+        Generator() = default;
+
+        Generator(Generator&& other) noexcept
+            : m_handle{ std::exchange(other.m_handle, nullptr) }
+        {
+        }
+
+        Generator& operator=(Generator&& other) noexcept
+        {
+            if (this != &other) {
+                destroy();
+                m_handle = std::exchange(other.m_handle, nullptr);
+            }
+            return *this;
+        }
+
+        Generator(const Generator&)            = delete;
+        Generator& operator=(const Generator&) = delete;
+
+        ~Generator() { destroy(); }
+
+        Iterator begin()
+        {
+            if (m_handle) {
+                resume(m_handle);
+            }
+            return Iterator{ m_handle };
+        }
+
+        std::default_sentinel_t end() const { return {}; }
+
+    private:
+        explicit Generator(Handle handle)
+            : m_handle{ handle }
+        {
+        }
+
+        static void resume(Handle handle)
+        {
+            handle.resume();
+            if (auto exception = handle.promise().m_exception; exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+
+        void destroy()
+        {
+            if (m_handle) {
+                m_handle.destroy();
+                m_handle = nullptr;
+            }
+        }
+
+        Handle m_handle = nullptr;
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+
+#include <array>
+#include <string>
+
+namespace qoiview
+{
+    // per-channel value counts of an image, accumulated a band of rows at a time; min, max and mean come from them
+    class Histogram
+    {
+    public:
+        using Counts = std::array<std::uint64_t, 256>;
+
+        static constexpr auto max_channels = 4uz;
+
+        explicit Histogram(std::size_t channels = max_channels);
+
+        // count the pixels of `data` split over the pool, one partial histogram per chunk
+        static Histogram compute(ThreadPool& pool, qoipp::ByteCSpan data, std::size_t channels);
+
+        // decode a QOI file a band at a time and count its pixels, in its own channel count
+        static qoipp::Result<Histogram> compute(const fs::path& file);
+
+        // whole pixels only
+        void add(qoipp::ByteCSpan data);
+
+        Histogram& operator+=(const Histogram& other);
+
+        std::size_t   channels() const { return m_channels; }
+        std::uint64_t pixels() const { return m_pixels; }
+
+        const Counts& counts(std::size_t channel) const { return m_counts[channel]; }
+
+        std::uint8_t min(std::size_t channel) const;
+        std::uint8_t max(std::size_t channel) const;
+        double       mean(std::size_t channel) const;
+
+        // min, max, mean and the share of pixels clipped to 0 and to 255
+        std::string describe(std::size_t channel) const;
+
+    private:
+        std::array<Counts, max_channels> m_counts   = {};
+        std::size_t                      m_channels = max_channels;
+        std::uint64_t                    m_pixels   = 0;
+    };
+}
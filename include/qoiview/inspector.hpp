@@ -0,0 +1,51 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/metrics.hpp"
+#include "qoiview/raster.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace qoiview
+{
+    // reads pixels straight from a decoded image and summarizes selections on a background thread
+    class Inspector
+    {
+    public:
+        // the pool must outlive the inspector
+        explicit Inspector(ThreadPool& pool)
+            : m_pool{ pool }
+        {
+        }
+
+        struct Selection
+        {
+            raster::Rect    rect;    // clipped to the image
+            metrics::Region region;
+        };
+
+        // RGBA value of a pixel read in place, nullopt outside the image or the `rows` decoded so far
+        static std::optional<std::array<qoipp::Byte, 4>> pixel(const Image& image, Vec2<int> at, std::size_t rows);
+
+        // returns false without doing anything if the previous selection is still being summarized
+        bool submit(std::shared_ptr<const Image> image, raster::Rect rect);
+
+        // the summary of the last submitted selection once it is done, returned only once
+        std::optional<Selection> poll();
+
+        bool busy() const { return m_busy.load(std::memory_order::acquire); }
+
+    private:
+        ThreadPool&              m_pool;
+        std::mutex               m_mutex;
+        std::optional<Selection> m_result;
+        std::atomic<bool>        m_busy = false;
+        std::jthread             m_thread;    // last so it is joined before the rest is destroyed
+    };
+}
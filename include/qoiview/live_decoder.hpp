@@ -0,0 +1,59 @@
+#pragma once
+
+#include "qoiview/async_decoder.hpp"
+
+#include <qoipp/stream.hpp>
+
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace qoiview
+{
+    // decodes QOI images from a stream that can't be seeked or sized as the bytes arrive, with the same events as
+    // `AsyncDecoder`; each image of the stream gets the next id, and rows are published right after the read
+    class LiveDecoder
+    {
+    public:
+        using Event = AsyncDecoder::Event;
+        using Id    = AsyncDecoder::Id;
+
+        // waits until bytes are available and reads them into `out`, returns 0 at the end of the stream or once
+        // `token` is stopped
+        using Source = std::move_only_function<qoipp::Result<std::size_t>(qoipp::ByteSpan out, std::stop_token token)>;
+
+        // read a pipe, FIFO or socket, waking up regularly to check for a stop; `fd` stays blocking and must outlive
+        // the source
+        static Source read_fd(int fd);
+
+        // starts decoding right away, `name` is only used for logging
+        LiveDecoder(Source source, std::string name);
+
+        LiveDecoder(const LiveDecoder&)            = delete;
+        LiveDecoder& operator=(const LiveDecoder&) = delete;
+
+        std::optional<Event> poll() { return m_channel.try_pop(); }
+
+        // the stream ended or failed, no events follow the ones already queued
+        bool ended() const { return m_ended.load(std::memory_order::acquire); }
+
+        const std::string& name() const { return m_name; }
+
+    private:
+        static constexpr auto channel_capacity = 64uz;
+        static constexpr auto read_size        = 64uz * 1024;
+
+        void run(std::stop_token token);
+
+        Source      m_source;
+        std::string m_name;
+
+        qoipp::StreamDecoder m_decoder;
+        Id                   m_id = 0;
+
+        SpscChannel<Event, channel_capacity> m_channel;
+        std::atomic<bool>                    m_ended = false;
+
+        std::jthread m_thread;    // last, so that everything it uses is constructed before it starts
+    };
+}
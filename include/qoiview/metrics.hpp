@@ -0,0 +1,79 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/raster.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+
+#include <array>
+#include <memory>
+
+namespace qoiview::metrics
+{
+    // difference between two RGBA images, over all four channels
+    struct Stats
+    {
+        std::uint64_t sse       = 0;    // sum of squared channel errors
+        std::uint64_t samples   = 0;    // channel values compared
+        std::uint64_t pixels    = 0;
+        std::uint64_t differing = 0;    // pixels with any channel error above the threshold
+        std::uint32_t max_error = 0;
+
+        Stats& operator+=(const Stats& other);
+
+        double mse() const;
+        double psnr() const;    // infinity for identical images
+    };
+
+    // compare two equally sized runs of RGBA pixels, branch-free so it vectorizes
+    Stats compare(qoipp::ByteCSpan a, qoipp::ByteCSpan b, std::uint8_t threshold);
+
+    // same as above, with the rows split over the pool
+    Stats compare(ThreadPool& pool, qoipp::ByteCSpan a, qoipp::ByteCSpan b, std::size_t stride, std::uint8_t threshold);
+
+    // per-channel summary of a region of an RGBA image
+    struct Region
+    {
+        std::uint64_t                pixels = 0;
+        std::array<std::uint8_t, 4>  min    = { 255, 255, 255, 255 };
+        std::array<std::uint8_t, 4>  max    = {};
+        std::array<std::uint64_t, 4> sum    = {};
+        std::array<std::uint64_t, 4> sum_sq = {};
+
+        Region& operator+=(const Region& other);
+
+        double mean(std::size_t channel) const;
+        double stddev(std::size_t channel) const;
+    };
+
+    // a run of RGBA pixels, vectorized like `compare`
+    Region summarize(qoipp::ByteCSpan pixels);
+
+    // the rows of `rect` (clipped to the image) split over the pool
+    Region summarize(ThreadPool& pool, const Image& image, raster::Rect rect);
+
+    // stats of two images still being decoded, extended as rows arrive in order on both sides
+    class Incremental
+    {
+    public:
+        void reset(std::shared_ptr<const Image> a, std::shared_ptr<const Image> b, std::uint8_t threshold);
+
+        // compare the rows newly available on both sides, returns true if the stats changed
+        bool update(ThreadPool& pool, std::size_t rows_a, std::size_t rows_b);
+
+        // images of different sizes are not compared
+        bool comparable() const;
+        bool complete() const;
+
+        const Stats& stats() const { return m_stats; }
+
+    private:
+        std::shared_ptr<const Image> m_a;
+        std::shared_ptr<const Image> m_b;
+
+        std::uint8_t m_threshold = 0;
+        std::size_t  m_rows      = 0;
+        Stats        m_stats;
+    };
+}
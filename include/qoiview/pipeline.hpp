@@ -0,0 +1,79 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+#include "qoiview/generator.hpp"
+
+#include <qoipp/stream.hpp>
+
+#include <functional>
+#include <istream>
+#include <stop_token>
+
+namespace qoiview::pipeline
+{
+    // pulls the next bytes of input into `out`, returns 0 at the end of input
+    using Reader = std::move_only_function<qoipp::Result<std::size_t>(qoipp::ByteSpan out)>;
+
+    // rows [start, start + count) became available, `written` is the total bytes written to the output so far
+    struct Rows
+    {
+        std::size_t start;
+        std::size_t count;
+        std::size_t written;
+    };
+
+    // rows [start, start + pixels.size() / stride) of the image, valid until the generator is resumed
+    struct Strip
+    {
+        std::size_t      start;
+        qoipp::ByteCSpan pixels;
+    };
+
+    // read at most `size` bytes, the stream must outlive the reader
+    Reader read_stream(std::istream& stream, std::size_t size);
+
+    // read from memory, `bytes` must outlive the returned reader
+    Reader read_memory(qoipp::ByteCSpan bytes);
+
+    // read a file that is still being written, waiting on inotify (or polling every 100ms) for it to grow; returns 0
+    // only once `token` is stopped, the stream must outlive the reader
+    Reader follow_stream(std::istream& stream, const fs::path& path, std::stop_token token);
+
+    // whether the stream continues with a zstd frame, its position is left unchanged
+    bool sniff_zstd(std::istream& stream);
+
+    // whether `bytes` start with a zstd frame
+    bool sniff_zstd(qoipp::ByteCSpan bytes);
+
+    // decompress the zstd frames read from `reader`, buffering only the window; input ending mid-frame ends the
+    // output like a truncated file, and every read fails without zstd support
+    Reader zstd_stream(Reader reader);
+
+    // pull from `reader` a few chunks ahead on a thread of its own, stopped when the returned reader is destroyed
+    Reader read_ahead(Reader reader);
+
+    // fill `out` with as many reads as it takes, returns less than its size only at the end of input
+    qoipp::Result<std::size_t> read_exact(Reader& reader, qoipp::ByteSpan out);
+
+    // decode the QOI data after the header into `out`, which fits the whole image, yielding rows as they complete;
+    // a partial last row is yielded on its own, an error at most once and last
+    Generator<qoipp::Result<Rows>> decode_rows(
+        qoipp::StreamDecoder& decoder,
+        Reader                reader,
+        qoipp::ByteSpan       out,
+        std::size_t           stride,
+        std::stop_token       token
+    );
+
+    // decode the QOI data after the header a band at a time into `band`, which fits at least one row, so memory use
+    // doesn't grow with the height; truncated input is zero-padded to a whole row, an error is yielded at most once
+    // and last
+    Generator<qoipp::Result<Strip>> decode_strips(
+        qoipp::StreamDecoder& decoder,
+        Reader                reader,
+        qoipp::ByteSpan       band,
+        std::size_t           stride,
+        std::size_t           height,
+        std::stop_token       token
+    );
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/sequence.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace qoiview
+{
+    // plays frames on a steady clock in steps of `1 / fps` mapped to frames by the mode, decoding the upcoming ones
+    // ahead on the pool, one whole frame per worker
+    class Player
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        enum class Mode
+        {
+            Loop,
+            PingPong,
+            Once,
+        };
+
+        // `ahead` frames are decoded ahead of the current one, `sequence` is read instead of the files once loaded
+        Player(
+            ThreadPool&                     pool,
+            std::vector<fs::path>           frames,
+            Mode                            mode,
+            double                          fps,
+            std::size_t                     ahead,
+            std::shared_ptr<const Sequence> sequence = nullptr
+        );
+        ~Player();
+
+        // frame shown at `step`, nullopt past the end when not looping
+        std::optional<std::size_t> frame_at(std::size_t step) const;
+
+        // step the clock is at, stays put while paused
+        std::size_t step(Clock::time_point now) const;
+
+        void pause(Clock::time_point now);
+        void resume(Clock::time_point now);
+        void seek(std::size_t step, Clock::time_point now);
+
+        bool paused() const { return m_paused.has_value(); }
+
+        // decode the frames of the next steps from `step` on, in the direction of play, dropping stale decodes
+        void prefetch(std::size_t step, bool backwards = false);
+
+        // the decoded frame if it is ready, never waits
+        std::shared_ptr<const Image> ready(std::size_t frame);
+
+        std::size_t     size() const { return m_frames.size(); }
+        double          fps() const { return m_fps; }
+        const fs::path& file(std::size_t frame) const { return m_frames[frame]; }
+
+    private:
+        bool preloaded() const { return m_sequence and m_sequence->done(); }
+
+        struct Job
+        {
+            std::shared_ptr<std::atomic<bool>>        cancelled;
+            std::future<std::shared_ptr<const Image>> pending;
+            std::shared_ptr<const Image>              image;    // once the decode is collected
+        };
+
+        ThreadPool&           m_pool;
+        std::vector<fs::path> m_frames;
+        Mode                  m_mode;
+        double                m_fps;
+        std::size_t           m_ahead;
+
+        std::shared_ptr<const Sequence> m_sequence;    // shared with the decodes still running
+
+        Clock::time_point          m_start = Clock::now();    // of step 0
+        std::optional<std::size_t> m_paused;                   // step the clock stopped at
+
+        std::map<std::size_t, Job> m_jobs;    // by frame
+    };
+}
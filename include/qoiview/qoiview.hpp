@@ -1,31 +1,34 @@
 #pragma once
 
 #include "qoiview/async_decoder.hpp"
+#include "qoiview/exporter.hpp"
+#include "qoiview/feed.hpp"
+#include "qoiview/inspector.hpp"
+#include "qoiview/live_decoder.hpp"
+#include "qoiview/metrics.hpp"
+#include "qoiview/player.hpp"
+#include "qoiview/raster.hpp"
+#include "qoiview/texture_cache.hpp"
+#include "qoiview/tiled_image.hpp"
+#include "qoiview/transcoder.hpp"
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <fmt/core.h>
 #include <glbinding/gl/types.h>
 
+#include <array>
 #include <cassert>
 #include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace qoiview
 {
-    template <typename T = float>
-    struct Vec2
-    {
-        T x;
-        T y;
-    };
-
-    struct Color
-    {
-        std::uint8_t r;
-        std::uint8_t g;
-        std::uint8_t b;
-    };
-
     enum class Movement
     {
         Up,
@@ -48,28 +51,211 @@ namespace qoiview
         count
     };
 
+    // how an image is drawn smaller than its size
+    enum class Minify
+    {
+        Shader,    // the texels under each pixel averaged in the fragment shader, nothing to rebuild on upload
+        Mipmap,    // mipmaps rebuilt whenever rows are uploaded
+        Off,       // one bilinear or nearest sample, aliases
+
+        count
+    };
+
+    enum class Diff
+    {
+        Off,
+        Absolute,     // per-channel absolute difference
+        Threshold,    // pixels differing by more than the threshold in red over a dimmed first image
+
+        count
+    };
+
     enum class Uniform
     {
         Zoom,
         Offset,
         Aspect,
         Tex,
+        TexB,
+        Mode,
+        Threshold,
+        Minify,
+        Region,
+        Crop,
     };
 
     class QoiView
     {
     public:
-        QoiView(GLFWwindow* window, std::deque<fs::path> files, std::size_t start);
+        // `compare` shows every file at once in split viewports, up to 4
+        QoiView(
+            GLFWwindow*          window,
+            std::deque<fs::path> files,
+            std::size_t          start,
+            DecodedCache*        cache   = nullptr,
+            bool                 compare = false
+        );
         ~QoiView();
 
+        // can be run again once it returns, with the files given to `open`
         void run(int width, int height, Color background);
 
+        // can be called from the frame hook
+        void set_background(Color background);
+
+        // replace the file list and leave compare mode, can be called from the frame hook
+        void open(std::deque<fs::path> files, std::size_t start);
+
+        // called once per frame on the render thread
+        void on_frame(std::function<void(QoiView&)> hook) { m_on_frame = std::move(hook); }
+
+        // largest channel difference still counted as equal in diff mode
+        void set_diff_threshold(std::uint8_t threshold) { m_threshold = threshold; }
+
+        // keep decoding files that are still being written as they grow, call before `run`
+        void set_follow(bool follow);
+
+        // keep the textures of recently shown and upcoming images within `budget` bytes of GPU memory, 0 to upload
+        // every image again when it is shown; call before `run`
+        void set_texture_budget(std::size_t budget);
+
+        // also keep the images shown compressed to ETC2, drawn while they decode again; needs a texture budget
+        void set_transcode(bool transcode);
+
+        // show an image whose decoded pixels take more than `memory` bytes from tiles paged in from a cache file,
+        // within that much memory; 0 to always decode images whole; call before `run`
+        void set_memory_limit(std::size_t memory) { m_memory = memory; }
+
+        // show the images of a stream as they arrive instead of the files, call before `run`
+        void stream(LiveDecoder::Source source, std::string name);
+
+        // show the newest frame pushed to a socket instead of the files, call before `run`
+        void listen(fs::path socket);
+
+        // play the files as a sequence at `fps`, call before `run`; `preload` bytes allow loading it whole before it
+        // plays, throws std::runtime_error if it doesn't fit
+        void play(double fps, Player::Mode mode, std::size_t preload = 0);
+
     private:
+        // an image with its own decoder and texture, drawn into its own cell of the window
+        struct Slot
+        {
+            std::unique_ptr<AsyncDecoder> decoder;
+            AsyncDecoder::Id              id      = 0;
+            gl::GLuint                    texture = 0;
+            Vec2<int>                     size    = { 0, 0 };
+            Vec2<>                        aspect  = { 1.0f, 1.0f };
+            std::size_t                   rows    = 0;    // decoded so far, rows arrive in order
+            bool                          decoded = false;
+
+            std::shared_ptr<const Image> image;    // of `id`, complete once `decoded`
+
+            // last image the texture holds completely, or its texture in the cache once `kept`; a following image
+            // of the same size only uploads the rows that differ from it
+            std::shared_ptr<const Image> shown;
+            bool                         dirty   = false;    // current image is uploaded as changed rows of `shown`
+            bool                         partial = false;    // texture holds rows of an unfinished image
+
+            // decoded rows not uploaded yet, in order; the ones in view go first
+            std::vector<raster::Rows> pending;
+
+            std::optional<DecodedCache::Key> key;    // of the image, if its texture may be kept
+
+            // once finished, the texture goes into the texture cache; `shown` is then drawn from there
+            gl::GLuint                       resident = 0;    // pinned texture of the image drawn instead of `texture`
+            std::optional<DecodedCache::Key> kept;            // of `shown` when its texture went into the cache
+        };
+
+        // an upcoming file decoded on the pool, its texture is uploaded ahead of time
+        struct Prefetch
+        {
+            DecodedCache::Key                         key;
+            std::future<std::shared_ptr<const Image>> image;
+        };
+
+        // the first slot's frames during playback: decoded ahead by the player, uploaded ahead into a ring
+        struct Playback
+        {
+            static constexpr auto ring_size = 3uz;
+
+            std::shared_ptr<Sequence> sequence;    // loading while `preloading`, the clock starts once it is done
+            std::unique_ptr<Player>   player;
+            bool                      preloading = false;
+            std::size_t               loaded     = 0;    // preloaded frames shown in the title
+
+            std::array<gl::GLuint, ring_size>                   textures = {};
+            std::array<std::shared_ptr<const Image>, ring_size> images   = {};
+            std::array<std::optional<std::size_t>, ring_size>   frames   = {};    // uploaded into each texture
+
+            std::size_t                shown = 0;    // ring index on screen
+            std::optional<std::size_t> step;         // on screen, reset on seek so it isn't counted as dropped
+            bool                       backwards = false;
+
+            // reported once per second
+            Player::Clock::time_point since     = Player::Clock::now();
+            std::size_t               presented = 0;
+            std::size_t               dropped   = 0;
+            double                    achieved  = 0.0;
+        };
+
+        // frames of a live feed, uploaded into the first slot as they are taken
+        struct Feed
+        {
+            std::unique_ptr<feed::Receiver> receiver;
+            std::uint64_t                   last = 0;    // number of the frame on screen
+
+            // reported once per second
+            feed::Clock::time_point since     = feed::Clock::now();
+            std::size_t             presented = 0;
+            std::size_t             dropped   = 0;
+            double                  total     = 0.0;    // latency of the frames presented since `since`, in ms
+            double                  achieved  = 0.0;
+            double                  latency   = 0.0;
+        };
+
+        // the first slot's image while it is too large to decode whole, drawn from the tiles in view
+        struct Tiles
+        {
+            struct Load
+            {
+                std::size_t                                index;
+                Vec2<std::size_t>                          size;    // of the tile with its border
+                std::future<qoipp::Result<qoipp::ByteVec>> pixels;
+            };
+
+            using Textures = std::list<std::pair<std::size_t, gl::GLuint>>;    // by tile index
+
+            std::unique_ptr<TiledImage> image;
+            std::size_t                 capacity = 0;    // of `textures`, half of the memory limit
+
+            Textures                                                  textures;    // most recently drawn first
+            std::unordered_map<std::size_t, Textures::const_iterator> lookup;
+            std::vector<Load>                                         loading;
+            bool                                                      reported = false;    // once finished
+        };
+
+        // tiles of a level overlapping the view: columns [from.x, to.x) and rows [from.y, to.y)
+        struct TileSpan
+        {
+            std::size_t       level;
+            Vec2<std::size_t> from;
+            Vec2<std::size_t> to;
+
+            std::size_t count() const { return (to.x - from.x) * (to.y - from.y); }
+        };
+
+        static constexpr auto max_slots  = 4uz;
+        static constexpr auto upload_gap = 8uz;    // unchanged rows uploaded anyway to join two changed runs
+
+        static constexpr auto upload_budget = 8uz << 20;    // bytes of rows out of view uploaded per frame
+
+        static constexpr auto prefetch_count = 2uz;    // files ahead in the direction of travel
+
         static void callback_error(int error, const char* description);
         static void callback_framebuffer_size(GLFWwindow* window, int width, int height);
-        static void callback_key(GLFWwindow* window, int key, int, int action, int);
+        static void callback_key(GLFWwindow* window, int key, int, int action, int mods);
         static void callback_cursor(GLFWwindow* window, double xpos, double ypos);
-        static void callback_mouse_button(GLFWwindow* window, int button, int action, int);
+        static void callback_mouse_button(GLFWwindow* window, int button, int action, int mods);
         static void callback_scroll(GLFWwindow* window, double, double yoffset);
 
         static bool check_qoi(const fs::path& path);
@@ -80,7 +266,33 @@ namespace qoiview
         void increment_offset(Vec2<> offset);
         void toggle_fullscreen();
         void toggle_filtering();
-        void toggle_mipmap();
+        void toggle_minify();
+        void toggle_diff();
+        void toggle_histogram();
+        void toggle_inspector();
+        void toggle_pause();
+        void step_playback(bool backwards);
+        void update_playback();
+        void upload_frame(std::size_t ring, std::size_t frame, std::shared_ptr<const Image> image);
+        void update_feed();
+        void update_transcoder();
+        void update_prefetch();
+
+        // upload the rows of `band` that differ from the same rows of `before`, returns whether any did
+        bool upload_changed(gl::GLuint texture, const Image& before, const AsyncDecoder::Band& band);
+
+        // upload `rows` of the slot's image, returns whether anything was uploaded
+        bool upload_rows(Slot& slot, raster::Rows rows);
+
+        // upload the pending rows inside `visible`, then up to `budget` bytes of the others from the top
+        bool upload_pending(Slot& slot, raster::Rows visible, std::size_t budget);
+        void begin_selection();
+        void end_selection();
+        void report_selection();
+        void draw_selection(int fb_width, int fb_height);
+        void update_metrics();
+        void update_histogram(const Histogram& histogram);
+        void draw_histogram(int fb_width, int fb_height);
         void file_next();
         void file_previous();
         void reset_zoom();
@@ -88,16 +300,61 @@ namespace qoiview
         void update_title();
         void prepare_rect();
         void prepare_shader();
-        bool prepare_texture();
-        void update_filtering(Filter filter, bool mipmap);
-        void apply_uniform(Uniform uniform);
+        void prepare_slots(std::size_t count);
+        bool prepare_texture(Slot& slot, const fs::path& file);
+        void allocate_texture(Slot& slot, const qoipp::Desc& desc);
+        void resize_slot(Slot& slot, const qoipp::Desc& desc);
+
+        // hand the texture of the finished image over to the texture cache, the slot keeps drawing it from there
+        void keep_texture(Slot& slot);
+
+        // show `file` in the first slot from tiles, returns false if it can't be
+        bool open_tiled(Slot& slot, const fs::path& file, const qoipp::Desc& desc);
+        void close_tiled();
+        void update_tiles();
+        void draw_tiles(const Slot& slot);
+
+        // finest level with at most one of its pixels per screen pixel, coarser while its tiles in view don't fit
+        std::size_t tile_level(const Slot& slot) const;
+        TileSpan    visible_tiles(const Slot& slot, std::size_t level) const;
+
+        void process_events();
+        void update_filtering(Filter filter, Minify minify);
+        void apply_filtering(bool mipmap);
+        void apply_filtering() { apply_filtering(m_minify == Minify::Mipmap); }
+        void export_view(bool native);
+        void apply_uniform(Uniform uniform, const Slot& slot);
+        void apply_uniform(Uniform uniform) { apply_uniform(uniform, m_slots.front()); }
+
+        Vec2<int>   grid() const;
+        Vec2<int>   cell_size() const;    // in screen coordinates
+
+        // texels of the slot's image under one framebuffer pixel along each axis, 1 unless averaged in the shader
+        float minification(const Slot& slot) const;
+        std::size_t slot_at(Vec2<> cursor) const;
+
+        // rows of the image of slot `index` inside its cell
+        raster::Rows visible_rows(std::size_t index) const;
+
+        // position in the image of slot `index` under a cursor position in screen coordinates, may be outside it
+        Vec2<double> image_at(std::size_t index, Vec2<> cursor) const;
+
+        // pixels covered by a selection from `from` to the cursor
+        raster::Rect selection_rect(Vec2<double> from) const;
+
+        const fs::path& slot_file(std::size_t slot) const;
+
+        // what the slot shows, complete once `Slot::decoded` is set
+        std::shared_ptr<const Image> slot_image(std::size_t slot) const;
+
+        // texture drawn for the slot, 0 if there is nothing to draw yet
+        gl::GLuint slot_texture(std::size_t slot) const;
 
         Vec2<> m_offset      = { 0.0f, 0.0f };
-        Vec2<> m_aspect      = { 1.0f, 1.0f };
         Vec2<> m_mouse       = { 0.0f, 0.0f };
         float  m_zoom        = 1.0f;    // relative to window size
         Filter m_filter      = Filter::Linear;
-        bool   m_mipmap      = true;
+        Minify m_minify      = Minify::Shader;
         bool   m_mouse_press = false;
 
         GLFWwindow*        m_window  = nullptr;
@@ -108,17 +365,57 @@ namespace qoiview
         gl::GLuint m_vao     = 0;
         gl::GLuint m_ebo     = 0;
         gl::GLuint m_program = 0;
-        gl::GLuint m_texture = 0;
+
+        gl::GLuint m_overlay_program   = 0;
+        gl::GLuint m_histogram_texture = 0;    // 256x1, bar heights of the first slot's image
+        bool       m_show_histogram    = false;
 
         std::deque<fs::path> m_files;
-        std::size_t          m_index = 0;
+        std::size_t          m_index   = 0;
+        bool                 m_compare = false;
 
         bool m_update_texture = true;
         bool m_update_title   = true;
 
-        AsyncDecoder m_decoder;
+        ThreadPool m_pool;    // the decoders use it, so it must outlive the slots
+
+        DecodedCache*     m_cache = nullptr;
+        std::vector<Slot> m_slots;    // the first one is the only one outside of compare mode
+
+        Diff                 m_diff      = Diff::Off;    // of the first two slots
+        std::uint8_t         m_threshold = 0;
+        bool                 m_follow    = false;
+        metrics::Incremental m_metrics;
+
+        Exporter m_exporter{ m_pool };
+
+        Inspector                   m_inspector{ m_pool };
+        bool                        m_inspect        = false;    // value under the cursor shown in the title
+        bool                        m_selecting      = false;
+        std::size_t                 m_selection_slot = 0;
+        Vec2<double>                m_selection_from = { 0.0, 0.0 };
+        std::optional<raster::Rect> m_selection;    // in image pixels, drawn until the next selection
+
+        std::optional<Playback> m_playback;
+
+        std::unique_ptr<LiveDecoder> m_stream;    // replaces the first slot's decoder
+        bool                         m_stream_ended = false;
+
+        std::optional<Feed> m_feed;    // replaces the first slot's decoder
+
+        std::unique_ptr<TextureCache> m_textures;
+        std::unique_ptr<Transcoder>   m_transcoder;
+
+        std::size_t          m_memory = 0;
+        std::optional<Tiles> m_tiles;
+
+        std::vector<Prefetch>          m_prefetch;
+        std::vector<DecodedCache::Key> m_upcoming;         // nearest first
+        std::optional<std::size_t>     m_prefetch_from;    // index the upcoming files were chosen from
+        bool                           m_backwards = false;
+
+        std::function<void(QoiView&)> m_on_frame;
 
-        Vec2<int> m_image_size;
         Vec2<int> m_window_pos;     // only used for restoring from fullscreen
         Vec2<int> m_window_size;    // only used for restoring from fullscreen
     };
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+
+#include <span>
+#include <vector>
+
+namespace qoiview::raster
+{
+    struct Rect
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+
+        bool empty() const { return width <= 0 or height <= 0; }
+    };
+
+    // RGBA8 image being scaled
+    struct Source
+    {
+        qoipp::ByteCSpan pixels;
+        int              width;
+        int              height;
+    };
+
+    // 0x00RRGGBB pixels, `stride` in pixels
+    struct Target
+    {
+        std::span<std::uint32_t> pixels;
+        int                      width;
+        int                      height;
+        int                      stride;
+    };
+
+    // rows [start, start + count)
+    struct Rows
+    {
+        std::size_t start;
+        std::size_t count;
+    };
+
+    // source coordinate of the center of target pixel (x, y) is (x + 0.5) * scale + origin
+    struct Mapping
+    {
+        Vec2<double> scale;
+        Vec2<double> origin;
+    };
+
+    // mapping of the viewer's transform `(position - offset) * aspect * zoom`, inverted
+    Mapping view_mapping(Vec2<int> screen, Vec2<int> image, Vec2<> aspect, float zoom, Vec2<> offset);
+
+    // scale `src` into the `damage` region of `dst` over `background` on the pool, the background outside the source
+    void draw(
+        ThreadPool&    pool,
+        const Source&  src,
+        const Target&  dst,
+        Rect           damage,
+        const Mapping& mapping,
+        Color          background,
+        bool           bilinear
+    );
+
+    // scale `src` into a new `width` by `height` RGBA image without blending, transparent outside the source
+    qoipp::ByteVec resample(
+        ThreadPool&    pool,
+        const Source&  src,
+        int            width,
+        int            height,
+        const Mapping& mapping,
+        bool           bilinear
+    );
+
+    // runs of rows that differ between two images of the same size, merged when at most `gap` rows apart since each
+    // upload has a fixed cost
+    std::vector<Rows> changed_rows(
+        qoipp::ByteCSpan before,
+        qoipp::ByteCSpan after,
+        std::size_t      stride,
+        std::size_t      gap
+    );
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace qoiview
+{
+    // a frame range preloaded into memory, decoded or as the compressed files; `plan` picks the storage from the
+    // headers beforehand, and frames load on the pool in play order
+    class Sequence
+    {
+    public:
+        enum class Storage
+        {
+            Decoded,       // frames are ready to upload
+            Compressed,    // frames are decoded again every time they are shown
+        };
+
+        struct Plan
+        {
+            Storage     storage;
+            std::size_t bytes;    // preloaded data plus, for compressed storage, the decoded frames in flight
+        };
+
+        // store the frames decoded if they fit in `budget`, else compressed if decoding `ahead` at once keeps up with
+        // `fps`; the `ahead` and `held` decoded frames count against it, throws std::runtime_error if neither fits
+        static Plan plan(
+            const std::vector<fs::path>& frames,
+            std::size_t                  budget,
+            double                       fps,
+            std::size_t                  ahead,
+            std::size_t                  held
+        );
+
+        // decode a whole QOI file held in memory into RGBA, `file` is only used for logging
+        static std::shared_ptr<const Image> decode(qoipp::ByteCSpan bytes, const fs::path& file);
+
+        // read and decode a whole QOI file, which may be a member of an archive; nullptr if it fails
+        static std::shared_ptr<const Image> decode(const fs::path& file);
+
+        // starts loading right away, the pool must outlive the sequence
+        Sequence(ThreadPool& pool, std::vector<fs::path> frames, Storage storage);
+        ~Sequence();
+
+        Sequence(const Sequence&)            = delete;
+        Sequence& operator=(const Sequence&) = delete;
+
+        std::size_t loaded() const { return m_loaded.load(std::memory_order::relaxed); }
+        bool        done() const { return m_loaded.load(std::memory_order::acquire) == m_frames.size(); }
+
+        std::size_t size() const { return m_frames.size(); }
+        Storage     storage() const { return m_storage; }
+
+        // only once `done`; decodes from memory with compressed storage, nullptr if the frame failed to load
+        std::shared_ptr<const Image> frame(std::size_t index) const;
+
+    private:
+        void load(std::size_t index);
+
+        std::vector<fs::path> m_frames;
+        Storage               m_storage;
+
+        std::vector<std::shared_ptr<const Image>> m_decoded;
+        std::vector<qoipp::ByteVec>               m_compressed;
+
+        std::atomic<std::size_t>       m_loaded    = 0;
+        std::atomic<bool>              m_cancelled = false;
+        std::vector<std::future<void>> m_loads;
+    };
+}
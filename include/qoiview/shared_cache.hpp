@@ -0,0 +1,41 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+
+#include <string>
+
+namespace qoiview
+{
+    // decoded images shared between processes of the same user, each in its own POSIX shared memory object listed
+    // in an index of slots updated only with single-word compare-and-swap; a mapping keeps its object alive, and a
+    // process that dies leaves at worst an orphan object or a reserved slot, reclaimed later
+    class SharedCache
+    {
+    public:
+        struct Slot;
+        struct Index;
+
+        // throws std::runtime_error if the index segment can't be created or mapped
+        explicit SharedCache(std::size_t budget);
+        ~SharedCache();
+
+        SharedCache(const SharedCache&)            = delete;
+        SharedCache& operator=(const SharedCache&) = delete;
+
+        // the returned image maps the pixels read-only
+        std::shared_ptr<const Image> find(const DecodedCache::Key& key);
+        void                         publish(const DecodedCache::Key& key, const Image& image);
+
+    private:
+        // open or create the index segment and map it, false if its creator never initialized it
+        bool        attach(const std::string& name, std::size_t size, std::size_t slot_count);
+        std::string object_name(std::uint64_t hash) const;
+        bool        make_room(std::size_t size);
+        void        collect_orphans();
+
+        std::size_t m_budget;
+        std::string m_prefix;
+        Index*      m_index = nullptr;
+        std::size_t m_size  = 0;
+    };
+}
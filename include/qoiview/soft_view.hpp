@@ -0,0 +1,77 @@
+#pragma once
+
+#include "qoiview/async_decoder.hpp"
+#include "qoiview/exporter.hpp"
+#include "qoiview/raster.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <memory>
+
+namespace qoiview
+{
+    // scales and blends on the CPU and presents through X11 shared memory images, for machines without OpenGL ES
+    // 3.0; the window must be created with GLFW_NO_API on X11 (XWayland works too)
+    class SoftView
+    {
+    public:
+        SoftView(GLFWwindow* window, std::deque<fs::path> files, std::size_t start, DecodedCache* cache = nullptr);
+        ~SoftView();
+
+        void run(int width, int height, Color background);
+
+    private:
+        struct Surface;
+
+        static void callback_framebuffer_size(GLFWwindow* window, int width, int height);
+        static void callback_refresh(GLFWwindow* window);
+        static void callback_key(GLFWwindow* window, int key, int, int action, int mods);
+        static void callback_cursor(GLFWwindow* window, double xpos, double ypos);
+        static void callback_mouse_button(GLFWwindow* window, int button, int action, int);
+        static void callback_scroll(GLFWwindow* window, double, double yoffset);
+
+        void update_aspect(int width, int height);
+        void update_zoom(bool in);
+        void update_offset(Vec2<> delta);
+        void increment_offset(Vec2<> offset);
+        void file_step(int step);
+        void update_title();
+        void prepare_image();
+        void process_events();
+        void redraw();
+        void export_view(bool native);
+
+        raster::Mapping mapping() const;
+        raster::Rect    rows_to_screen(std::size_t first, std::size_t last) const;
+
+        Vec2<> m_offset      = { 0.0f, 0.0f };
+        Vec2<> m_aspect      = { 1.0f, 1.0f };
+        Vec2<> m_mouse       = { 0.0f, 0.0f };
+        float  m_zoom        = 1.0f;    // relative to window size
+        bool   m_bilinear    = true;
+        bool   m_mouse_press = false;
+
+        GLFWwindow* m_window = nullptr;
+        Color       m_background;
+
+        std::deque<fs::path> m_files;
+        std::size_t          m_index = 0;
+
+        AsyncDecoder     m_decoder;
+        AsyncDecoder::Id m_image_id = 0;
+        raster::Source   m_source   = {};
+        bool             m_decoding = false;
+        bool             m_decoded  = false;
+
+        std::unique_ptr<Surface> m_surface;
+        ThreadPool               m_pool;
+        Exporter                 m_exporter{ m_pool };
+
+        bool         m_update_image = true;
+        bool         m_update_title = true;
+        raster::Rect m_damage       = {};    // accumulated, empty if nothing needs redrawing
+    };
+}
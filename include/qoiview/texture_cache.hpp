@@ -0,0 +1,68 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/common.hpp"
+
+#include <glbinding/gl/types.h>
+
+#include <list>
+
+namespace qoiview
+{
+    // LRU cache of whole image textures on the GPU bounded by their total size, owned so only usable while the
+    // context is current; pinned textures are never evicted, and an image's exact and ETC2 textures only coexist
+    // while the exact one is pinned
+    class TextureCache
+    {
+    public:
+        struct Entry
+        {
+            DecodedCache::Key key;
+            gl::GLuint        texture;
+            Vec2<int>         size;
+            std::size_t       bytes;    // of GPU memory, as far as it can be known
+            bool              exact;    // RGBA8, otherwise ETC2 without mipmaps
+            std::size_t       pins = 0;
+        };
+
+        explicit TextureCache(std::size_t budget)
+            : m_budget{ budget }
+        {
+        }
+
+        ~TextureCache();
+
+        TextureCache(const TextureCache&)            = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        // the exact texture of the image if there is one, otherwise its compressed one
+        const Entry* find(const DecodedCache::Key& key) const;
+
+        bool contains(const DecodedCache::Key& key, bool exact) const;
+
+        // make the textures of the image the last to be evicted
+        void touch(const DecodedCache::Key& key);
+
+        // the exact texture of the image, kept until unpinned; 0 if there is none
+        gl::GLuint pin(const DecodedCache::Key& key);
+
+        // deletes the texture if it is exact, no longer pinned and the image has an ETC2 one
+        void unpin(gl::GLuint texture);
+
+        // take over a texture, replacing the one of the same kind held for the image, and its unpinned exact one if
+        // it's ETC2; evicts until it fits, a texture larger than the budget is deleted right away
+        void insert(Entry entry);
+
+        const std::list<Entry>& entries() const { return m_entries; }
+
+        std::size_t budget() const { return m_budget; }
+        std::size_t used() const { return m_used; }
+
+    private:
+        std::list<Entry>::iterator erase(std::list<Entry>::iterator it);
+
+        std::list<Entry> m_entries;    // most recently used first
+        std::size_t      m_budget;
+        std::size_t      m_used = 0;
+    };
+}
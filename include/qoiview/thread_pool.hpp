@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qoiview
+{
+    // fixed set of worker threads consuming a FIFO of jobs
+    class ThreadPool
+    {
+    public:
+        // 0 means one worker per hardware thread, they are started by the first job
+        explicit ThreadPool(std::size_t count = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&)            = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template <typename Fn>
+        auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>>
+        {
+            using Ret = std::invoke_result_t<Fn>;
+
+            auto task   = std::packaged_task<Ret()>{ std::forward<Fn>(fn) };
+            auto future = task.get_future();
+            enqueue([task = std::move(task)]() mutable { task(); });
+
+            return future;
+        }
+
+        // run `fn(begin, end)` on contiguous chunks of [0, count), the calling thread included, until all are done
+        void parallel_for(std::size_t count, const std::function<void(std::size_t, std::size_t)>& fn);
+
+        // run `fn(i)` for every i in [0, count), handed out one at a time to the workers and the calling thread so a
+        // few slow items don't hold up the rest, until all are done
+        void for_each(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+        std::size_t size() const { return m_count; }
+
+    private:
+        void enqueue(std::move_only_function<void()> job);
+        void work(std::stop_token token);
+
+        std::size_t                                  m_count;
+        std::once_flag                               m_started;
+        std::vector<std::jthread>                    m_workers;
+        std::deque<std::move_only_function<void()>> m_jobs;
+        std::mutex                                   m_mutex;
+        std::condition_variable_any                  m_cv;
+    };
+}
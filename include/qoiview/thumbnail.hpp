@@ -0,0 +1,27 @@
+#pragma once
+
+#include "qoiview/common.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+
+#include <span>
+
+namespace qoiview::thumbnail
+{
+    struct Summary
+    {
+        std::size_t written;
+        std::size_t failed;
+    };
+
+    // largest size with the aspect ratio of `desc` that fits in a `size` by `size` box, never upscaled
+    qoipp::Desc fit(const qoipp::Desc& desc, std::uint32_t size);
+
+    // area-filter a QOI file a band at a time to fit in a `size` by `size` box, encoded
+    qoipp::Result<qoipp::ByteVec> make(const fs::path& file, std::uint32_t size);
+
+    // write a thumbnail of every file into `outdir` under its name, prefixed with a hash of the path for names
+    // shared across directories; the files go to the workers one at a time
+    Summary generate(ThreadPool& pool, std::span<const fs::path> files, const fs::path& outdir, std::uint32_t size);
+}
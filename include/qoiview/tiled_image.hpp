@@ -0,0 +1,128 @@
+#pragma once
+
+#include "qoiview/archive.hpp"
+#include "qoiview/common.hpp"
+#include "qoiview/histogram.hpp"
+#include "qoiview/pipeline.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <qoipp/common.hpp>
+#include <qoipp/stream.hpp>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace qoiview
+{
+    // an image too large to hold decoded, kept as QOI tiles in a cache file and read back on demand; decoded on its
+    // own thread a row of tiles at a time into a pyramid of halving levels, holding one row of tiles per level, into
+    // a file in $XDG_CACHE_HOME/qoiview unlinked right away
+    class TiledImage
+    {
+    public:
+        static constexpr auto max_tile_size = 256uz;
+        static constexpr auto min_tile_size = 32uz;
+
+        struct Level
+        {
+            Vec2<std::size_t> size;     // in pixels
+            Vec2<std::size_t> tiles;    // columns and rows
+            std::size_t       first;    // index of its first tile, the tiles of a level are numbered row by row
+        };
+
+        // a tile as stored: its extent and a border of one pixel from each neighbor, so filtering matches across tiles
+        struct Padded
+        {
+            Vec2<std::size_t> origin;    // of the extent in the stored pixels
+            Vec2<std::size_t> size;
+        };
+
+        // most memory used decoding into and loading back tiles of `tile` pixels: a row of tiles and their borders per
+        // level, a tile encoded by each worker and the caller, and two loaded per worker
+        static std::size_t footprint(const qoipp::Desc& desc, std::size_t tile, std::size_t workers);
+
+        // largest power of two tile size between the limits whose footprint fits `memory`, nullopt if none does
+        static std::optional<std::size_t> plan(const qoipp::Desc& desc, std::size_t memory, std::size_t workers);
+
+        // start decoding `file` into tiles of `tile` pixels, throws std::runtime_error if it can't be read or the cache
+        // file can't be created
+        TiledImage(ThreadPool& pool, const fs::path& file, std::size_t tile);
+        ~TiledImage();
+
+        TiledImage(const TiledImage&)            = delete;
+        TiledImage& operator=(const TiledImage&) = delete;
+
+        const qoipp::Desc&        desc() const { return m_desc; }
+        std::size_t               tile_size() const { return m_tile; }
+        const std::vector<Level>& levels() const { return m_levels; }
+
+        std::size_t index(std::size_t level, std::size_t column, std::size_t row) const
+        {
+            return m_levels[level].first + row * m_levels[level].tiles.x + column;
+        }
+
+        // in pixels, smaller than a whole tile along the right and bottom edges
+        Vec2<std::size_t> extent(std::size_t level, std::size_t column, std::size_t row) const;
+
+        Padded padded(std::size_t level, std::size_t column, std::size_t row) const;
+
+        // written to the cache file and ready to be loaded
+        bool available(std::size_t index) const;
+
+        // read a tile back and decode it to RGBA on the pool, border included; fails with IoError if it isn't available
+        std::future<qoipp::Result<qoipp::ByteVec>> load(std::size_t index);
+
+        std::size_t rows() const { return m_rows.load(std::memory_order::acquire); }    // of the image, decoded
+        bool        finished() const { return m_finished.load(std::memory_order::acquire); }
+
+        // of every pixel, complete once finished
+        const Histogram& histogram() const { return m_histogram; }
+
+    private:
+        struct Entry
+        {
+            std::uint64_t     offset = 0;
+            std::uint64_t     size   = 0;
+            std::atomic<bool> ready  = false;    // offset and size are set
+        };
+
+        struct File;
+
+        void run(std::stop_token token);
+
+        // add the next rows of a level to its window, writing out the rows of tiles it completes; false on failure
+        bool push(std::size_t level, qoipp::ByteCSpan rows);
+
+        // encode and write out the next row of tiles of a level, then push it shrunk to the next level
+        bool emit(std::size_t level);
+
+        ThreadPool& m_pool;
+        fs::path    m_path;
+        qoipp::Desc m_desc;
+        std::size_t m_tile;
+
+        std::vector<Level>       m_levels;
+        std::unique_ptr<Entry[]> m_entries;
+
+        // one row of tiles per level with a row above and below it, the first level is decoded into `m_band`
+        qoipp::ByteVec              m_band;
+        std::vector<qoipp::ByteVec> m_windows;
+        std::vector<std::size_t>    m_filled;     // rows of each level pushed so far
+        std::vector<std::size_t>    m_emitted;    // rows of tiles of each level written out
+
+        std::shared_ptr<File>      m_file;    // shared with the loads still running
+        std::atomic<std::uint64_t> m_end = 0;
+
+        archive::Input m_input;    // its reader is handed to the decode
+
+        Histogram                m_histogram;
+        std::atomic<std::size_t> m_rows     = 0;
+        std::atomic<bool>        m_finished = false;
+
+        std::jthread m_thread;
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "qoiview/cache.hpp"
+#include "qoiview/etc2.hpp"
+#include "qoiview/thread_pool.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace qoiview
+{
+    // compresses decoded images to ETC2 in the background one at a time, split over its own pool; results are
+    // polled for from the render thread, which uploads them
+    class Transcoder
+    {
+    public:
+        struct Done
+        {
+            DecodedCache::Key key;
+            etc2::Texture     texture;
+            double            seconds;
+        };
+
+        static constexpr auto max_waiting = 4uz;
+
+        // 0 workers means half of the hardware threads, leaving the rest to the decoders
+        explicit Transcoder(std::size_t workers = 0);
+        ~Transcoder();
+
+        // the oldest waiting image is dropped once `max_waiting` are waiting, it has likely been moved past
+        void submit(DecodedCache::Key key, std::shared_ptr<const Image> image);
+
+        std::optional<Done> poll();
+
+        // pixels per second over every image so far
+        double throughput() const;
+
+    private:
+        struct Job
+        {
+            DecodedCache::Key            key;
+            std::shared_ptr<const Image> image;
+        };
+
+        void run(std::stop_token token);
+
+        ThreadPool m_pool;
+
+        std::deque<Job>             m_jobs;
+        std::deque<Done>            m_done;
+        std::uint64_t               m_pixels  = 0;
+        double                      m_seconds = 0.0;
+        mutable std::mutex          m_mutex;
+        std::condition_variable_any m_cv;
+
+        std::jthread m_thread;    // last so it is joined before the rest is destroyed
+    };
+}
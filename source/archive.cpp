@@ -0,0 +1,549 @@
+#include "qoiview/archive.hpp"
+#include "qoiview/pipeline.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    namespace fs = qoiview::fs;
+    namespace sr = std::ranges;
+
+    using qoiview::archive::Member;
+
+    constexpr auto block_size   = 512uz;
+    constexpr auto max_metadata = 1uz << 20;    // long names and pax records are read into memory
+
+    constexpr auto index_magic   = std::array{ 'Q', 'V', 'T', 'I' };
+    constexpr auto index_version = std::uint32_t{ 1 };
+
+    using Block = std::array<char, block_size>;
+
+    struct Index
+    {
+        std::uintmax_t                               size;
+        fs::file_time_type                           time;
+        std::vector<Member>                          members;
+        std::unordered_map<std::string, std::size_t> lookup;    // member name to its position in `members`
+    };
+
+    // a member found in an archive, `member` points into `index`
+    struct Located
+    {
+        fs::path                     archive;
+        std::shared_ptr<const Index> index;
+        const Member*                member;
+    };
+
+    // overrides for the next member, from a GNU long name or a pax extended header in front of it
+    struct Pending
+    {
+        std::optional<std::string>   name;
+        std::optional<std::uint64_t> size;
+        std::optional<std::int64_t>  time;
+    };
+
+    std::string_view field(const Block& block, std::size_t offset, std::size_t size)
+    {
+        return { block.data() + offset, size };
+    }
+
+    // up to the first NUL
+    std::string text(std::string_view field)
+    {
+        return std::string{ field.substr(0, field.find('\0')) };
+    }
+
+    // octal text, or big-endian base-256 when the top bit of the first byte is set
+    std::optional<std::uint64_t> parse_number(std::string_view field)
+    {
+        if (not field.empty() and (static_cast<unsigned char>(field[0]) & 0x80) != 0) {
+            auto value = std::uint64_t{ static_cast<unsigned char>(field[0]) & 0x7fu };
+            for (auto c : field.substr(1)) {
+                value = value << 8 | static_cast<unsigned char>(c);
+            }
+            return value;
+        }
+
+        auto begin = field.data();
+        auto end   = field.data() + field.size();
+        while (begin != end and *begin == ' ') {
+            ++begin;
+        }
+
+        auto value     = std::uint64_t{};
+        auto [ptr, ec] = std::from_chars(begin, end, value, 8);
+
+        return ec == std::errc{} ? std::optional{ value } : std::nullopt;
+    }
+
+    // the checksum is computed with its own field filled with spaces
+    bool valid_checksum(const Block& block)
+    {
+        auto sum = std::uint64_t{};
+        for (auto i = 0uz; i < block.size(); ++i) {
+            sum += i >= 148 and i < 156 ? ' ' : static_cast<unsigned char>(block[i]);
+        }
+        return parse_number(field(block, 148, 8)) == sum;
+    }
+
+    std::string header_name(const Block& block)
+    {
+        auto name   = text(field(block, 0, 100));
+        auto prefix = text(field(block, 345, 155));
+
+        if (field(block, 257, 5) == "ustar" and not prefix.empty()) {
+            return prefix + '/' + name;
+        }
+        return name;
+    }
+
+    std::string normalize(std::string_view name)
+    {
+        auto normal = fs::path{ name }.lexically_normal().generic_string();
+        auto start  = normal.find_first_not_of('/');    // stored as absolute, extracted relative
+
+        return start == std::string::npos ? std::string{} : normal.substr(start);
+    }
+
+    // records of "<length> <key>=<value>\n", only the ones describing the file itself are used
+    void apply_pax(std::string_view records, Pending& pending)
+    {
+        while (not records.empty()) {
+            auto length    = 0uz;
+            auto [ptr, ec] = std::from_chars(records.data(), records.data() + records.size(), length);
+            if (ec != std::errc{} or length == 0 or length > records.size()) {
+                return;
+            }
+
+            auto record = records.substr(0, length);
+            records.remove_prefix(length);
+
+            auto space = record.find(' ');
+            auto equal = record.find('=', space);
+            if (space == std::string_view::npos or equal == std::string_view::npos or not record.ends_with('\n')) {
+                continue;
+            }
+
+            auto key   = record.substr(space + 1, equal - space - 1);
+            auto value = record.substr(equal + 1, record.size() - equal - 2);
+
+            if (key == "path") {
+                pending.name = std::string{ value };
+            } else if (auto number = std::uint64_t{}; key == "size") {
+                std::from_chars(value.data(), value.data() + value.size(), number);
+                pending.size = number;
+            } else if (auto seconds = std::int64_t{}; key == "mtime") {
+                std::from_chars(value.data(), value.data() + value.size(), seconds);    // fractions are ignored
+                pending.time = seconds;
+            }
+        }
+    }
+
+    // headers only, the data of the members is seeked over
+    Index build(const fs::path& archive, std::uintmax_t size, fs::file_time_type time)
+    {
+        auto stream = std::ifstream{ archive, std::ios::binary };
+        if (not stream) {
+            throw std::runtime_error{ fmt::format("Failed to open archive {:?}", archive.c_str()) };
+        }
+
+        auto index   = Index{ .size = size, .time = time, .members = {}, .lookup = {} };
+        auto pending = Pending{};
+        auto offset  = std::uint64_t{};
+        auto block   = Block{};
+
+        while (offset + block_size <= size) {
+            stream.seekg(static_cast<std::streamoff>(offset));
+            stream.read(block.data(), block.size());
+
+            if (not stream) {
+                throw std::runtime_error{ fmt::format("Failed to read archive {:?}", archive.c_str()) };
+            } else if (sr::all_of(block, [](char c) { return c == '\0'; })) {
+                break;    // end of archive
+            } else if (not valid_checksum(block)) {
+                throw std::runtime_error{
+                    fmt::format("{:?} is not a tar archive or is corrupt at offset {}", archive.c_str(), offset)
+                };
+            }
+
+            auto type     = block[156];
+            auto metadata = type == 'L' or type == 'x' or type == 'g';
+            auto stored   = parse_number(field(block, 124, 12));
+            auto length   = metadata or not pending.size ? stored : pending.size;
+            auto data     = offset + block_size;
+
+            if (not length) {
+                throw std::runtime_error{
+                    fmt::format("Invalid member size in {:?} at offset {}", archive.c_str(), offset)
+                };
+            } else if (data + *length > size) {
+                spdlog::warn("Archive {:?} is truncated at offset {}", archive.c_str(), offset);
+                break;
+            }
+
+            if (type == 'L' or type == 'x') {
+                if (*length > max_metadata) {
+                    throw std::runtime_error{
+                        fmt::format("Oversized header in {:?} at offset {}", archive.c_str(), offset)
+                    };
+                }
+
+                auto content = std::string(*length, '\0');
+                stream.read(content.data(), static_cast<std::streamsize>(content.size()));
+
+                if (type == 'L') {
+                    pending.name = text(content);
+                } else {
+                    apply_pax(content, pending);
+                }
+            } else if (type != 'g') {
+                // regular and contiguous files, links and directories hold no pixels
+                if (type == '0' or type == '\0' or type == '7') {
+                    auto member = Member{
+                        .name   = normalize(pending.name.value_or(header_name(block))),
+                        .offset = data,
+                        .size   = *length,
+                        .time   = pending.time.value_or(
+                            static_cast<std::int64_t>(parse_number(field(block, 136, 12)).value_or(0))
+                        ),
+                    };
+
+                    // a member appended again replaces the earlier one, like on extraction
+                    auto [it, inserted] = index.lookup.try_emplace(member.name, index.members.size());
+                    if (inserted) {
+                        index.members.push_back(std::move(member));
+                    } else {
+                        index.members[it->second] = std::move(member);
+                    }
+                }
+                pending = {};
+            }
+
+            offset = data + (*length + block_size - 1) / block_size * block_size;
+        }
+
+        return index;
+    }
+
+    // $XDG_CACHE_HOME/qoiview or ~/.cache/qoiview, named after the archive's path
+    std::optional<fs::path> index_file(const fs::path& archive)
+    {
+        auto base = fs::path{};
+        if (auto* cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr and *cache != '\0') {
+            base = cache;
+        } else if (auto* home = std::getenv("HOME"); home != nullptr and *home != '\0') {
+            base = fs::path{ home } / ".cache";
+        } else {
+            return std::nullopt;
+        }
+
+        auto hash = std::hash<std::string>{}(archive.string());
+        return base / "qoiview" / fmt::format("{:016x}.tarindex", hash);
+    }
+
+    // the index is only read back by the machine that wrote it, so it's stored in native byte order
+    template <typename T>
+    void put(std::ostream& out, T value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void put_string(std::ostream& out, std::string_view str)
+    {
+        put(out, static_cast<std::uint32_t>(str.size()));
+        out.write(str.data(), static_cast<std::streamsize>(str.size()));
+    }
+
+    template <typename T>
+    std::optional<T> get(std::istream& in)
+    {
+        auto value = T{};
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return in ? std::optional{ value } : std::nullopt;
+    }
+
+    std::optional<std::string> get_string(std::istream& in)
+    {
+        auto size = get<std::uint32_t>(in);
+        if (not size or *size > max_metadata) {
+            return std::nullopt;
+        }
+
+        auto str = std::string(*size, '\0');
+        in.read(str.data(), *size);
+        return in ? std::optional{ std::move(str) } : std::nullopt;
+    }
+
+    void save(const fs::path& file, const fs::path& archive, const Index& index)
+    {
+        auto ec = std::error_code{};
+        fs::create_directories(file.parent_path(), ec);
+
+        // written aside and renamed, so another instance never reads half an index
+        auto temp = fs::path{ file } += ".tmp";
+        {
+            auto out = std::ofstream{ temp, std::ios::binary | std::ios::trunc };
+            out.write(index_magic.data(), index_magic.size());
+            put(out, index_version);
+            put_string(out, archive.native());
+            put(out, static_cast<std::uint64_t>(index.size));
+            put(out, static_cast<std::int64_t>(index.time.time_since_epoch().count()));
+            put(out, static_cast<std::uint64_t>(index.members.size()));
+
+            for (const auto& member : index.members) {
+                put(out, member.offset);
+                put(out, member.size);
+                put(out, member.time);
+                put_string(out, member.name);
+            }
+
+            if (not out.flush()) {
+                spdlog::warn("Failed to write archive index {:?}", file.c_str());
+                fs::remove(temp, ec);
+                return;
+            }
+        }
+
+        fs::rename(temp, file, ec);
+    }
+
+    std::optional<Index> load(
+        const fs::path&    file,
+        const fs::path&    archive,
+        std::uintmax_t     size,
+        fs::file_time_type time
+    )
+    {
+        auto in = std::ifstream{ file, std::ios::binary };
+
+        auto magic = decltype(index_magic){};
+        in.read(magic.data(), magic.size());
+
+        auto version = get<std::uint32_t>(in);
+        auto path    = get_string(in);
+        auto stored  = get<std::uint64_t>(in);
+        auto ticks   = get<std::int64_t>(in);
+        auto count   = get<std::uint64_t>(in);
+
+        // another archive with the same hash, or this one changed since
+        if (magic != index_magic or version != index_version or path != archive.native() or stored != size
+            or ticks != time.time_since_epoch().count() or not count) {
+            return std::nullopt;
+        }
+
+        auto index = Index{ .size = size, .time = time, .members = {}, .lookup = {} };
+        for (auto i = 0uz; i < *count; ++i) {
+            auto offset = get<std::uint64_t>(in);
+            auto length = get<std::uint64_t>(in);
+            auto mtime  = get<std::int64_t>(in);
+            auto name   = get_string(in);
+
+            if (not offset or not length or not mtime or not name) {
+                return std::nullopt;
+            }
+
+            index.lookup.emplace(*name, index.members.size());
+            index.members.push_back({ .name = std::move(*name), .offset = *offset, .size = *length, .time = *mtime });
+        }
+
+        return index;
+    }
+
+    // every archive is indexed once per process and shared by all decoders
+    std::shared_ptr<const Index> find_index(const fs::path& archive)
+    {
+        using Shared = std::shared_future<std::shared_ptr<const Index>>;
+
+        // an index being built is already in the map, lookups of other archives don't wait for it
+        struct Entry
+        {
+            std::uintmax_t     size;
+            fs::file_time_type time;
+            Shared             index;
+        };
+
+        static auto mutex   = std::mutex{};
+        static auto indices = std::map<fs::path, Entry>{};
+
+        auto ec   = std::error_code{};
+        auto path = fs::canonical(archive, ec);
+        auto size = fs::file_size(path, ec);
+        auto time = fs::last_write_time(path, ec);
+
+        if (ec) {
+            throw std::runtime_error{ fmt::format("Failed to open archive {:?}: {}", archive.c_str(), ec.message()) };
+        }
+
+        auto promise = std::promise<std::shared_ptr<const Index>>{};
+        {
+            auto lock = std::unique_lock{ mutex };
+
+            auto it = indices.find(path);
+            if (it != indices.end() and it->second.size == size and it->second.time == time) {
+                auto shared = it->second.index;
+                lock.unlock();
+                return shared.get();    // waits for another thread still building it, throws if that failed
+            }
+
+            indices.insert_or_assign(path, Entry{ size, time, promise.get_future().share() });
+        }
+
+        try {
+            auto file  = index_file(path);
+            auto index = file ? load(*file, path, size, time) : std::nullopt;
+
+            if (index) {
+                spdlog::debug("Loaded index of {:?} from {:?}", path.c_str(), file->c_str());
+            } else {
+                auto start = std::chrono::steady_clock::now();
+                index      = build(path, size, time);
+
+                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                spdlog::info("Indexed {} members of {:?} in {:.2f} s", index->members.size(), path.c_str(), elapsed);
+
+                if (file) {
+                    save(*file, path, *index);
+                }
+            }
+
+            auto shared = std::make_shared<const Index>(std::move(*index));
+            promise.set_value(shared);
+            return shared;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+
+            // tried again on the next lookup
+            auto lock = std::unique_lock{ mutex };
+            auto it   = indices.find(path);
+            if (it != indices.end() and it->second.size == size and it->second.time == time) {
+                indices.erase(it);
+            }
+            throw;
+        }
+    }
+
+    // the innermost parent named *.tar is taken as the archive, the rest of the path as the member name
+    std::optional<Located> locate(const fs::path& path)
+    {
+        for (auto parent = path.parent_path(); parent.has_relative_path(); parent = parent.parent_path()) {
+            if (not qoiview::archive::is_archive(parent)) {
+                continue;
+            }
+
+            auto index = std::shared_ptr<const Index>{};
+            try {
+                index = find_index(parent);
+            } catch (const std::runtime_error& e) {
+                spdlog::error("{}", e.what());
+                return std::nullopt;
+            }
+
+            auto name = path.lexically_relative(parent).generic_string();
+            if (auto it = index->lookup.find(name); it != index->lookup.end()) {
+                return Located{ .archive = parent, .index = index, .member = &index->members[it->second] };
+            }
+            return std::nullopt;
+        }
+
+        return std::nullopt;
+    }
+}
+
+namespace qoiview::archive
+{
+    bool is_archive(const fs::path& path)
+    {
+        auto ec = std::error_code{};
+        return path.extension() == ".tar" and fs::is_regular_file(path, ec);
+    }
+
+    std::vector<Member> members(const fs::path& archive)
+    {
+        return find_index(archive)->members;
+    }
+
+    std::optional<Stream> open(const fs::path& path)
+    {
+        auto ec = std::error_code{};
+        if (auto size = fs::file_size(path, ec); not ec) {
+            auto handle = std::ifstream{ path, std::ios::binary };
+            return handle ? std::optional{ Stream{ std::move(handle), size, false } } : std::nullopt;
+        }
+
+        auto located = locate(path);
+        if (not located) {
+            return std::nullopt;
+        }
+
+        auto handle = std::ifstream{ located->archive, std::ios::binary };
+        handle.seekg(static_cast<std::streamoff>(located->member->offset));
+
+        return handle ? std::optional{ Stream{ std::move(handle), located->member->size, true } } : std::nullopt;
+    }
+
+    std::optional<Status> status(const fs::path& path)
+    {
+        auto ec   = std::error_code{};
+        auto size = fs::file_size(path, ec);
+        auto time = fs::last_write_time(path, ec);
+
+        if (not ec) {
+            return Status{ size, time };
+        }
+
+        auto located = locate(path);
+        if (not located) {
+            return std::nullopt;
+        }
+
+        auto seconds = std::chrono::sys_seconds{ std::chrono::seconds{ located->member->time } };
+        return Status{ located->member->size, fs::file_time_type::clock::from_sys(seconds) };
+    }
+
+    qoipp::Result<void> open_input(Input& input, const fs::path& path, std::optional<qoipp::Channels> channels)
+    {
+        input.stream = open(path);
+        if (not input.stream) {
+            return qoipp::make_error<void>(qoipp::Error::IoError);
+        }
+
+        input.reader = pipeline::read_stream(input.stream->handle, input.stream->size);
+        if (pipeline::sniff_zstd(input.stream->handle)) {
+            input.reader = pipeline::zstd_stream(std::move(input.reader));
+        }
+
+        auto header = qoipp::ByteArr<qoipp::constants::header_size>{};
+        if (auto read = pipeline::read_exact(input.reader, header); not read or *read < header.size()) {
+            return qoipp::make_error<void>(read ? qoipp::Error::TooShort : read.error());
+        }
+
+        auto desc = input.decoder.initialize(header, channels);
+        if (not desc) {
+            return qoipp::make_error<void>(desc.error());
+        }
+        input.desc = *desc;
+
+        return {};
+    }
+
+    qoipp::Result<qoipp::Desc> read_header(const fs::path& path)
+    {
+        auto input = Input{};
+        if (auto opened = open_input(input, path); not opened) {
+            return qoipp::make_error<qoipp::Desc>(opened.error());
+        }
+        return input.desc;
+    }
+}
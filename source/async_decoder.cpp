@@ -4,28 +4,104 @@
 #include <fmt/ranges.h>
 #include <spdlog/spdlog.h>
 
+namespace
+{
+    // counts for the bands of one image still being worked on by the pool, merged once the decode ends
+    class Partials
+    {
+    public:
+        Partials(qoiview::ThreadPool* pool, qoiview::Histogram& histogram)
+            : m_pool{ pool }
+            , m_histogram{ histogram }
+        {
+        }
+
+        // the buffer is reused by the next image, so nothing may read it after the decode returns
+        ~Partials()
+        {
+            for (auto& partial : m_futures) {
+                partial.wait();
+            }
+        }
+
+        void add(qoipp::ByteCSpan data)
+        {
+            if (m_pool == nullptr) {
+                m_histogram.add(data);
+                return;
+            }
+
+            m_futures.push_back(m_pool->submit([data] {
+                auto histogram = qoiview::Histogram{};
+                histogram.add(data);
+                return histogram;
+            }));
+        }
+
+        void merge()
+        {
+            for (auto& partial : m_futures) {
+                m_histogram += partial.get();
+            }
+            m_futures.clear();
+        }
+
+    private:
+        qoiview::ThreadPool*                         m_pool;
+        qoiview::Histogram&                          m_histogram;
+        std::vector<std::future<qoiview::Histogram>> m_futures;
+    };
+}
+
 namespace qoiview
 {
     void AsyncDecoder::launch()
     {
+        if (m_thread.joinable()) {
+            return;
+        }
         m_thread = std::jthread{ [&](std::stop_token token) { run(token); } };
     }
 
     qoipp::Result<AsyncDecoder::Preparation> AsyncDecoder::prepare(fs::path path)
     {
         if (not m_complete.load(Ord::acquire)) {
-            m_cancel.store(true, Ord::release);
-            m_cancel.notify_one();
+            m_cancel.request_stop();
         }
         m_complete.wait(false);
+        m_cancel = std::stop_source{};
+
+        m_key    = m_cache and not m_follow ? DecodedCache::key_of(path) : std::nullopt;
+        m_cached = m_key ? m_cache->find(*m_key) : nullptr;
+
+        if (m_cached) {
+            spdlog::debug("Cache hit: {}", path.c_str());
+            m_file.reset();
+            m_task.emplace(++m_id, path, m_cached->desc);
+            return Preparation{ m_id, m_cached->desc, m_cached->pixels() };
+        }
 
         m_decoder.reset();
 
-        auto size = fs::file_size(path);
-        m_file    = File{ .handle = std::ifstream{ path, std::ios::binary }, .size = size };
+        // members of an archive are read in place, from their offset into it
+        m_file = archive::open(path);
+        if (not m_file) {
+            spdlog::error("Failed to open file {:?}", path.c_str());
+            return qoipp::make_error<Preparation>(qoipp::Error::IoError);
+        }
+
+        // compressed files are recognized by their first bytes, whatever they are named
+        m_compressed = pipeline::sniff_zstd(m_file->handle);
+        m_reader     = pipeline::read_stream(m_file->handle, m_file->size);
+        if (m_compressed) {
+            m_reader = pipeline::zstd_stream(std::move(m_reader));
+        }
 
         auto header = qoipp::ByteArr<qoipp::constants::header_size>{};
-        m_file->handle.read(reinterpret_cast<char*>(header.data()), header.size());
+        if (auto read = pipeline::read_exact(m_reader, header); not read) {
+            spdlog::error("Failed to read file {:?}: {}", path.c_str(), to_string(read.error()));
+            return qoipp::make_error<Preparation>(read.error());
+        }
 
         try {
             m_file->handle.exceptions(std::fstream::badbit);
@@ -39,45 +115,23 @@ namespace qoiview
             return qoipp::make_error<Preparation>(desc.error());
         }
 
-        m_task.emplace(path, desc.value());
+        m_task.emplace(++m_id, path, desc.value());
 
-        m_buffer.clear();
-        m_buffer.resize(desc->width * desc->height * static_cast<std::size_t>(desc->channels), 0x00);
+        // the previous image may still be referenced by the cache
+        if (not m_image or m_image.use_count() > 1) {
+            m_image = std::make_shared<Image>();
+        }
 
-        m_off_out    = 0;
-        m_off_in     = qoipp::constants::header_size;
-        m_line_start = 0;
+        m_image->desc = desc.value();
+        m_image->data.clear();
+        m_image->data.resize(desc->width * desc->height * static_cast<std::size_t>(desc->channels), 0x00);
 
-        return Preparation{ std::move(desc).value(), m_buffer };
+        return Preparation{ m_id, std::move(desc).value(), m_image->data };
     }
 
-    std::optional<AsyncDecoder::Work> AsyncDecoder::get()
+    std::optional<AsyncDecoder::Event> AsyncDecoder::poll()
     {
-        if (m_line_start >= m_task->desc.height) {
-            return std::nullopt;
-        }
-
-        const auto width = m_task->desc.width * static_cast<std::size_t>(m_task->desc.channels);
-
-        auto off_out = m_off_out.load(Ord::acquire);
-
-        auto start = m_line_start;
-        auto stop  = off_out / width;
-
-        if (start == stop) {
-            return std::nullopt;
-        }
-
-        auto count = stop - start;
-        auto span  = std::span{ m_buffer.begin() + static_cast<std::ptrdiff_t>(start * width), stop * width };
-
-        m_line_start = stop + (off_out % width == 0);
-
-        return Work{
-            .data  = span,
-            .start = start,
-            .count = count,
-        };
+        return m_channel.try_pop();
     }
 
     void AsyncDecoder::start()
@@ -89,11 +143,25 @@ namespace qoiview
         m_cv.notify_one();
     }
 
+    void AsyncDecoder::cancel()
+    {
+        if (not m_complete.load(Ord::acquire)) {
+            m_cancel.request_stop();
+        }
+        m_complete.wait(false);
+
+        m_task.reset();
+        m_reader = nullptr;
+        m_file.reset();
+        m_cached.reset();
+        m_image.reset();
+    }
+
     void AsyncDecoder::stop()
     {
         if (m_thread.joinable()) {
             m_thread.request_stop();
-            m_cancel.store(true, Ord::release);
+            m_cancel.request_stop();
             m_wake.store(true, Ord::release);
             m_cv.notify_one();
             m_thread.join();
@@ -103,101 +171,130 @@ namespace qoiview
     void AsyncDecoder::run(std::stop_token token)
     {
         while (not token.stop_requested()) {
-            if (auto cancel = m_cancel.load(Ord::acquire); not m_complete.load(Ord::acquire) and not cancel) {
-                m_complete.store(decode(), Ord::release);
-                m_complete.notify_one();
-            } else {
-                if (cancel) {
-                    m_cancel.store(false, Ord::release);
-                    m_complete.store(true, Ord::release);
-                    m_complete.notify_one();
-                }
+            {
                 auto lock = std::unique_lock{ m_mutex };
                 m_cv.wait(lock, [this] { return m_wake.load(Ord::acquire); });
                 m_wake.store(false, Ord::release);
             }
+
+            if (not m_complete.load(Ord::acquire)) {
+                decode(m_cancel.get_token());
+                m_complete.store(true, Ord::release);
+                m_complete.notify_one();
+            }
         }
     }
 
-    // true : complete
-    // false: incomplete
-    bool AsyncDecoder::decode()
+    void AsyncDecoder::decode(std::stop_token token)
     {
-        assert(m_file and m_task);
+        if (m_cached) {
+            serve(*m_cached, token);
+            return;
+        }
+
+        assert(m_file and m_task and m_image);
+
+        auto [id, path, desc]       = m_task.value();
+        auto& buffer                = m_image->data;
+        auto& [file, fsize, member] = m_file.value();
+
+        if (not m_channel.push({ .id = id, .payload = Prepared{ desc, m_image } }, token)) {
+            return;
+        }
 
-        auto [path, desc]   = m_task.value();
-        auto& [file, fsize] = m_file.value();
-        auto cancel         = false;
+        const auto stride = desc.width * static_cast<std::size_t>(desc.channels);
 
-        auto off_out = m_off_out.load(Ord::acquire);
+        // a member never grows, following it would run into the next one; a compressed file is read as it is
+        auto follow = m_follow and not member and not m_compressed;
+        auto reader = follow ? pipeline::follow_stream(file, path, token) : std::move(m_reader);
 
-        auto create_out_span = [&] {
-            return std::span{
-                m_buffer.begin() + static_cast<std::ptrdiff_t>(off_out),
-                m_buffer.size() - off_out,
-            };
+        // decompressing on a thread of its own overlaps it with decoding, once there is enough to overlap
+        if (m_compressed and fsize >= read_ahead_size) {
+            reader = pipeline::read_ahead(std::move(reader));
+        }
+
+        auto rows    = pipeline::decode_rows(m_decoder, std::move(reader), buffer, stride, token);
+        auto pushed  = 0uz;
+        auto lines   = 0uz;
+        auto written = 0uz;
+        auto counted = 0uz;
+
+        m_histogram   = Histogram{};
+        auto partials = Partials{ m_pool, m_histogram };
+
+        auto count = [&] {
+            partials.add(std::span{ buffer }.subspan(counted * stride, (lines - counted) * stride));
+            counted = lines;
         };
 
-        if (off_out < m_buffer.size()    //
-            and m_off_in < fsize         //
-            and file.good()) {
-
-            try {
-                file.read(
-                    reinterpret_cast<char*>(m_in_buf.data() + m_leftover),
-                    static_cast<std::streamsize>(m_in_buf.size() - m_leftover)
-                );
-            } catch (const std::ios_base::failure& e) {
-                spdlog::error("Failed to read file {:?}: {}", path.c_str(), e.what());
+        auto band = [&] {
+            auto data = std::span{ buffer }.subspan(pushed * stride, (lines - pushed) * stride);
+            return Event{ .id = id, .payload = Band{ .data = data, .start = pushed, .count = lines - pushed } };
+        };
+
+        for (const auto& res : rows) {
+            if (not res) {
+                spdlog::error("Failed to decode {:?}: {}", path.c_str(), to_string(res.error()));
+                m_channel.push({ .id = id, .payload = Failed{ res.error() } }, token);
+                return;
+            }
+
+            lines   = res->start + res->count;
+            written = res->written;
+
+            if ((lines - counted) * stride >= histogram_bytes) {
+                count();
             }
 
-            auto in_size = std::min(static_cast<std::size_t>(file.gcount()) + m_leftover, fsize - m_off_in);
-            auto in      = std::span{ m_in_buf.begin(), in_size };
-            auto out     = create_out_span();
-
-            m_leftover = 0uz;
-
-            while (not in.empty()) {
-                if (auto res = m_decoder.decode(out, in); res) {
-                    off_out  += res->written;
-                    m_off_in += res->processed;
-
-                    if (res->processed == 0) {
-                        m_leftover = in.size();
-                        sr::copy(in, m_in_buf.begin());
-                        in = {};
-                    } else {
-                        in = in.subspan(res->processed);
-                    }
-                } else {
-                    spdlog::error("Failed to decode {:?}: {}", path.c_str(), to_string(res.error()));
-                    cancel = true;
-                    break;
-                }
+            // a full channel only means the rows get coalesced into the next band instead of stalling the decode
+            if (m_channel.try_push(band())) {
+                pushed = lines;
             }
         }
 
-        if (cancel) {
-            spdlog::debug("Decode cancelled");
-            return true;
+        file.close();
+
+        if (token.stop_requested()) {
+            spdlog::debug("Decode cancelled: {}", path.c_str());
+            return;
+        }
+
+        count();
+        partials.merge();
+
+        auto truncated = written < buffer.size();
+        spdlog::debug("Decode complete{}: {}", truncated ? " (trunc)" : "", path.c_str());
+
+        if (pushed < lines and not m_channel.push(band(), token)) {
+            return;
         }
+        m_channel.push({ .id = id, .payload = Finished{ truncated } }, token);
 
-        while (m_decoder.has_run_count()) {
-            auto out  = create_out_span();
-            off_out  += m_decoder.drain_run(out).value();
+        // after finishing so that copying into a shared cache doesn't delay the last rows
+        if (m_cache and m_key and not truncated) {
+            m_cache->insert(*m_key, m_image);
         }
+    }
 
-        if (off_out >= m_buffer.size() or m_off_in >= fsize or file.fail()) {
-            spdlog::debug("Decode complete{}: {}", off_out < m_buffer.size() ? " (trunc)" : "", path.c_str());
-            spdlog::debug("Decoded data: {}/{}", m_off_in, fsize);
+    void AsyncDecoder::serve(const Image& image, std::stop_token token)
+    {
+        auto id = m_task->id;
 
-            m_off_out.store(off_out, Ord::release);
+        auto band = Band{ .data = image.pixels(), .start = 0, .count = image.desc.height };
+        if (not m_channel.push({ .id = id, .payload = Prepared{ image.desc, m_cached } }, token)
+            or not m_channel.push({ .id = id, .payload = band }, token)) {
+            return;
+        }
 
-            m_file->handle.close();
-            return true;
+        // counted while the band uploads, cached images don't keep their histogram
+        auto channels = static_cast<std::size_t>(image.desc.channels);
+        if (m_pool) {
+            m_histogram = Histogram::compute(*m_pool, image.pixels(), channels);
+        } else {
+            m_histogram = Histogram{ channels };
+            m_histogram.add(image.pixels());
         }
 
-        m_off_out.store(off_out, Ord::release);
-        return false;
+        m_channel.push({ .id = id, .payload = Finished{ false } }, token);
     }
 }
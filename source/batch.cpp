@@ -0,0 +1,136 @@
+#include "qoiview/batch.hpp"
+#include "qoiview/archive.hpp"
+#include "qoiview/pipeline.hpp"
+
+#include <qoipp/stream.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    namespace fs = std::filesystem;
+    namespace sr = std::ranges;
+
+    // bytes decoded at a time per image, so a worker holds two of these no matter the resolution
+    constexpr auto band_bytes = 1uz << 20;
+
+    std::vector<fs::path> list(const fs::path& dir)
+    {
+        auto names = std::vector<fs::path>{};
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            if (entry.is_regular_file()) {
+                names.push_back(entry.path().filename());
+            }
+        }
+        sr::sort(names);
+        return names;
+    }
+}
+
+namespace qoiview::batch
+{
+    qoipp::Result<metrics::Stats> compare(const fs::path& a, const fs::path& b, std::uint8_t threshold)
+    {
+        auto input_a = archive::Input{};
+        auto input_b = archive::Input{};
+
+        if (auto res = archive::open_input(input_a, a, qoipp::Channels::RGBA); not res) {
+            return qoipp::make_error<metrics::Stats>(res.error());
+        }
+        if (auto res = archive::open_input(input_b, b, qoipp::Channels::RGBA); not res) {
+            return qoipp::make_error<metrics::Stats>(res.error());
+        }
+
+        const auto& desc = input_a.desc;
+        if (desc.width != input_b.desc.width or desc.height != input_b.desc.height) {
+            return qoipp::make_error<metrics::Stats>(qoipp::Error::MismatchedDesc);
+        }
+
+        auto height = static_cast<std::size_t>(desc.height);
+        auto stride = static_cast<std::size_t>(desc.width) * 4;
+        auto rows   = std::clamp(band_bytes / std::max(stride, 1uz), 1uz, std::max(height, 1uz));
+        auto band_a = qoipp::ByteVec(stride * rows);
+        auto band_b = qoipp::ByteVec(stride * rows);
+
+        auto strips_a = pipeline::decode_strips(input_a.decoder, std::move(input_a.reader), band_a, stride, height, {});
+        auto strips_b = pipeline::decode_strips(input_b.decoder, std::move(input_b.reader), band_b, stride, height, {});
+
+        auto stats    = metrics::Stats{};
+        auto compared = 0uz;
+
+        // both bands have the same size, so the strips line up except at the end of a truncated file
+        auto it_a = strips_a.begin();
+        auto it_b = strips_b.begin();
+        for (; it_a != strips_a.end() and it_b != strips_b.end(); ++it_a, ++it_b) {
+            const auto& strip_a = *it_a;
+            const auto& strip_b = *it_b;
+
+            if (not strip_a) {
+                return qoipp::make_error<metrics::Stats>(strip_a.error());
+            } else if (not strip_b) {
+                return qoipp::make_error<metrics::Stats>(strip_b.error());
+            }
+
+            auto size  = std::min(strip_a->pixels.size(), strip_b->pixels.size());
+            stats     += metrics::compare(strip_a->pixels.first(size), strip_b->pixels.first(size), threshold);
+            compared  += size / stride;
+        }
+
+        if (compared < height) {
+            return qoipp::make_error<metrics::Stats>(qoipp::Error::TooShort);
+        }
+
+        return stats;
+    }
+
+    Report compare_dirs(ThreadPool& pool, const fs::path& a, const fs::path& b, std::uint8_t threshold)
+    {
+        auto names_a = list(a);
+        auto names_b = list(b);
+
+        auto report = Report{};
+        auto common = std::vector<fs::path>{};
+
+        sr::set_intersection(names_a, names_b, std::back_inserter(common));
+        sr::set_difference(names_a, names_b, std::back_inserter(report.only_a));
+        sr::set_difference(names_b, names_a, std::back_inserter(report.only_b));
+
+        report.frames.resize(common.size());
+
+        pool.for_each(common.size(), [&](std::size_t i) {
+            const auto& name = common[i];
+
+            auto result = compare(a / name, b / name, threshold);
+            if (not result) {
+                spdlog::warn("Failed to compare {:?}: {}", name.c_str(), to_string(result.error()));
+            }
+
+            report.frames[i] = { name, std::move(result) };
+        });
+
+        sr::sort(report.frames, worse);
+
+        return report;
+    }
+
+    bool worse(const Frame& lhs, const Frame& rhs)
+    {
+        if (lhs.result.has_value() != rhs.result.has_value()) {
+            return not lhs.result.has_value();
+        } else if (not lhs.result) {
+            return lhs.name < rhs.name;
+        }
+
+        auto psnr_lhs = lhs.result->psnr();
+        auto psnr_rhs = rhs.result->psnr();
+
+        if (psnr_lhs != psnr_rhs) {
+            return psnr_lhs < psnr_rhs;
+        } else if (lhs.result->differing != rhs.result->differing) {
+            return lhs.result->differing > rhs.result->differing;
+        }
+        return lhs.name < rhs.name;
+    }
+}
@@ -0,0 +1,79 @@
+#include "qoiview/cache.hpp"
+#include "qoiview/archive.hpp"
+#include "qoiview/shared_cache.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace qoiview
+{
+    std::optional<DecodedCache::Key> DecodedCache::key_of(const fs::path& path)
+    {
+        auto ec     = std::error_code{};
+        auto abs    = fs::absolute(path, ec);
+        auto status = archive::status(path);
+
+        if (ec or not status) {
+            return std::nullopt;
+        }
+
+        return Key{ .path = abs.lexically_normal(), .size = status->size, .time = status->time };
+    }
+
+    std::shared_ptr<const Image> DecodedCache::find(const Key& key)
+    {
+        {
+            auto lock = std::unique_lock{ m_mutex };
+
+            if (auto it = sr::find(m_entries, key, &Entry::key); it != m_entries.end()) {
+                m_entries.splice(m_entries.begin(), m_entries, it);
+                return it->image;
+            }
+        }
+
+        if (m_shared == nullptr) {
+            return nullptr;
+        }
+
+        auto image = m_shared->find(key);
+        if (image) {
+            spdlog::debug("Shared cache hit: {}", key.path.c_str());
+            insert_local(key, image);
+        }
+
+        return image;
+    }
+
+    void DecodedCache::insert(Key key, std::shared_ptr<const Image> image)
+    {
+        if (m_shared != nullptr) {
+            m_shared->publish(key, *image);
+        }
+        insert_local(std::move(key), std::move(image));
+    }
+
+    void DecodedCache::insert_local(Key key, std::shared_ptr<const Image> image)
+    {
+        auto size = image->pixels().size();
+        if (size > m_budget) {
+            return;
+        }
+
+        auto lock = std::unique_lock{ m_mutex };
+
+        if (auto it = sr::find(m_entries, key, &Entry::key); it != m_entries.end()) {
+            m_used -= it->image->pixels().size();
+            m_entries.erase(it);
+        }
+
+        while (m_used + size > m_budget and not m_entries.empty()) {
+            auto& last  = m_entries.back();
+            m_used     -= last.image->pixels().size();
+
+            spdlog::debug("Cache evict: {}", last.key.path.c_str());
+            m_entries.pop_back();
+        }
+
+        m_used += size;
+        m_entries.emplace_front(std::move(key), std::move(image));
+    }
+}
@@ -0,0 +1,281 @@
+#include "qoiview/daemon.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__unix__)
+
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+
+namespace
+{
+    // fields are separated by NUL, which can't appear in a path
+    constexpr auto protocol = std::string_view{ "qoiview-2" };
+    constexpr auto accepted = std::string_view{ "ok" };
+
+    std::string serialize(const qoiview::daemon::Request& request)
+    {
+        auto out = std::string{ protocol };
+
+        auto push = [&](std::string_view field) {
+            out.push_back('\0');
+            out.append(field);
+        };
+
+        push(request.sort);
+        push(request.reverse ? "1" : "0");
+        push(request.single ? "1" : "0");
+        push(std::to_string(request.width));
+        push(std::to_string(request.height));
+        push(fmt::format("{:02x}{:02x}{:02x}", request.background.r, request.background.g, request.background.b));
+        for (const auto& file : request.files) {
+            push(file.native());
+        }
+
+        return out;
+    }
+
+    std::optional<qoiview::daemon::Request> deserialize(std::string_view in)
+    {
+        auto fields = std::vector<std::string_view>{};
+        for (auto field : in | std::views::split('\0')) {
+            fields.emplace_back(field.begin(), field.end());
+        }
+
+        if (fields.size() < 7 or fields[0] != protocol) {
+            return std::nullopt;
+        }
+
+        auto number = [](std::string_view field, auto& out, int base) {
+            auto [end, ec] = std::from_chars(field.begin(), field.end(), out, base);
+            return ec == std::errc{} and end == field.end();
+        };
+
+        auto request = qoiview::daemon::Request{
+            .files   = {},
+            .sort    = std::string{ fields[1] },
+            .reverse = fields[2] == "1",
+            .single  = fields[3] == "1",
+        };
+
+        auto color = std::uint32_t{};
+        if (not number(fields[4], request.width, 10) or not number(fields[5], request.height, 10)
+            or not number(fields[6], color, 16)) {
+            return std::nullopt;
+        }
+        request.background = {
+            .r = static_cast<std::uint8_t>(color >> 16),
+            .g = static_cast<std::uint8_t>(color >> 8),
+            .b = static_cast<std::uint8_t>(color),
+        };
+
+        for (auto file : fields | std::views::drop(7)) {
+            request.files.emplace_back(file);
+        }
+
+        return request;
+    }
+
+    std::optional<sockaddr_un> make_address(const qoiview::fs::path& path)
+    {
+        auto addr       = sockaddr_un{};
+        addr.sun_family = AF_UNIX;
+
+        const auto& native = path.native();
+        if (native.size() >= sizeof(addr.sun_path)) {
+            spdlog::error("Socket path too long: {}", native);
+            return std::nullopt;
+        }
+        std::memcpy(addr.sun_path, native.c_str(), native.size() + 1);
+
+        return addr;
+    }
+
+    bool write_all(int fd, std::string_view data)
+    {
+        while (not data.empty()) {
+            auto count = ::write(fd, data.data(), data.size());
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data.remove_prefix(static_cast<std::size_t>(count));
+        }
+        return true;
+    }
+
+    std::string read_all(int fd)
+    {
+        auto out = std::string{};
+        auto buf = std::array<char, 4096>{};
+
+        while (true) {
+            auto count = ::read(fd, buf.data(), buf.size());
+            if (count < 0 and errno == EINTR) {
+                continue;
+            } else if (count <= 0) {
+                break;
+            }
+            out.append(buf.data(), static_cast<std::size_t>(count));
+        }
+
+        return out;
+    }
+}
+
+namespace qoiview::daemon
+{
+    fs::path socket_path()
+    {
+        if (auto* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime != nullptr and *runtime != '\0') {
+            return fs::path{ runtime } / "qoiview.sock";
+        }
+        return fs::temp_directory_path() / fmt::format("qoiview-{}.sock", ::getuid());
+    }
+
+    bool forward(const fs::path& socket, const Request& request)
+    {
+        auto addr = make_address(socket);
+        if (not addr) {
+            return false;
+        }
+
+        auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) < 0) {
+            ::close(fd);
+            return false;
+        }
+
+        auto ok = write_all(fd, serialize(request));
+        ::shutdown(fd, SHUT_WR);
+        ok = ok and read_all(fd) == accepted;
+
+        ::close(fd);
+        return ok;
+    }
+
+    Server::Server(fs::path socket, Handler handler)
+        : m_socket{ std::move(socket) }
+        , m_handler{ std::move(handler) }
+    {
+        auto addr = make_address(m_socket);
+        if (not addr) {
+            throw std::runtime_error{ fmt::format("Invalid socket path: {}", m_socket.c_str()) };
+        }
+
+        // a socket file nobody answers on is left over from a daemon that didn't exit cleanly
+        if (fs::exists(m_socket)) {
+            if (forward(m_socket, Request{})) {
+                throw std::runtime_error{ fmt::format("Daemon already running on {}", m_socket.c_str()) };
+            }
+            fs::remove(m_socket);
+        }
+
+        m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m_fd < 0) {
+            throw std::runtime_error{ fmt::format("Failed to create socket: {}", std::strerror(errno)) };
+        }
+
+        if (::bind(m_fd, reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) < 0 or ::listen(m_fd, 8) < 0) {
+            auto error = std::strerror(errno);
+            ::close(m_fd);
+            throw std::runtime_error{ fmt::format("Failed to listen on {}: {}", m_socket.c_str(), error) };
+        }
+
+        spdlog::info("Daemon listening on {}", m_socket.c_str());
+
+        m_thread = std::jthread{ [this](std::stop_token token) { run(token); } };
+    }
+
+    Server::~Server()
+    {
+        if (m_thread.joinable()) {
+            m_thread.request_stop();
+            m_thread.join();
+        }
+
+        ::close(m_fd);
+
+        auto ec = std::error_code{};
+        fs::remove(m_socket, ec);
+    }
+
+    void Server::run(std::stop_token token)
+    {
+        auto fds = pollfd{ .fd = m_fd, .events = POLLIN, .revents = 0 };
+
+        while (not token.stop_requested()) {
+            if (::poll(&fds, 1, 100) <= 0) {
+                continue;
+            }
+
+            auto client = ::accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                continue;
+            }
+
+            serve(client);
+            ::close(client);
+        }
+    }
+
+    void Server::serve(int client)
+    {
+        // a client that never finishes its message must not block the daemon
+        auto timeout = timeval{ .tv_sec = 1, .tv_usec = 0 };
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        auto request = deserialize(read_all(client));
+        if (not request) {
+            spdlog::warn("Daemon received a malformed request");
+            return;
+        }
+
+        write_all(client, accepted);
+
+        // an empty request is just a liveness probe
+        if (not request->files.empty()) {
+            m_handler(std::move(request).value());
+        }
+    }
+}
+
+#else
+
+// Unix domain sockets are not available, every invocation runs standalone
+namespace qoiview::daemon
+{
+    fs::path socket_path()
+    {
+        return {};
+    }
+
+    bool forward(const fs::path&, const Request&)
+    {
+        return false;
+    }
+
+    Server::Server(fs::path socket, Handler handler)
+        : m_socket{ std::move(socket) }
+        , m_handler{ std::move(handler) }
+    {
+        throw std::runtime_error{ "Daemon mode is not supported on this platform" };
+    }
+
+    Server::~Server() = default;
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "qoiview/encoder.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    using qoipp::Byte;
+
+    constexpr auto op_index = Byte{ 0x00 };
+    constexpr auto op_diff  = Byte{ 0x40 };
+    constexpr auto op_luma  = Byte{ 0x80 };
+    constexpr auto op_run   = Byte{ 0xc0 };
+    constexpr auto op_rgb   = Byte{ 0xfe };
+    constexpr auto op_rgba  = Byte{ 0xff };
+
+    constexpr auto max_run = 62;
+
+    // below this many pixels per stripe the per-stripe overhead isn't worth it
+    constexpr auto min_stripe = 64uz * 1024;
+
+    struct Pixel
+    {
+        Byte r, g, b, a;
+
+        bool operator==(const Pixel&) const = default;
+
+        std::size_t hash() const { return (r * 3u + g * 5u + b * 7u + a * 11u) % 64; }
+    };
+
+    Pixel load(qoipp::ByteCSpan pixels, std::size_t i, std::size_t channels)
+    {
+        auto p = pixels.subspan(i * channels);
+        return { p[0], p[1], p[2], channels == 4 ? p[3] : Byte{ 255 } };
+    }
+
+    // encodes pixels [begin, end), the decoder enters with the pixel before `begin` as its previous pixel
+    void encode_stripe(
+        qoipp::ByteCSpan pixels,
+        std::size_t      channels,
+        std::size_t      begin,
+        std::size_t      end,
+        qoipp::ByteVec&  out
+    )
+    {
+        auto index = std::array<Pixel, 64>{};
+        auto valid = std::uint64_t{ 0 };    // entries written by this stripe, the rest are unknown here
+        auto prev  = begin == 0 ? Pixel{ 0, 0, 0, 255 } : load(pixels, begin - 1, channels);
+        auto run   = 0;
+
+        out.clear();
+        out.reserve((end - begin) * (channels + 1) / 2);
+
+        for (auto i = begin; i < end; ++i) {
+            auto px = load(pixels, i, channels);
+
+            if (px == prev) {
+                if (++run == max_run) {
+                    out.push_back(op_run | static_cast<Byte>(run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                out.push_back(op_run | static_cast<Byte>(run - 1));
+                run = 0;
+            }
+
+            auto hash = px.hash();
+            auto bit  = std::uint64_t{ 1 } << hash;
+
+            if ((valid & bit) != 0 and index[hash] == px) {
+                out.push_back(op_index | static_cast<Byte>(hash));
+                prev = px;
+                continue;
+            }
+
+            index[hash]  = px;
+            valid       |= bit;
+
+            if (px.a != prev.a) {
+                out.insert(out.end(), { op_rgba, px.r, px.g, px.b, px.a });
+                prev = px;
+                continue;
+            }
+
+            auto dr = static_cast<std::int8_t>(px.r - prev.r);
+            auto dg = static_cast<std::int8_t>(px.g - prev.g);
+            auto db = static_cast<std::int8_t>(px.b - prev.b);
+
+            auto dr_dg = static_cast<std::int8_t>(dr - dg);
+            auto db_dg = static_cast<std::int8_t>(db - dg);
+
+            if (dr >= -2 and dr <= 1 and dg >= -2 and dg <= 1 and db >= -2 and db <= 1) {
+                out.push_back(static_cast<Byte>(op_diff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+            } else if (dg >= -32 and dg <= 31 and dr_dg >= -8 and dr_dg <= 7 and db_dg >= -8 and db_dg <= 7) {
+                out.push_back(static_cast<Byte>(op_luma | (dg + 32)));
+                out.push_back(static_cast<Byte>((dr_dg + 8) << 4 | (db_dg + 8)));
+            } else {
+                out.insert(out.end(), { op_rgb, px.r, px.g, px.b });
+            }
+
+            prev = px;
+        }
+
+        // a run never continues into the next stripe, the decoder is fine with two consecutive runs
+        if (run > 0) {
+            out.push_back(op_run | static_cast<Byte>(run - 1));
+        }
+    }
+
+    void write_header(qoipp::ByteVec& out, const qoipp::Desc& desc)
+    {
+        auto be32 = [&](std::uint32_t value) {
+            for (auto shift : { 24, 16, 8, 0 }) {
+                out.push_back(static_cast<Byte>(value >> shift));
+            }
+        };
+
+        out.insert(out.end(), qoipp::constants::magic.begin(), qoipp::constants::magic.end());
+        be32(desc.width);
+        be32(desc.height);
+        out.push_back(static_cast<Byte>(desc.channels));
+        out.push_back(static_cast<Byte>(desc.colorspace));
+    }
+}
+
+namespace qoiview::encoder
+{
+    qoipp::Result<qoipp::ByteVec> encode(ThreadPool& pool, qoipp::ByteCSpan pixels, const qoipp::Desc& desc)
+    {
+        auto channels = static_cast<std::size_t>(desc.channels);
+        auto count    = static_cast<std::size_t>(desc.width) * desc.height;
+
+        if (desc.width == 0 or desc.height == 0 or (channels != 3 and channels != 4)) {
+            return qoipp::make_error<qoipp::ByteVec>(qoipp::Error::InvalidDesc);
+        } else if (pixels.size() != count * channels) {
+            return qoipp::make_error<qoipp::ByteVec>(qoipp::Error::MismatchedDesc);
+        }
+
+        auto stripes = std::clamp(count / min_stripe, 1uz, pool.size() * 4);
+        auto outputs = std::vector<qoipp::ByteVec>(stripes);
+        auto bounds  = [&](std::size_t i) { return count * i / stripes; };
+
+        pool.parallel_for(stripes, [&](std::size_t first, std::size_t last) {
+            for (auto i = first; i < last; ++i) {
+                encode_stripe(pixels, channels, bounds(i), bounds(i + 1), outputs[i]);
+            }
+        });
+
+        auto size = qoipp::constants::header_size + qoipp::constants::end_marker_size;
+        for (const auto& stripe : outputs) {
+            size += stripe.size();
+        }
+
+        auto out = qoipp::ByteVec{};
+        out.reserve(size);
+
+        write_header(out, desc);
+        for (const auto& stripe : outputs) {
+            out.insert(out.end(), stripe.begin(), stripe.end());
+        }
+        out.insert(out.end(), qoipp::constants::end_marker_size - 1, Byte{ 0 });
+        out.push_back(Byte{ 1 });
+
+        return out;
+    }
+}
@@ -0,0 +1,332 @@
+#include "qoiview/etc2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    using qoiview::etc2::Format;
+
+    // a 4x4 block in the order its pixel indices are stored: column by column
+    using Pixel  = std::array<int, 4>;
+    using Pixels = std::array<Pixel, 16>;
+
+    struct Encoded
+    {
+        std::uint64_t bits;
+        long          error;
+    };
+
+    // modifiers of a color table in pixel index order: a, b, -a, -b
+    constexpr auto color_tables = std::array<std::array<int, 4>, 8>{ {
+        { 2, 8, -2, -8 },
+        { 5, 17, -5, -17 },
+        { 9, 29, -9, -29 },
+        { 13, 42, -13, -42 },
+        { 18, 60, -18, -60 },
+        { 24, 80, -24, -80 },
+        { 33, 106, -33, -106 },
+        { 47, 183, -47, -183 },
+    } };
+
+    constexpr auto alpha_tables = std::array<std::array<int, 8>, 16>{ {
+        { -3, -6, -9, -15, 2, 5, 8, 14 },
+        { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5, -8, -13, 1, 4, 7, 12 },
+        { -2, -4, -6, -13, 1, 3, 5, 12 },
+        { -3, -6, -8, -12, 2, 5, 7, 11 },
+        { -3, -7, -9, -11, 2, 6, 8, 10 },
+        { -4, -7, -8, -11, 3, 6, 7, 10 },
+        { -3, -5, -8, -11, 2, 4, 7, 10 },
+        { -2, -6, -8, -10, 1, 5, 7, 9 },
+        { -2, -5, -8, -10, 1, 4, 7, 9 },
+        { -2, -4, -8, -10, 1, 3, 7, 9 },
+        { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 },
+        { -1, -2, -3, -10, 0, 1, 2, 9 },
+        { -4, -6, -8, -9, 3, 5, 7, 8 },
+        { -3, -5, -7, -9, 2, 4, 6, 8 },
+    } };
+
+    int clamp_byte(int value)
+    {
+        return std::clamp(value, 0, 255);
+    }
+
+    int square(int value)
+    {
+        return value * value;
+    }
+
+    // block at (bx, by), edge pixels repeated where it sticks out of the image
+    Pixels load(const qoiview::Image& image, std::size_t bx, std::size_t by)
+    {
+        const auto width  = std::size_t{ image.desc.width };
+        const auto height = std::size_t{ image.desc.height };
+        const auto pixels = image.pixels();
+
+        auto block = Pixels{};
+        for (auto i = 0uz; i < 16; ++i) {
+            auto x = std::min(bx * 4 + i / 4, width - 1);
+            auto y = std::min(by * 4 + i % 4, height - 1);
+            auto p = pixels.subspan((y * width + x) * 4, 4);
+
+            block[i] = { p[0], p[1], p[2], p[3] };
+        }
+        return block;
+    }
+
+    // the better of the two layouts of two half blocks, 2x4 side by side or 4x2 on top of each other
+    Encoded encode_color(const Pixels& block)
+    {
+        auto best = Encoded{ 0, std::numeric_limits<long>::max() };
+
+        for (auto flip : { 0, 1 }) {
+            auto half = [&](std::size_t i) { return flip ? i % 4 / 2 : i / 8; };
+
+            auto sums = std::array<std::array<int, 3>, 2>{};
+            for (auto i = 0uz; i < 16; ++i) {
+                for (auto c = 0uz; c < 3; ++c) {
+                    sums[half(i)][c] += block[i][c];
+                }
+            }
+
+            auto quantize = [&](std::size_t h, std::size_t c, int levels) {
+                return static_cast<int>(std::lround(sums[h][c] / 8.0 * levels / 255.0));
+            };
+
+            // differential mode stores 5 bits per channel but needs the two colors within a small delta
+            auto q5   = std::array<std::array<int, 3>, 2>{};
+            auto diff = true;
+            for (auto c = 0uz; c < 3; ++c) {
+                q5[0][c]   = quantize(0, c, 31);
+                q5[1][c]   = quantize(1, c, 31);
+                auto delta = q5[1][c] - q5[0][c];
+                diff       = diff and delta >= -4 and delta <= 3;
+            }
+
+            auto codes = std::array<std::array<int, 3>, 2>{};
+            auto bases = std::array<std::array<int, 3>, 2>{};
+            for (auto h = 0uz; h < 2; ++h) {
+                for (auto c = 0uz; c < 3; ++c) {
+                    codes[h][c] = diff ? q5[h][c] : quantize(h, c, 15);
+                    bases[h][c] = diff ? (codes[h][c] << 3) | (codes[h][c] >> 2) : codes[h][c] * 17;
+                }
+            }
+
+            auto tables  = std::array<int, 2>{};
+            auto indices = std::array<int, 16>{};
+            auto error   = 0l;
+
+            for (auto h = 0uz; h < 2; ++h) {
+                auto half_best    = std::numeric_limits<long>::max();
+                auto half_indices = std::array<int, 16>{};
+
+                // a modifier moves every channel alike, so the one closest to the pixel's mean distance from the
+                // base color fits best, clamping aside
+                auto offsets = std::array<int, 16>{};
+                for (auto i = 0uz; i < 16; ++i) {
+                    for (auto c = 0uz; c < 3; ++c) {
+                        offsets[i] += block[i][c] - bases[h][c];
+                    }
+                }
+
+                for (auto t = 0uz; t < 8; ++t) {
+                    const auto& table = color_tables[t];
+
+                    auto sum     = 0l;
+                    auto current = std::array<int, 16>{};
+
+                    for (auto i = 0uz; i < 16 and sum < half_best; ++i) {
+                        if (half(i) != h) {
+                            continue;
+                        }
+
+                        // compared at 3 times the scale of the modifiers
+                        auto offset = offsets[i];
+                        auto sign   = offset < 0 ? 2 : 0;
+                        auto small  = std::abs(std::abs(offset) - 3 * table[0]);
+                        auto large  = std::abs(std::abs(offset) - 3 * table[1]);
+                        auto index  = sign + (large < small ? 1 : 0);
+
+                        auto modifier = table[static_cast<std::size_t>(index)];
+                        for (auto c = 0uz; c < 3; ++c) {
+                            sum += square(clamp_byte(bases[h][c] + modifier) - block[i][c]);
+                        }
+                        current[i] = index;
+                    }
+
+                    if (sum < half_best) {
+                        half_best    = sum;
+                        half_indices = current;
+                        tables[h]    = static_cast<int>(t);
+                    }
+                }
+
+                error += half_best;
+                for (auto i = 0uz; i < 16; ++i) {
+                    if (half(i) == h) {
+                        indices[i] = half_indices[i];
+                    }
+                }
+            }
+
+            if (error >= best.error) {
+                continue;
+            }
+
+            auto bits = std::uint64_t{ 0 };
+            for (auto c = 0uz; c < 3; ++c) {
+                auto shift = 56 - 8 * static_cast<int>(c);
+                if (diff) {
+                    auto delta = static_cast<std::uint64_t>(codes[1][c] - codes[0][c]) & 0x7;
+                    bits |= static_cast<std::uint64_t>(codes[0][c]) << (shift + 3) | delta << shift;
+                } else {
+                    bits |= static_cast<std::uint64_t>(codes[0][c]) << (shift + 4)
+                          | static_cast<std::uint64_t>(codes[1][c]) << shift;
+                }
+            }
+            bits |= static_cast<std::uint64_t>(tables[0]) << 37 | static_cast<std::uint64_t>(tables[1]) << 34;
+            bits |= static_cast<std::uint64_t>(diff) << 33 | static_cast<std::uint64_t>(flip) << 32;
+
+            for (auto i = 0uz; i < 16; ++i) {
+                auto index = static_cast<std::uint64_t>(indices[i]);
+                bits |= (index >> 1) << (16 + i) | (index & 1) << i;
+            }
+
+            best = { bits, error };
+        }
+
+        return best;
+    }
+
+    // EAC: a base value plus one of 8 modifiers of a table scaled by a multiplier
+    Encoded encode_alpha(const Pixels& block)
+    {
+        auto [lo, hi] = std::ranges::minmax(block | std::views::transform([](const Pixel& p) { return p[3]; }));
+
+        // table 13 has a zero modifier, a flat block is stored exactly
+        if (lo == hi) {
+            auto bits = static_cast<std::uint64_t>(lo) << 56 | std::uint64_t{ 1 } << 52 | std::uint64_t{ 13 } << 48;
+            for (auto i = 0uz; i < 16; ++i) {
+                bits |= std::uint64_t{ 4 } << (45 - 3 * i);
+            }
+            return { bits, 0 };
+        }
+
+        auto best = Encoded{ 0, std::numeric_limits<long>::max() };
+
+        for (auto t = 0uz; t < 16; ++t) {
+            const auto& table = alpha_tables[t];
+
+            auto [tlo, thi] = std::ranges::minmax(table);
+            auto fit        = std::ceil(static_cast<double>(hi - lo) / (thi - tlo));
+            auto mul        = std::clamp(static_cast<int>(fit), 1, 15);
+            auto base       = clamp_byte(static_cast<int>(std::lround((lo + hi) / 2.0 - (tlo + thi) / 2.0 * mul)));
+
+            auto values = std::array<int, 8>{};
+            for (auto m = 0uz; m < 8; ++m) {
+                values[m] = clamp_byte(base + table[m] * mul);
+            }
+
+            auto bits  = static_cast<std::uint64_t>(base) << 56 | static_cast<std::uint64_t>(mul) << 52
+                      | static_cast<std::uint64_t>(t) << 48;
+            auto error = 0l;
+
+            for (auto i = 0uz; i < 16 and error < best.error; ++i) {
+                auto pixel_best = std::numeric_limits<int>::max();
+                auto index      = 0uz;
+                for (auto m = 0uz; m < 8; ++m) {
+                    auto d = std::abs(values[m] - block[i][3]);
+                    if (d < pixel_best) {
+                        pixel_best = d;
+                        index      = m;
+                    }
+                }
+                error += square(pixel_best);
+                bits  |= static_cast<std::uint64_t>(index) << (45 - 3 * i);
+            }
+
+            if (error < best.error) {
+                best = { bits, error };
+            }
+        }
+
+        return best;
+    }
+
+    // blocks are stored as big-endian 64-bit words
+    void store(qoipp::Byte* out, std::uint64_t bits)
+    {
+        for (auto i = 0; i < 8; ++i) {
+            out[i] = static_cast<qoipp::Byte>(bits >> (56 - 8 * i));
+        }
+    }
+}
+
+namespace qoiview::etc2
+{
+    double Texture::psnr() const
+    {
+        if (error == 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return 10.0 * std::log10(255.0 * 255.0 * static_cast<double>(samples) / error);
+    }
+
+    Texture compress(ThreadPool& pool, const Image& image)
+    {
+        const auto pixels = image.pixels();
+        auto opaque = true;
+        for (auto i = 3uz; i < pixels.size() and opaque; i += 4) {
+            opaque = pixels[i] == 0xff;
+        }
+        const auto format = opaque ? Format::Rgb : Format::Rgba;
+
+        const auto columns = (image.desc.width + 3) / 4;
+        const auto rows    = (image.desc.height + 3) / 4;
+        const auto bytes   = block_bytes(format);
+
+        auto texture = Texture{
+            .format  = format,
+            .size    = { static_cast<int>(image.desc.width), static_cast<int>(image.desc.height) },
+            .blocks  = std::vector<qoipp::Byte>(columns * rows * bytes),
+            .error   = 0.0,
+            .samples = columns * rows * 16 * (opaque ? 3uz : 4uz),
+        };
+
+        // errors summed per row of blocks so the chunks don't share a counter
+        auto errors = std::vector<double>(rows);
+
+        pool.parallel_for(rows, [&](std::size_t begin, std::size_t end) {
+            for (auto by = begin; by < end; ++by) {
+                auto error = 0.0;
+                for (auto bx = 0uz; bx < columns; ++bx) {
+                    auto block = load(image, bx, by);
+                    auto out   = texture.blocks.data() + (by * columns + bx) * bytes;
+
+                    // the alpha block comes first
+                    if (format == Format::Rgba) {
+                        auto alpha = encode_alpha(block);
+                        store(out, alpha.bits);
+                        error += static_cast<double>(alpha.error);
+                        out   += 8;
+                    }
+
+                    auto color = encode_color(block);
+                    store(out, color.bits);
+                    error += static_cast<double>(color.error);
+                }
+                errors[by] = error;
+            }
+        });
+
+        for (auto error : errors) {
+            texture.error += error;
+        }
+
+        return texture;
+    }
+}
@@ -0,0 +1,122 @@
+#include "qoiview/exporter.hpp"
+#include "qoiview/encoder.hpp"
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+namespace qoiview
+{
+    std::optional<Exporter::Job> Exporter::viewport(
+        std::shared_ptr<const Image> image,
+        const fs::path&              source,
+        Vec2<int>                    screen,
+        const raster::Mapping&       view,
+        bool                         native,
+        bool                         bilinear
+    )
+    {
+        auto iw = static_cast<double>(image->desc.width);
+        auto ih = static_cast<double>(image->desc.height);
+
+        // visible part of the image in image pixels
+        auto u0 = std::max(view.origin.x, 0.0);
+        auto v0 = std::max(view.origin.y, 0.0);
+        auto u1 = std::min(view.origin.x + screen.x * view.scale.x, iw);
+        auto v1 = std::min(view.origin.y + screen.y * view.scale.y, ih);
+
+        if (u1 <= u0 or v1 <= v0) {
+            return std::nullopt;
+        }
+
+        auto job = Job{ .image = std::move(image), .mapping = {}, .size = {}, .bilinear = false, .path = {} };
+
+        if (native) {
+            auto x0 = std::floor(u0);
+            auto y0 = std::floor(v0);
+
+            // nearest at scale 1 from a whole pixel origin is an exact copy
+            job.mapping = { .scale = { 1.0, 1.0 }, .origin = { x0, y0 } };
+            job.size    = {
+                   .x = static_cast<int>(std::ceil(u1) - x0),
+                   .y = static_cast<int>(std::ceil(v1) - y0),
+            };
+        } else {
+            job.mapping  = { .scale = view.scale, .origin = { u0, v0 } };
+            job.bilinear = bilinear;
+            job.size     = {
+                    .x = std::max(static_cast<int>(std::lround((u1 - u0) / view.scale.x)), 1),
+                    .y = std::max(static_cast<int>(std::lround((v1 - v0) / view.scale.y)), 1),
+            };
+        }
+
+        auto name = fmt::format(
+            "{}-{}_{}-{}x{}.qoi",
+            source.stem().string(),
+            static_cast<int>(u0),
+            static_cast<int>(v0),
+            job.size.x,
+            job.size.y
+        );
+        job.path = fs::current_path() / name;
+
+        return job;
+    }
+
+    bool Exporter::submit(Job job)
+    {
+        if (busy()) {
+            return false;
+        }
+
+        m_busy.store(true, std::memory_order::release);
+        m_thread = std::jthread{ [this, job = std::move(job)] {
+            run(job);
+            m_busy.store(false, std::memory_order::release);
+        } };
+
+        return true;
+    }
+
+    void Exporter::run(const Job& job)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        auto& [image, mapping, size, bilinear, path] = job;
+
+        auto source = raster::Source{
+            .pixels = image->pixels(),
+            .width  = static_cast<int>(image->desc.width),
+            .height = static_cast<int>(image->desc.height),
+        };
+        auto pixels  = raster::resample(m_pool, source, size.x, size.y, mapping, bilinear);
+        auto desc    = qoipp::Desc{
+               .width      = static_cast<std::uint32_t>(size.x),
+               .height     = static_cast<std::uint32_t>(size.y),
+               .channels   = qoipp::Channels::RGBA,
+               .colorspace = image->desc.colorspace,
+        };
+        auto encoded = encoder::encode(m_pool, pixels, desc);
+
+        if (not encoded) {
+            spdlog::error("Failed to encode {:?}: {}", path.c_str(), to_string(encoded.error()));
+            return;
+        }
+
+        auto file = std::ofstream{ path, std::ios::binary | std::ios::trunc };
+        file.write(reinterpret_cast<const char*>(encoded->data()), std::ssize(*encoded));
+
+        if (not file) {
+            spdlog::error("Failed to write {:?}", path.c_str());
+            return;
+        }
+
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        spdlog::info("Exported {}x{} to {:?} in {:.1f}ms", size.x, size.y, path.c_str(), elapsed.count());
+
+        fmt::println("{}", path.c_str());
+    }
+}
@@ -0,0 +1,282 @@
+#include "qoiview/feed.hpp"
+#include "qoiview/sequence.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__)
+
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+
+namespace
+{
+    namespace fs = qoiview::fs;
+
+    constexpr auto header_size = 12uz;
+    constexpr auto max_frame   = std::size_t{ 1 } << 30;
+
+    std::optional<sockaddr_un> make_address(const fs::path& path)
+    {
+        auto addr       = sockaddr_un{};
+        addr.sun_family = AF_UNIX;
+
+        const auto& native = path.native();
+        if (native.size() >= sizeof(addr.sun_path)) {
+            spdlog::error("Socket path too long: {}", native);
+            return std::nullopt;
+        }
+        std::memcpy(addr.sun_path, native.c_str(), native.size() + 1);
+
+        return addr;
+    }
+
+    // waits for the whole of `out`, false on disconnect or once `token` is stopped
+    bool read_exact(int fd, qoipp::ByteSpan out, std::stop_token token)
+    {
+        auto fds = pollfd{ .fd = fd, .events = POLLIN, .revents = 0 };
+
+        while (not out.empty() and not token.stop_requested()) {
+            if (::poll(&fds, 1, 100) <= 0) {
+                continue;
+            }
+
+            auto count = ::read(fd, out.data(), out.size());
+            if (count < 0 and errno == EINTR) {
+                continue;
+            } else if (count <= 0) {
+                return false;
+            }
+            out = out.subspan(static_cast<std::size_t>(count));
+        }
+
+        return out.empty();
+    }
+
+    bool write_all(int fd, qoipp::ByteCSpan data)
+    {
+        while (not data.empty()) {
+            auto count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data = data.subspan(static_cast<std::size_t>(count));
+        }
+        return true;
+    }
+
+    template <typename T>
+    T load_le(qoipp::ByteCSpan bytes)
+    {
+        auto value = T{};
+        for (auto i = sizeof(T); i-- > 0;) {
+            value = static_cast<T>(value << 8 | bytes[i]);
+        }
+        return value;
+    }
+
+    template <typename T>
+    void store_le(qoipp::ByteSpan bytes, T value)
+    {
+        for (auto i = 0uz; i < sizeof(T); ++i) {
+            bytes[i] = static_cast<qoipp::Byte>(value >> (i * 8));
+        }
+    }
+
+    std::uint64_t now_ns()
+    {
+        auto since = qoiview::feed::Clock::now().time_since_epoch();
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+    }
+}
+
+namespace qoiview::feed
+{
+    Receiver::Receiver(fs::path socket)
+        : m_socket{ std::move(socket) }
+    {
+        auto addr = make_address(m_socket);
+        if (not addr) {
+            throw std::runtime_error{ fmt::format("Invalid socket path: {}", m_socket.c_str()) };
+        }
+
+        // left over from a viewer that didn't exit cleanly if nothing accepts connections on it anymore
+        if (fs::is_socket(m_socket)) {
+            auto probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (probe < 0) {
+                throw std::runtime_error{ fmt::format("Failed to create socket: {}", std::strerror(errno)) };
+            }
+
+            auto connected = ::connect(probe, reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) == 0;
+            auto refused   = not connected and errno == ECONNREFUSED;
+            ::close(probe);
+
+            if (connected) {
+                throw std::runtime_error{ fmt::format("Another viewer is listening on {}", m_socket.c_str()) };
+            } else if (refused) {
+                fs::remove(m_socket);
+            }
+        }
+
+        m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m_fd < 0) {
+            throw std::runtime_error{ fmt::format("Failed to create socket: {}", std::strerror(errno)) };
+        }
+
+        if (::bind(m_fd, reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) < 0 or ::listen(m_fd, 1) < 0) {
+            auto error = std::strerror(errno);
+            ::close(m_fd);
+            throw std::runtime_error{ fmt::format("Failed to listen on {}: {}", m_socket.c_str(), error) };
+        }
+
+        spdlog::info("Waiting for frames on {}", m_socket.c_str());
+
+        m_receiver = std::jthread{ [this](std::stop_token token) { receive(token); } };
+        m_decoder  = std::jthread{ [this](std::stop_token token) { decode(token); } };
+    }
+
+    Receiver::~Receiver()
+    {
+        m_decoder  = {};
+        m_receiver = {};
+
+        ::close(m_fd);
+
+        auto ec = std::error_code{};
+        fs::remove(m_socket, ec);
+    }
+
+    void Receiver::receive(std::stop_token token)
+    {
+        auto fds    = pollfd{ .fd = m_fd, .events = POLLIN, .revents = 0 };
+        auto number = 0uz;
+
+        while (not token.stop_requested()) {
+            if (::poll(&fds, 1, 100) <= 0) {
+                continue;
+            }
+
+            auto client = ::accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                continue;
+            }
+
+            spdlog::info("Producer connected");
+
+            auto header = std::array<qoipp::Byte, header_size>{};
+            while (read_exact(client, header, token)) {
+                auto size = load_le<std::uint32_t>(header);
+                if (size > max_frame) {
+                    spdlog::error("Frame of {} bytes is too large, disconnecting", size);
+                    break;
+                }
+
+                auto frame = Received{
+                    .number = ++number,
+                    .sent   = load_le<std::uint64_t>(std::span{ header }.subspan(4)),
+                    .data   = qoipp::ByteVec(size),
+                };
+                if (not read_exact(client, frame.data, token)) {
+                    break;
+                }
+
+                m_received.put(std::move(frame));
+            }
+
+            ::close(client);
+            spdlog::info("Producer disconnected");
+        }
+    }
+
+    void Receiver::decode(std::stop_token token)
+    {
+        while (auto frame = m_received.take(token)) {
+            auto image = Sequence::decode(frame->data, m_socket);
+            if (not image) {
+                continue;
+            }
+
+            auto sent    = Clock::time_point{ std::chrono::nanoseconds{ frame->sent } };
+            auto decoded = Frame{ .number = frame->number, .sent = sent, .image = std::move(image) };
+
+            m_decoded.put(std::move(decoded));
+        }
+    }
+
+    bool send(const fs::path& socket, const std::vector<fs::path>& files, double fps)
+    {
+        auto addr = make_address(socket);
+        if (not addr) {
+            return false;
+        }
+
+        auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        } else if (::connect(fd, reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) < 0) {
+            ::close(fd);
+            return false;
+        }
+
+        // read once up front, so that the frame rate doesn't depend on the disk
+        auto frames = std::vector<qoipp::ByteVec>{};
+        for (const auto& file : files) {
+            auto stream = std::ifstream{ file, std::ios::binary };
+            frames.emplace_back(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+        }
+
+        auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{ 1.0 / fps });
+        auto next     = Clock::now();
+        auto sent     = 0uz;
+
+        while (not frames.empty()) {
+            const auto& frame = frames[sent % frames.size()];
+
+            auto header = std::array<qoipp::Byte, header_size>{};
+            store_le(header, static_cast<std::uint32_t>(frame.size()));
+            store_le(std::span{ header }.subspan(4), now_ns());
+
+            if (not write_all(fd, header) or not write_all(fd, frame)) {
+                break;    // the viewer went away
+            }
+
+            ++sent;
+            next += interval;
+            std::this_thread::sleep_until(next);
+        }
+
+        spdlog::info("Sent {} frames", sent);
+        ::close(fd);
+
+        return true;
+    }
+}
+
+#else
+
+namespace qoiview::feed
+{
+    Receiver::Receiver(fs::path socket)
+        : m_socket{ std::move(socket) }
+    {
+        throw std::runtime_error{ "Live feeds are not supported on this platform" };
+    }
+
+    Receiver::~Receiver() = default;
+
+    bool send(const fs::path&, const std::vector<fs::path>&, double)
+    {
+        return false;
+    }
+}
+
+#endif
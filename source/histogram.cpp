@@ -0,0 +1,187 @@
+#include "qoiview/histogram.hpp"
+#include "qoiview/archive.hpp"
+#include "qoiview/pipeline.hpp"
+
+#include <fmt/format.h>
+#include <qoipp/stream.hpp>
+
+#include <cassert>
+#include <mutex>
+
+namespace
+{
+    using qoipp::Byte;
+    using Counts = qoiview::Histogram::Counts;
+
+    // rows decoded at a time when reading a file
+    constexpr auto band_rows = 64uz;
+
+    // pixels counted before the 32-bit tables are flushed, well below overflow
+    constexpr auto flush_pixels = 1uz << 24;
+
+    // histograms don't vectorize, and consecutive equal values (common in QOI) increment the same counter back to
+    // back; alternating pixels between two sets of tables halves those dependency chains
+    template <std::size_t N>
+    void count(std::array<Counts, qoiview::Histogram::max_channels>& out, const Byte* data, std::size_t pixels)
+    {
+        auto tables = std::array<std::array<std::uint32_t, 256>, N * 2>{};
+
+        for (auto start = 0uz; start < pixels; start += flush_pixels) {
+            auto end = std::min(start + flush_pixels, pixels);
+            auto i   = start;
+
+            for (; i + 2 <= end; i += 2) {
+                const auto* px = data + i * N;
+                for (auto c = 0uz; c < N; ++c) {
+                    ++tables[c][px[c]];
+                    ++tables[N + c][px[N + c]];
+                }
+            }
+            if (i < end) {
+                const auto* px = data + i * N;
+                for (auto c = 0uz; c < N; ++c) {
+                    ++tables[c][px[c]];
+                }
+            }
+
+            for (auto c = 0uz; c < N; ++c) {
+                for (auto v = 0uz; v < 256; ++v) {
+                    out[c][v] += tables[c][v] + tables[N + c][v];
+                }
+                tables[c]     = {};
+                tables[N + c] = {};
+            }
+        }
+    }
+}
+
+namespace qoiview
+{
+    Histogram::Histogram(std::size_t channels)
+        : m_channels{ channels }
+    {
+        assert(channels >= 1 and channels <= max_channels);
+    }
+
+    Histogram Histogram::compute(ThreadPool& pool, qoipp::ByteCSpan data, std::size_t channels)
+    {
+        auto result = Histogram{ channels };
+        auto mutex  = std::mutex{};
+        auto pixels = data.size() / channels;
+
+        pool.parallel_for(pixels, [&](std::size_t begin, std::size_t end) {
+            auto partial = Histogram{ channels };
+            partial.add(data.subspan(begin * channels, (end - begin) * channels));
+
+            auto lock  = std::unique_lock{ mutex };
+            result    += partial;
+        });
+
+        return result;
+    }
+
+    qoipp::Result<Histogram> Histogram::compute(const fs::path& file)
+    {
+        auto input = archive::Input{};
+        if (auto opened = archive::open_input(input, file); not opened) {
+            return qoipp::make_error<Histogram>(opened.error());
+        }
+
+        const auto& desc = input.desc;
+
+        auto channels = static_cast<std::size_t>(desc.channels);
+        auto stride   = desc.width * channels;
+        auto band     = qoipp::ByteVec(stride * std::clamp(band_rows, 1uz, std::max<std::size_t>(desc.height, 1)));
+
+        auto histogram = Histogram{ channels };
+
+        auto strips = pipeline::decode_strips(input.decoder, std::move(input.reader), band, stride, desc.height, {});
+        for (auto&& strip : strips) {
+            if (not strip) {
+                return qoipp::make_error<Histogram>(strip.error());
+            }
+            histogram.add(strip->pixels);
+        }
+
+        return histogram;
+    }
+
+    void Histogram::add(qoipp::ByteCSpan data)
+    {
+        assert(data.size() % m_channels == 0);
+
+        auto pixels = data.size() / m_channels;
+        switch (m_channels) {
+        case 1: count<1>(m_counts, data.data(), pixels); break;
+        case 2: count<2>(m_counts, data.data(), pixels); break;
+        case 3: count<3>(m_counts, data.data(), pixels); break;
+        case 4: count<4>(m_counts, data.data(), pixels); break;
+        }
+
+        m_pixels += pixels;
+    }
+
+    Histogram& Histogram::operator+=(const Histogram& other)
+    {
+        assert(m_channels == other.m_channels);
+
+        for (auto c = 0uz; c < m_channels; ++c) {
+            for (auto v = 0uz; v < 256; ++v) {
+                m_counts[c][v] += other.m_counts[c][v];
+            }
+        }
+        m_pixels += other.m_pixels;
+
+        return *this;
+    }
+
+    std::uint8_t Histogram::min(std::size_t channel) const
+    {
+        const auto& counts = m_counts[channel];
+        auto        value  = sr::find_if(counts, [](std::uint64_t count) { return count > 0; }) - counts.begin();
+        return static_cast<std::uint8_t>(std::min(value, std::ptrdiff_t{ 255 }));
+    }
+
+    std::uint8_t Histogram::max(std::size_t channel) const
+    {
+        const auto& counts = m_counts[channel];
+        for (auto v = 255uz; v > 0; --v) {
+            if (counts[v] > 0) {
+                return static_cast<std::uint8_t>(v);
+            }
+        }
+        return 0;
+    }
+
+    double Histogram::mean(std::size_t channel) const
+    {
+        if (m_pixels == 0) {
+            return 0.0;
+        }
+
+        const auto& counts = m_counts[channel];
+
+        auto sum = 0.0;
+        for (auto v = 0uz; v < 256; ++v) {
+            sum += static_cast<double>(v) * static_cast<double>(counts[v]);
+        }
+        return sum / static_cast<double>(m_pixels);
+    }
+
+    std::string Histogram::describe(std::size_t channel) const
+    {
+        auto percent = [&](std::size_t value) {
+            auto count = static_cast<double>(m_counts[channel][value]);
+            return m_pixels == 0 ? 0.0 : 100.0 * count / static_cast<double>(m_pixels);
+        };
+
+        return fmt::format(
+            "min {:>3}, max {:>3}, mean {:>6.2f}, clipped {:.3f}% low {:.3f}% high",
+            min(channel),
+            max(channel),
+            mean(channel),
+            percent(0),
+            percent(255)
+        );
+    }
+}
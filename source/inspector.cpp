@@ -0,0 +1,67 @@
+#include "qoiview/inspector.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+
+namespace qoiview
+{
+    std::optional<std::array<qoipp::Byte, 4>> Inspector::pixel(const Image& image, Vec2<int> at, std::size_t rows)
+    {
+        auto width  = static_cast<int>(image.desc.width);
+        auto height = static_cast<int>(std::min<std::size_t>(image.desc.height, rows));
+
+        if (at.x < 0 or at.y < 0 or at.x >= width or at.y >= height) {
+            return std::nullopt;
+        }
+
+        auto index  = (static_cast<std::size_t>(at.y) * image.desc.width + static_cast<std::size_t>(at.x)) * 4;
+        auto pixels = image.pixels();
+
+        return std::array{ pixels[index], pixels[index + 1], pixels[index + 2], pixels[index + 3] };
+    }
+
+    bool Inspector::submit(std::shared_ptr<const Image> image, raster::Rect rect)
+    {
+        if (busy()) {
+            return false;
+        }
+
+        auto width  = static_cast<int>(image->desc.width);
+        auto height = static_cast<int>(image->desc.height);
+
+        auto x0 = std::clamp(rect.x, 0, width);
+        auto y0 = std::clamp(rect.y, 0, height);
+        auto x1 = std::clamp(rect.x + rect.width, 0, width);
+        auto y1 = std::clamp(rect.y + rect.height, 0, height);
+
+        rect = { x0, y0, x1 - x0, y1 - y0 };
+        if (rect.empty()) {
+            return false;
+        }
+
+        // the pool is only borrowed for the reduction itself, a worker never waits on other workers
+        m_busy.store(true, std::memory_order::release);
+        m_thread = std::jthread{ [this, image = std::move(image), rect] {
+            auto start  = std::chrono::steady_clock::now();
+            auto region = metrics::summarize(m_pool, *image, rect);
+
+            auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            spdlog::debug("Selection of {} pixels summarized in {:.2f} ms", region.pixels, ms);
+
+            {
+                auto lock = std::scoped_lock{ m_mutex };
+                m_result  = Selection{ rect, region };
+            }
+            m_busy.store(false, std::memory_order::release);
+        } };
+
+        return true;
+    }
+
+    std::optional<Inspector::Selection> Inspector::poll()
+    {
+        auto lock = std::scoped_lock{ m_mutex };
+        return std::exchange(m_result, std::nullopt);
+    }
+}
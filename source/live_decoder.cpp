@@ -0,0 +1,180 @@
+#include "qoiview/live_decoder.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__)
+#    include <poll.h>
+#    include <unistd.h>
+#endif
+
+namespace qoiview
+{
+#if defined(__unix__)
+    LiveDecoder::Source LiveDecoder::read_fd(int fd)
+    {
+        return [fd](qoipp::ByteSpan out, std::stop_token token) -> qoipp::Result<std::size_t> {
+            auto fds = pollfd{ .fd = fd, .events = POLLIN, .revents = 0 };
+
+            // a read after POLLIN returns what is buffered instead of waiting for `out` to fill up
+            while (not token.stop_requested()) {
+                if (auto ready = ::poll(&fds, 1, 100); ready == 0 or (ready < 0 and errno == EINTR)) {
+                    continue;
+                } else if (ready < 0) {
+                    spdlog::error("Failed to poll stream: {}", std::strerror(errno));
+                    return qoipp::make_error<std::size_t>(qoipp::Error::IoError);
+                }
+
+                auto count = ::read(fd, out.data(), out.size());
+                if (count < 0 and (errno == EINTR or errno == EAGAIN)) {
+                    continue;
+                } else if (count < 0) {
+                    spdlog::error("Failed to read stream: {}", std::strerror(errno));
+                    return qoipp::make_error<std::size_t>(qoipp::Error::IoError);
+                }
+
+                return static_cast<std::size_t>(count);
+            }
+
+            return 0uz;
+        };
+    }
+#else
+    LiveDecoder::Source LiveDecoder::read_fd(int)
+    {
+        throw std::runtime_error{ "Reading a stream is not supported on this platform" };
+    }
+#endif
+
+    LiveDecoder::LiveDecoder(Source source, std::string name)
+        : m_source{ std::move(source) }
+        , m_name{ std::move(name) }
+        , m_thread{ [this](std::stop_token token) { run(token); } }
+    {
+    }
+
+    void LiveDecoder::run(std::stop_token token)
+    {
+        auto buffer  = qoipp::ByteVec(read_size);
+        auto pending = 0uz;    // unconsumed bytes carried over to the front of the buffer
+
+        auto image   = std::shared_ptr<Image>{};    // being decoded, null between two images
+        auto stride  = 0uz;
+        auto written = 0uz;
+        auto pushed  = 0uz;    // rows published so far
+        auto skip    = 0uz;    // bytes of the previous image's end marker still to come
+
+        auto fail = [&](qoipp::Error error) {
+            spdlog::error("Failed to decode {}: {}", m_name, to_string(error));
+            m_channel.push({ .id = m_id, .payload = AsyncDecoder::Failed{ error } }, token);
+        };
+
+        // rows completed since the last band, a partial row is only published at the end of a truncated image
+        auto push_rows = [&](bool partial) {
+            auto lines = partial ? (written + stride - 1) / stride : written / stride;
+            if (lines <= pushed) {
+                return true;
+            }
+
+            auto data = std::span{ image->data }.subspan(pushed * stride, (lines - pushed) * stride);
+            auto band = AsyncDecoder::Band{ .data = data, .start = pushed, .count = lines - pushed };
+            pushed    = lines;
+
+            return m_channel.push({ .id = m_id, .payload = band }, token);
+        };
+
+        auto finish = [&](bool truncated) {
+            spdlog::debug("Stream image {} complete{}", m_id, truncated ? " (trunc)" : "");
+            image.reset();
+            return m_channel.push({ .id = m_id, .payload = AsyncDecoder::Finished{ truncated } }, token);
+        };
+
+        while (not token.stop_requested()) {
+            auto read = m_source(std::span{ buffer }.subspan(pending), token);
+            if (not read) {
+                fail(read.error());
+                break;
+            } else if (read.value() == 0) {
+                if (image and push_rows(true)) {
+                    finish(true);
+                } else if (not image and pending > 0 and skip == 0) {
+                    fail(qoipp::Error::TooShort);    // the header of the next image was cut off
+                }
+                break;
+            }
+
+            auto in = qoipp::ByteCSpan{ buffer }.first(pending + read.value());
+
+            while (not in.empty()) {
+                if (not image) {
+                    if (skip > 0) {
+                        auto count  = std::min(skip, in.size());
+                        in          = in.subspan(count);
+                        skip       -= count;
+                        continue;
+                    } else if (in.size() < qoipp::constants::header_size) {
+                        break;
+                    }
+
+                    auto desc = m_decoder.initialize(in.first(qoipp::constants::header_size), qoipp::Channels::RGBA);
+                    if (not desc) {
+                        fail(desc.error());
+                        m_ended.store(true, std::memory_order::release);
+                        return;
+                    }
+
+                    in = in.subspan(qoipp::constants::header_size);
+
+                    // a new buffer every time, the view switches to it right away and draws its rows as they arrive,
+                    // while the previous image stays intact for whoever still holds it
+                    image       = std::make_shared<Image>();
+                    image->desc = desc.value();
+                    image->data.resize(std::size_t{ desc->width } * desc->height * 4, 0x00);
+
+                    stride  = std::size_t{ desc->width } * 4;
+                    written = 0;
+                    pushed  = 0;
+
+                    m_channel.push({ .id = ++m_id, .payload = AsyncDecoder::Prepared{ image->desc, image } }, token);
+                    continue;
+                }
+
+                auto out = std::span{ image->data }.subspan(written);
+                auto res = m_decoder.decode(out, in);
+                if (not res) {
+                    fail(res.error());
+                    m_ended.store(true, std::memory_order::release);
+                    return;
+                }
+
+                written += res->written;
+                in       = in.subspan(res->processed);
+
+                while (m_decoder.has_run_count() and written < image->data.size()) {
+                    written += m_decoder.drain_run(std::span{ image->data }.subspan(written)).value();
+                }
+
+                if (written == image->data.size()) {
+                    skip = qoipp::constants::end_marker_size;
+                    if (not push_rows(false) or not finish(false)) {
+                        break;
+                    }
+                } else if (res->processed == 0) {
+                    break;    // an op is split between two reads
+                }
+            }
+
+            if (image and not push_rows(false)) {
+                break;
+            }
+
+            // the head of a split op or header goes in front of the next read
+            pending = in.size();
+            std::memmove(buffer.data(), in.data(), pending);
+        }
+
+        m_ended.store(true, std::memory_order::release);
+    }
+}
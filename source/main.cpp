@@ -1,6 +1,19 @@
+#include "qoiview/archive.hpp"
+#include "qoiview/batch.hpp"
+#include "qoiview/daemon.hpp"
+#include "qoiview/feed.hpp"
+#include "qoiview/histogram.hpp"
+#include "qoiview/player.hpp"
 #include "qoiview/qoiview.hpp"
+#include "qoiview/shared_cache.hpp"
+#include "qoiview/thumbnail.hpp"
+
+#if defined(QOIVIEW_SOFTWARE_RENDERER)
+#    include "qoiview/soft_view.hpp"
+#endif
 
 #include <CLI/CLI.hpp>
+#include <fmt/ranges.h>
 #include <glbinding/glbinding.h>
 #include <qoipp/simple.hpp>
 #include <spdlog/sinks/null_sink.h>
@@ -8,17 +21,30 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <filesystem>
 #include <limits>
 #include <map>
+#include <mutex>
+
+#if defined(__unix__)
+#    include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 namespace sv = std::views;
 namespace sr = std::ranges;
 
 using qoiview::Color;
+using qoiview::DecodedCache;
 using qoiview::QoiView;
+using qoiview::SharedCache;
+using qoiview::daemon::Request;
+using qoiview::daemon::Server;
 
 enum class Sort
 {
@@ -35,19 +61,121 @@ struct Inputs
 
 struct Args
 {
-    Inputs inputs;
-    Color  background;
-    int    width;
-    int    height;
+    Request         request;    // the files and the window, all a daemon is handed
+    bool            daemon;
+    bool            standalone;
+    bool            software;
+    bool            compare;
+    std::uint8_t    threshold;
+    std::size_t     cache_size;
+    std::size_t     shared_size;
+
+    std::optional<fs::path> thumbnails;
+    std::uint32_t           thumbnail_size;
+
+    std::vector<fs::path> compare_dirs;    // empty, or the two directories
+    std::size_t           report_size;
+
+    bool stats;
+    bool bins;
+
+    std::optional<double> fps;
+    qoiview::Player::Mode playback;
+    std::size_t           preload_size;
+
+    bool stream;    // read the images from stdin
+    bool follow;
+
+    std::optional<fs::path> listen;    // show the frames pushed to this socket
+    std::optional<fs::path> send;      // push the files to a viewer listening on this socket
+
+    std::size_t vram_size;      // for the textures of recently shown and upcoming images
+    bool        etc2;           // keep the last images shown on the GPU compressed
+    std::size_t memory_size;    // larger images are shown from tiles within this much memory
+};
+
+// directory listings kept by the daemon, a directory is only rescanned when its modification time changes
+struct Listing
+{
+    fs::file_time_type    time;
+    std::vector<fs::path> files;
 };
 
+using DirectoryIndex = std::map<fs::path, Listing>;
+
 static inline const auto sort_map = std::map<std::string, Sort>{
     { "name", Sort::Name },
     { "date", Sort::Date },
     { "size", Sort::Size },
 };
 
-std::optional<Inputs> get_qoi_files(std::span<const fs::path> inputs)
+// frame rate of --send without --fps
+static inline constexpr auto send_fps = 30.0;
+
+// window size for a stream or feed, unless given by --width or --height
+static inline constexpr auto stream_window = qoiview::Vec2<std::size_t>{ 800, 600 };
+
+static inline const auto playback_map = std::map<std::string, qoiview::Player::Mode>{
+    { "loop", qoiview::Player::Mode::Loop },
+    { "ping-pong", qoiview::Player::Mode::PingPong },
+    { "once", qoiview::Player::Mode::Once },
+};
+
+// the default of --memory, 0 (never tile) where the size of the physical memory isn't known
+std::size_t half_of_memory()
+{
+#if defined(__unix__)
+    auto pages = ::sysconf(_SC_PHYS_PAGES);
+    auto size  = ::sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 and size > 0) {
+        return static_cast<std::size_t>(pages) * static_cast<std::size_t>(size) / 2;
+    }
+#endif
+    return 0;
+}
+
+std::vector<fs::path> list_directory(const fs::path& dir, DirectoryIndex* index)
+{
+    auto is_qoi = [](const fs::directory_entry& entry) { return entry.is_regular_file(); };
+    auto time   = fs::last_write_time(dir);
+
+    if (index != nullptr) {
+        if (auto it = index->find(dir); it != index->end() and it->second.time == time) {
+            spdlog::debug("Directory index hit: {}", dir.c_str());
+            return it->second.files;
+        }
+    }
+
+    auto files = std::vector<fs::path>{};
+    for (const auto& entry : fs::directory_iterator(dir) | sv::filter(is_qoi)) {
+        files.push_back(fs::relative(entry.path()));
+    }
+
+    if (index != nullptr) {
+        (*index)[dir] = Listing{ .time = time, .files = files };
+    }
+
+    return files;
+}
+
+// members are browsed like the files of a directory, read in place from the archive
+std::vector<fs::path> list_archive(const fs::path& archive)
+{
+    auto base  = fs::relative(fs::canonical(archive));
+    auto files = std::vector<fs::path>{};
+
+    try {
+        for (const auto& member : qoiview::archive::members(archive)) {
+            files.push_back(base / member.name);
+        }
+    } catch (const std::runtime_error& e) {
+        fmt::println(stderr, "{}", e.what());
+    }
+
+    return files;
+}
+
+std::optional<Inputs> get_qoi_files(std::span<const fs::path> inputs, DirectoryIndex* index)
 {
     auto result          = std::optional<Inputs>{ std::in_place };
     auto& [files, start] = result.value();
@@ -61,18 +189,19 @@ std::optional<Inputs> get_qoi_files(std::span<const fs::path> inputs)
             fmt::println(stderr, "No such file or directory '{}'", input.c_str());
             return {};
         } else if (fs::is_directory(input)) {
-            for (auto file : fs::directory_iterator(input) | sv::filter(is_qoi)) {
-                files.push_back(fs::relative(file));
-            }
+            sr::copy(list_directory(fs::canonical(input), index), std::back_inserter(files));
             if (files.empty()) {
                 fmt::println(stderr, "No valid qoi files found in '{}' directory", input.c_str());
                 return {};
             }
-        } else if (fs::is_regular_file(input)) {
-            auto parent = fs::directory_iterator{ fs::canonical(input).parent_path() };
-            for (auto input : parent | sv::filter(is_qoi)) {
-                files.push_back(fs::relative(input));
+        } else if (qoiview::archive::is_archive(input)) {
+            sr::copy(list_archive(input), std::back_inserter(files));
+            if (files.empty()) {
+                fmt::println(stderr, "No valid qoi files found in '{}' archive", input.c_str());
+                return {};
             }
+        } else if (fs::is_regular_file(input)) {
+            sr::copy(list_directory(fs::canonical(input).parent_path(), index), std::back_inserter(files));
             auto is_input = [&](const fs::path& path) { return fs::equivalent(path, input); };
             start         = static_cast<std::size_t>(sr::find_if(files, is_input) - files.begin());
         } else {
@@ -92,82 +221,41 @@ std::optional<Inputs> get_qoi_files(std::span<const fs::path> inputs)
     return result;
 }
 
-std::variant<Args, int> parse_args(int argc, char** argv)
+std::optional<Inputs> resolve_inputs(const Request& request, DirectoryIndex* index)
 {
-    auto app = CLI::App{ "QoiView - A simple qoi image viewer", "qoiview" };
-
-    auto files      = std::vector<fs::path>{};
-    auto sort       = Sort::Name;
-    auto background = std::string{ "222436" };
-    auto reverse    = false;
-    auto single     = false;
-    auto width      = 0;
-    auto height     = 0;
-    auto debug      = false;
-    auto verbose    = false;
-
-    auto check_hex = [](std::string_view hex) {
-        auto msg = "invalid color hex";
-        if (hex.size() != 6 or not sr::all_of(hex, [](char c) { return std::isxdigit(c); })) {
-            return msg;
-        }
-        return "";
-    };
-
-    app.set_version_flag("-v,--version", QOIVIEW_VERSION_STRING);
-    app.add_option("files", files, "Input qoi file or directory")->required()->check(CLI::ExistingPath);
-    app.add_option("-W,--width", width, "Width of the window")->transform(CLI::NonNegativeNumber);
-    app.add_option("-H,--height", height, "Height of the window")->transform(CLI::NonNegativeNumber);
-    app.add_option("-S,--sort", sort, "Sort the files")->transform(CLI::CheckedTransformer(sort_map));
-    app.add_option("-b,--background", background, "Set background color (6-digit hex)")
-        ->check(check_hex)
-        ->default_val(background);
-    app.add_flag("-r,--reverse", reverse, "Reverse sort");
-    app.add_flag("-s,--single", single, "Run in single file mode");
-
-    auto verbose_opt = app.add_flag("--verbose", verbose, "Print additional output");
-    app.add_flag("--debug", debug, "Print debug outputs")->excludes(verbose_opt);
-
-    if (argc == 1) {
-        fmt::print(stderr, "{}", app.help());
-        return 1;
-    }
-
-    CLI11_PARSE(app, argc, argv);
-
-    if (not verbose and not debug) {
-        spdlog::set_default_logger(spdlog::null_logger_mt("qoiview-log"));
-        spdlog::set_level(spdlog::level::off);
-    } else if (verbose) {
-        spdlog::set_default_logger(spdlog::stderr_color_mt("qoiview-log"));
-        spdlog::set_level(spdlog::level::info);
-    } else if (debug) {
-        spdlog::set_default_logger(spdlog::stderr_color_mt("qoiview-log"));
-        spdlog::set_level(spdlog::level::debug);
-    }
-    spdlog::set_pattern("[qoiview] [%^%L%$] %v");
+    // the window options only matter to whoever opens the window
+    const auto& [files, sort_str, reverse, single]
+        = std::tie(request.files, request.sort, request.reverse, request.single);
 
+    auto sort   = sort_map.at(sort_str);
     auto inputs = std::optional<Inputs>{};
+
     if (single and files.size() != 1) {
         fmt::println(stderr, "Single mode is requested but multiple files is provided");
-        return 1;
+        return {};
     } else if (single) {
         auto path = files.front();
         inputs    = Inputs{ .files = { path }, .start = 0 };
     } else {
-        inputs = get_qoi_files(files);
+        inputs = get_qoi_files(files, index);
     }
 
     if (not inputs.has_value()) {
-        return 1;
+        return {};
     }
 
     auto comp_name = [&](const fs::path& l, const fs::path& r) -> bool { return (l < r) ^ reverse; };
+
+    // members of an archive have no size or time on the filesystem
+    auto status = [](const fs::path& path) {
+        return qoiview::archive::status(path).value_or(qoiview::archive::Status{});
+    };
+
     auto comp_size = [&](const fs::path& l, const fs::path& r) -> bool {
-        return (fs::file_size(l) < fs::file_size(r)) ^ reverse;
+        return (status(l).size < status(r).size) ^ reverse;
     };
     auto comp_date = [&](const fs::path& l, const fs::path& r) -> bool {
-        return (fs::last_write_time(l) < fs::last_write_time(r)) ^ reverse;
+        return (status(l).time < status(r).time) ^ reverse;
     };
 
     auto comp = [&](const fs::path& l, const fs::path& r) -> bool {
@@ -211,6 +299,168 @@ std::variant<Args, int> parse_args(int argc, char** argv)
         );
     }
 
+    return inputs;
+}
+
+std::variant<Args, int> parse_args(int argc, char** argv)
+{
+    auto app = CLI::App{ "QoiView - A simple qoi image viewer", "qoiview" };
+
+    auto files      = std::vector<fs::path>{};
+    auto sort       = std::string{ "name" };
+    auto background = std::string{ "222436" };
+    auto reverse    = false;
+    auto single     = false;
+    auto width      = 0;
+    auto height     = 0;
+    auto debug      = false;
+    auto verbose    = false;
+    auto daemon     = false;
+    auto standalone = false;
+    auto software   = false;
+    auto compare    = false;
+    auto threshold  = 0;
+    auto cache_size = std::optional<std::size_t>{};
+    auto shared     = 0uz;
+    auto thumbnails = std::optional<fs::path>{};
+    auto thumb_size = 256u;
+    auto dirs       = std::vector<fs::path>{};
+    auto report     = 20uz;
+    auto stats      = false;
+    auto bins       = false;
+    auto fps        = std::optional<double>{};
+    auto playback   = std::string{ "loop" };
+    auto preload    = 0uz;
+    auto follow     = false;
+    auto listen     = std::optional<fs::path>{};
+    auto send       = std::optional<fs::path>{};
+    auto vram       = 256uz;
+    auto etc2       = false;
+    auto memory     = std::optional<std::size_t>{};
+
+    auto check_hex = [](std::string_view hex) {
+        auto msg = "invalid color hex";
+        if (hex.size() != 6 or not sr::all_of(hex, [](char c) { return std::isxdigit(c); })) {
+            return msg;
+        }
+        return "";
+    };
+
+    auto check_sort = [](const std::string& str) {
+        return sort_map.contains(str) ? "" : "must be one of: name, date, size";
+    };
+
+    auto check_playback = [](const std::string& str) {
+        return playback_map.contains(str) ? "" : "must be one of: loop, ping-pong, once";
+    };
+
+    app.set_version_flag("-v,--version", QOIVIEW_VERSION_STRING);
+    app.add_option("files", files, "Input qoi file or directory, - for a stream of images on stdin")
+        ->check(CLI::ExistingPath | CLI::IsMember({ "-" }));
+    app.add_option("-W,--width", width, "Width of the window")->transform(CLI::NonNegativeNumber);
+    app.add_option("-H,--height", height, "Height of the window")->transform(CLI::NonNegativeNumber);
+    app.add_option("-S,--sort", sort, "Sort the files (name, date, size)")->check(check_sort);
+    app.add_option("-b,--background", background, "Set background color (6-digit hex)")
+        ->check(check_hex)
+        ->default_val(background);
+    app.add_flag("-r,--reverse", reverse, "Reverse sort");
+    auto single_opt = app.add_flag("-s,--single", single, "Run in single file mode");
+    app.add_option("--cache-size", cache_size, "Decoded image cache size in MiB (default: 0, 1024 in daemon)");
+    app.add_option("--shared-cache", shared, "Share decoded images with other instances, size in MiB (default: 0)");
+
+    auto daemon_opt = app.add_flag("--daemon", daemon, "Keep running in the background and open forwarded files");
+    app.add_flag("--standalone", standalone, "Don't hand the files over to a running daemon")->excludes(daemon_opt);
+
+    auto thumb_opt = app.add_option("--thumbnails", thumbnails, "Write thumbnails of the files into a directory")
+                         ->excludes(daemon_opt);
+    app.add_option("--size", thumb_size, "Thumbnail bounding box in pixels (default: 256)")
+        ->check(CLI::PositiveNumber)
+        ->needs(thumb_opt);
+
+    auto compare_opt = app.add_flag("--compare", compare, "Show 2 to 4 files side by side with shared pan and zoom")
+                           ->excludes(daemon_opt, single_opt, thumb_opt);
+    auto dirs_opt = app.add_option("--compare-dirs", dirs, "Compare the files of the same name in two directories")
+                        ->expected(2)
+                        ->check(CLI::ExistingDirectory)
+                        ->excludes(daemon_opt, single_opt, thumb_opt, compare_opt);
+    app.add_option("--report", report, "Number of worst frames listed by --compare-dirs (default: 20)")
+        ->needs(dirs_opt);
+    auto stats_opt = app.add_flag("--stats", stats, "Print per-channel statistics of the files")
+                         ->excludes(daemon_opt, thumb_opt, compare_opt, dirs_opt);
+    app.add_flag("--bins", bins, "Also print the 256 histogram bins of every channel")->needs(stats_opt);
+    auto fps_opt = app.add_option("--fps", fps, "Play the files as a sequence at this frame rate")
+                       ->check(CLI::PositiveNumber)
+                       ->excludes(daemon_opt, single_opt, thumb_opt, compare_opt, dirs_opt, stats_opt);
+    app.add_option("--playback", playback, "How the sequence repeats (loop, ping-pong, once)")
+        ->check(check_playback)
+        ->needs(fps_opt);
+    app.add_option("--preload", preload, "Load the whole sequence into memory before playing, budget in MiB")
+        ->check(CLI::PositiveNumber)
+        ->needs(fps_opt);
+    [[maybe_unused]] auto follow_opt
+        = app.add_flag("--follow", follow, "Keep decoding files that are still being written as they grow")
+              ->excludes(daemon_opt, thumb_opt, dirs_opt, stats_opt, fps_opt);
+    auto listen_opt = app.add_option("--listen", listen, "Show the frames pushed to a Unix socket as they arrive")
+                          ->excludes(daemon_opt, thumb_opt, compare_opt, dirs_opt, stats_opt, fps_opt, follow_opt);
+    app.add_option("--send", send, "Push the files to a viewer listening on a Unix socket, at --fps (default: 30)")
+        ->excludes(daemon_opt, thumb_opt, compare_opt, dirs_opt, stats_opt, follow_opt, listen_opt);
+    app.add_option("--vram", vram, "GPU memory for textures of recent and upcoming images in MiB (default: 256)");
+    [[maybe_unused]] auto etc2_opt
+        = app.add_flag("--etc2", etc2, "Keep the last images shown on the GPU as ETC2, drawn while they decode")
+              ->excludes(thumb_opt, dirs_opt, stats_opt, listen_opt);
+    app.add_option(
+        "--memory",
+        memory,
+        "Show images larger than this decoded from tiles paged in from disk, within as much memory, in MiB "
+        "(default: half of RAM, 0 to never tile)"
+    );
+    app.add_option("--threshold", threshold, "Largest channel difference still counted as equal (default: 0)")
+        ->check(CLI::Range(0, 255));
+
+#if defined(QOIVIEW_SOFTWARE_RENDERER)
+    app.add_flag("--software", software, "Render on the CPU instead of OpenGL ES (X11/XWayland)")
+        ->excludes(daemon_opt, compare_opt, fps_opt, follow_opt, listen_opt, etc2_opt);
+#endif
+
+    auto verbose_opt = app.add_flag("--verbose", verbose, "Print additional output");
+    app.add_flag("--debug", debug, "Print debug outputs")->excludes(verbose_opt);
+
+    if (argc == 1) {
+        fmt::print(stderr, "{}", app.help());
+        return 1;
+    }
+
+    CLI11_PARSE(app, argc, argv);
+
+    auto stream = sr::find(files, fs::path{ "-" }) != files.end();
+
+    if (not daemon and not listen and dirs.empty() and files.empty()) {
+        fmt::println(stderr, "files is required");
+        return 1;
+    } else if (compare and (files.size() < 2 or files.size() > 4)) {
+        fmt::println(stderr, "Compare mode takes 2 to 4 files");
+        return 1;
+    } else if (stream and (files.size() > 1 or daemon or compare or fps or stats or thumbnails or software or follow
+                           or listen or send)) {
+        fmt::println(stderr, "A stream on stdin (-) can only be viewed on its own");
+        return 1;
+    } else if (listen and not files.empty()) {
+        fmt::println(stderr, "A feed (--listen) is viewed without files");
+        return 1;
+    }
+
+    if (not verbose and not debug) {
+        spdlog::set_default_logger(spdlog::null_logger_mt("qoiview-log"));
+        spdlog::set_level(spdlog::level::off);
+    } else if (verbose) {
+        spdlog::set_default_logger(spdlog::stderr_color_mt("qoiview-log"));
+        spdlog::set_level(spdlog::level::info);
+    } else if (debug) {
+        spdlog::set_default_logger(spdlog::stderr_color_mt("qoiview-log"));
+        spdlog::set_level(spdlog::level::debug);
+    }
+    spdlog::set_pattern("[qoiview] [%^%L%$] %v");
+
     auto to_color = [](std::string_view hex) {
         assert(hex.size() == 6);
         auto color = Color{};
@@ -223,46 +473,76 @@ std::variant<Args, int> parse_args(int argc, char** argv)
         return color;
     };
 
+    // paths must stay valid when resolved by a daemon running in another directory
+    auto absolute = files | sv::transform([](const fs::path& path) {
+                        return path == "-" ? path : fs::absolute(path);
+                    });
+
     return Args{
-        .inputs     = std::move(inputs).value(),
-        .background = to_color(background),
-        .width      = width,
-        .height     = height,
-    };
-}
+        .request = {
+            .files      = { absolute.begin(), absolute.end() },
+            .sort       = sort,
+            .reverse    = reverse,
+            .single     = single,
+            .width      = width,
+            .height     = height,
+            .background = to_color(background),
+        },
+        .daemon      = daemon,
+        .standalone  = standalone,
+        .software    = software,
+        .compare     = compare,
+        .threshold   = static_cast<std::uint8_t>(threshold),
+        .cache_size  = cache_size.value_or(daemon ? 1024 : 0) * 1024 * 1024,
+        .shared_size = shared * 1024 * 1024,
 
-int main(int argc, char** argv)
-try {
-    auto args = parse_args(argc, argv);
-    if (args.index() == 1) {
-        return std::get<1>(args);
-    }
+        .thumbnails     = thumbnails,
+        .thumbnail_size = thumb_size,
 
-    auto&& [inputs, background, width, height] = std::get<0>(args);
+        .compare_dirs = dirs,
+        .report_size  = report,
 
-    if (not glfwInit()) {
-        fmt::println(stderr, "Failed to initialize GLFW");
-        return 1;
-    }
+        .stats = stats,
+        .bins  = bins,
 
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
-    glfwWindowHintString(GLFW_WAYLAND_APP_ID, "qoiview");
-    glfwWindowHintString(GLFW_X11_CLASS_NAME, "qoiview");
-    glfwWindowHintString(GLFW_X11_INSTANCE_NAME, "qoiview");
+        .fps          = fps,
+        .playback     = playback_map.at(playback),
+        .preload_size = preload * 1024 * 1024,
 
-    auto* monitor = glfwGetPrimaryMonitor();
-    auto* mode    = glfwGetVideoMode(monitor);
+        .stream = stream,
+        .follow = follow,
+
+        .listen = listen,
+        .send   = send,
+
+        .vram_size   = vram * 1024 * 1024,
+        .etc2        = etc2,
+        .memory_size = memory ? *memory * 1024 * 1024 : half_of_memory(),
+    };
+}
+
+// every compared file must be valid, a missing one would shift the rest into the wrong viewport
+std::optional<Inputs> compare_inputs(const Request& request)
+{
+    for (const auto& file : request.files) {
+        if (auto res = qoiview::archive::read_header(file); not res) {
+            fmt::println(stderr, "Failed to open '{}' for comparison: {}", file.c_str(), to_string(res.error()));
+            return {};
+        }
+    }
+
+    return Inputs{ .files = { request.files.begin(), request.files.end() }, .start = 0 };
+}
 
-    auto header = qoipp::Desc{};
-    while (true) {
+// drop leading files that are not valid qoi, returns the size of the first valid one
+std::optional<qoiview::Vec2<std::size_t>> first_valid(Inputs& inputs)
+{
+    while (not inputs.files.empty()) {
         auto file = inputs.files[inputs.start];
-        if (auto res = qoipp::read_header(file); not res) {
+        if (auto res = qoiview::archive::read_header(file); not res) {
             spdlog::info("Failed to decode file {:?}: {}", file.c_str(), to_string(res.error()));
         } else {
-            header = *res;
-            break;
+            return qoiview::Vec2<std::size_t>{ res->width, res->height };
         }
 
         inputs.files.erase(inputs.files.begin() + static_cast<std::ptrdiff_t>(inputs.start));
@@ -272,19 +552,19 @@ try {
         inputs.start = inputs.start % inputs.files.size();
     }
 
-    if (inputs.files.empty()) {
-        fmt::println(stderr, "No valid QOI file found");
-        return 1;
-    }
+    return std::nullopt;
+}
 
+std::pair<int, int> fit_window(qoiview::Vec2<std::size_t> size, int width, int height, const GLFWvidmode* mode)
+{
     if (width <= 0 and height <= 0) {
-        width  = static_cast<int>(header.width);
-        height = static_cast<int>(header.height);
+        width  = static_cast<int>(size.x);
+        height = static_cast<int>(size.y);
     } else if (width <= 0) {
-        auto ratio = static_cast<float>(header.width) / static_cast<float>(header.height);
+        auto ratio = static_cast<float>(size.x) / static_cast<float>(size.y);
         width      = static_cast<int>(static_cast<float>(height) * ratio);
     } else if (height <= 0) {
-        auto ratio = static_cast<float>(header.width) / static_cast<float>(header.height);
+        auto ratio = static_cast<float>(size.x) / static_cast<float>(size.y);
         height     = static_cast<int>(static_cast<float>(width) / ratio);
     }
 
@@ -312,7 +592,69 @@ try {
         spdlog::warn("Window size is too small, changed to {}x{}", width, height);
     }
 
-    auto* window = glfwCreateWindow(width, height, "QoiView", nullptr, nullptr);
+    return { width, height };
+}
+
+void set_window_hints()
+{
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHintString(GLFW_WAYLAND_APP_ID, "qoiview");
+    glfwWindowHintString(GLFW_X11_CLASS_NAME, "qoiview");
+    glfwWindowHintString(GLFW_X11_INSTANCE_NAME, "qoiview");
+}
+
+// an unusable shared cache is not fatal, the instance just keeps its decoded images to itself
+std::unique_ptr<SharedCache> open_shared_cache(std::size_t size)
+{
+    if (size == 0) {
+        return nullptr;
+    }
+
+    try {
+        return std::make_unique<SharedCache>(size);
+    } catch (const std::exception& e) {
+        spdlog::warn("Shared cache disabled: {}", e.what());
+        return nullptr;
+    }
+}
+
+static inline auto g_terminate = std::atomic<bool>{ false };
+
+// the window and its GL context are created once and reused for every forwarded request
+int run_daemon(const Args& args)
+{
+    auto pending = std::optional<Request>{};
+    auto mutex   = std::mutex{};
+
+    auto server = Server{ qoiview::daemon::socket_path(), [&](Request request) {
+                                     auto lock = std::unique_lock{ mutex };
+                                     pending   = std::move(request);
+                                     glfwPostEmptyEvent();
+                                 } };
+
+    auto take_pending = [&] {
+        auto lock = std::unique_lock{ mutex };
+        return std::exchange(pending, std::nullopt);
+    };
+
+    auto terminate = [](int) { g_terminate = true; };
+    std::signal(SIGINT, terminate);
+    std::signal(SIGTERM, terminate);
+
+    if (not glfwInit()) {
+        fmt::println(stderr, "Failed to initialize GLFW");
+        return 1;
+    }
+
+    set_window_hints();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    auto* monitor = glfwGetPrimaryMonitor();
+    auto* mode    = glfwGetVideoMode(monitor);
+
+    auto* window = glfwCreateWindow(100, 100, "QoiView", nullptr, nullptr);
     if (window == nullptr) {
         fmt::println(stderr, "Failed to create GLFW window");
         glfwTerminate();
@@ -322,9 +664,394 @@ try {
     glfwMakeContextCurrent(window);
     glbinding::initialize(glfwGetProcAddress);
 
+    auto index  = DirectoryIndex{};
+    auto cache  = DecodedCache{ args.cache_size };
+    auto shared = open_shared_cache(args.shared_size);
+    cache.attach(shared.get());
+
+    // created for the first request, its shaders and buffers then serve every later one
+    auto view = std::optional<QoiView>{};
+
+    while (not g_terminate) {
+        glfwWaitEventsTimeout(0.5);
+
+        auto request = take_pending();
+        if (not request) {
+            continue;
+        }
+
+        auto inputs = resolve_inputs(*request, &index);
+        if (not inputs) {
+            continue;
+        }
+
+        auto size = first_valid(*inputs);
+        if (not size) {
+            continue;
+        }
+
+        auto [width, height] = fit_window(*size, request->width, request->height, mode);
+        glfwSetWindowSize(window, width, height);
+        glfwSetWindowShouldClose(window, GLFW_FALSE);
+        glfwShowWindow(window);
+        glfwFocusWindow(window);
+
+        if (view) {
+            view->open(std::move(inputs->files), inputs->start);
+        } else {
+            view.emplace(window, std::move(inputs->files), inputs->start, &cache);
+            view->set_texture_budget(args.vram_size);
+            view->set_transcode(args.etc2);
+            view->set_memory_limit(args.memory_size);
+
+            // requests arriving while a file is open replace it in the same window
+            view->on_frame([&](QoiView& current) {
+                if (g_terminate) {
+                    glfwSetWindowShouldClose(window, GLFW_TRUE);
+                    return;
+                }
+
+                auto request = take_pending();
+                if (not request) {
+                    return;
+                }
+
+                auto inputs = resolve_inputs(*request, &index);
+                auto size   = inputs ? first_valid(*inputs) : std::nullopt;
+                if (not size) {
+                    return;
+                }
+
+                auto [width, height] = fit_window(*size, request->width, request->height, mode);
+                glfwSetWindowSize(window, width, height);
+                current.set_background(request->background);
+                current.open(std::move(inputs->files), inputs->start);
+                glfwFocusWindow(window);
+            });
+        }
+
+        view->run(width, height, request->background);
+        glfwHideWindow(window);
+    }
+
+    view.reset();
+    glfwTerminate();
+    return 0;
+}
+
+// headless: decode, downsample and encode on every core, no window involved
+int run_thumbnails(const Args& args)
+{
+    auto request = args.request;
+
+    // a lone file means just that file here, not its whole directory like in the viewer
+    if (request.files.size() == 1 and fs::is_regular_file(request.files.front())
+        and not qoiview::archive::is_archive(request.files.front())) {
+        request.single = true;
+    }
+
+    auto inputs = resolve_inputs(request, nullptr);
+    if (not inputs) {
+        return 1;
+    }
+
+    auto outdir = args.thumbnails.value();
+    if (auto ec = std::error_code{}; not fs::create_directories(outdir, ec) and ec) {
+        fmt::println(stderr, "Failed to create directory '{}': {}", outdir.c_str(), ec.message());
+        return 1;
+    }
+
+    auto files = std::vector<fs::path>{ inputs->files.begin(), inputs->files.end() };
+    auto pool  = qoiview::ThreadPool{};
+    auto start = std::chrono::steady_clock::now();
+
+    auto [written, failed] = qoiview::thumbnail::generate(pool, files, outdir, args.thumbnail_size);
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fmt::println(
+        "{} thumbnails written in {:.2f}s ({:.1f} images/s, {} threads), {} failed",
+        written,
+        seconds,
+        static_cast<double>(written) / std::max(seconds, 1e-9),
+        pool.size(),
+        failed
+    );
+
+    return failed == 0 ? 0 : 1;
+}
+
+// headless: files are decoded band by band on every core and counted as they go
+int run_stats(const Args& args)
+{
+    auto request = args.request;
+
+    // a lone file means just that file here, not its whole directory like in the viewer
+    if (request.files.size() == 1 and fs::is_regular_file(request.files.front())
+        and not qoiview::archive::is_archive(request.files.front())) {
+        request.single = true;
+    }
+
+    auto inputs = resolve_inputs(request, nullptr);
+    if (not inputs) {
+        return 1;
+    }
+
+    auto files      = std::vector<fs::path>{ inputs->files.begin(), inputs->files.end() };
+    auto histograms = std::vector<qoipp::Result<qoiview::Histogram>>(files.size());
+    auto pool       = qoiview::ThreadPool{};
+    auto start      = std::chrono::steady_clock::now();
+
+    pool.for_each(files.size(), [&](std::size_t i) { histograms[i] = qoiview::Histogram::compute(files[i]); });
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto pixels  = 0.0;
+    auto failed  = 0uz;
+
+    for (auto i = 0uz; i < files.size(); ++i) {
+        const auto& file      = files[i];
+        const auto& histogram = histograms[i];
+
+        if (not histogram) {
+            fmt::println("{}: {}", file.c_str(), to_string(histogram.error()));
+            ++failed;
+            continue;
+        }
+
+        pixels += static_cast<double>(histogram->pixels());
+
+        fmt::println("{}: {} pixels", file.c_str(), histogram->pixels());
+        for (auto c = 0uz; c < histogram->channels(); ++c) {
+            fmt::println("    {}: {}", "RGBA"[c], histogram->describe(c));
+            if (args.bins) {
+                fmt::println("       {}", fmt::join(histogram->counts(c), " "));
+            }
+        }
+    }
+
+    fmt::println(
+        "{} files analyzed in {:.2f}s ({:.1f} MP/s, {} threads), {} failed",
+        files.size() - failed,
+        seconds,
+        pixels / 1e6 / std::max(seconds, 1e-9),
+        pool.size(),
+        failed
+    );
+
+    return failed == files.size() ? 1 : 0;
+}
+
+// headless: pairs are decoded band by band on every core, only the ranking is kept
+int run_compare_dirs(const Args& args)
+{
+    const auto& dir_a = args.compare_dirs[0];
+    const auto& dir_b = args.compare_dirs[1];
+
+    auto pool  = qoiview::ThreadPool{};
+    auto start = std::chrono::steady_clock::now();
+
+    auto report = qoiview::batch::compare_dirs(pool, dir_a, dir_b, args.threshold);
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto& name : report.only_a) {
+        spdlog::info("Only in {:?}: {:?}", dir_a.c_str(), name.c_str());
+    }
+    for (const auto& name : report.only_b) {
+        spdlog::info("Only in {:?}: {:?}", dir_b.c_str(), name.c_str());
+    }
+
+    auto failed    = 0uz;
+    auto differing = 0uz;
+    for (const auto& frame : report.frames) {
+        failed    += not frame.result;
+        differing += frame.result and frame.result->differing > 0;
+    }
+
+    fmt::println(
+        "{} pairs compared in {:.2f}s ({:.1f} pairs/s, {} threads): {} differ, {} failed, {} only in A, {} only in B",
+        report.frames.size(),
+        seconds,
+        static_cast<double>(report.frames.size()) / std::max(seconds, 1e-9),
+        pool.size(),
+        differing,
+        failed,
+        report.only_a.size(),
+        report.only_b.size()
+    );
+
+    // failed pairs rank first, identical ones are not worth listing
+    auto is_listed = [](const qoiview::batch::Frame& frame) {
+        return not frame.result or frame.result->differing > 0;
+    };
+
+    auto rank = 0;
+    for (const auto& frame : report.frames | sv::filter(is_listed) | sv::take(args.report_size)) {
+        if (rank++ == 0) {
+            fmt::println("{:>5}  {:>14}  {:>3}  {:>10}  {}", "rank", "psnr", "max", "differing", "file");
+        }
+
+        if (not frame.result) {
+            auto error = to_string(frame.result.error());
+            fmt::println("{:>5}  {:>14}  {:>3}  {:>10}  {}", rank, error, "-", "-", frame.name.c_str());
+            continue;
+        }
+
+        const auto& stats   = *frame.result;
+        auto        percent = 100.0 * static_cast<double>(stats.differing) / static_cast<double>(stats.pixels);
+
+        fmt::println(
+            "{:>5}  {:>11.2f} dB  {:>3}  {:>9.3f}%  {}",
+            rank,
+            stats.psnr(),
+            stats.max_error,
+            percent,
+            frame.name.c_str()
+        );
+    }
+
+    return 0;
+}
+
+// the test producer of a feed: the files are pushed over and over until the viewer goes away
+int run_send(const Args& args)
+{
+    auto inputs = resolve_inputs(args.request, nullptr);
+    if (not inputs) {
+        return 1;
+    }
+
+    auto files = std::vector<fs::path>{ inputs->files.begin(), inputs->files.end() };
+    auto fps   = args.fps.value_or(send_fps);
+
+    spdlog::info("Sending {} files to {} at {:.1f} fps", files.size(), args.send->c_str(), fps);
+
+    if (not qoiview::feed::send(*args.send, files, fps)) {
+        fmt::println(stderr, "No viewer is listening on '{}'", args.send->c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+try {
+    auto args = parse_args(argc, argv);
+    if (args.index() == 1) {
+        return std::get<1>(args);
+    }
+
+    auto&& [request, daemon, standalone, software, compare, threshold, cache_size, shared_size, thumbnails,
+            thumbnail_size, compare_dirs, report_size, stats, bins, fps, playback, preload_size, stream, follow, listen,
+            send, vram_size, etc2, memory_size]
+        = std::get<0>(args);
+
+    if (daemon) {
+        return run_daemon(std::get<0>(args));
+    } else if (thumbnails) {
+        return run_thumbnails(std::get<0>(args));
+    } else if (not compare_dirs.empty()) {
+        return run_compare_dirs(std::get<0>(args));
+    } else if (stats) {
+        return run_stats(std::get<0>(args));
+    } else if (send) {
+        return run_send(std::get<0>(args));
+    }
+
+    // the daemon only browses, compare mode, playback, streams, feeds and followed files always run in their own
+    // window
+    auto own_window = compare or fps or stream or follow or listen;
+    if (not standalone and not own_window and qoiview::daemon::forward(qoiview::daemon::socket_path(), request)) {
+        spdlog::info("Handed over to daemon");
+        return 0;
+    }
+
+    // compared files are shown in the order given, not sorted
+    auto inputs = stream  ? std::optional{ Inputs{ .files = { "-" }, .start = 0 } }
+                : listen  ? std::optional{ Inputs{ .files = { *listen }, .start = 0 } }
+                : compare ? compare_inputs(request)
+                          : resolve_inputs(request, nullptr);
+    if (not inputs) {
+        return 1;
+    }
+
+#if defined(QOIVIEW_SOFTWARE_RENDERER)
+    // the software presenter draws through Xlib, so it needs the X11 platform even on Wayland
+    if (software) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_X11);
+    }
+#endif
+
+    if (not glfwInit()) {
+        fmt::println(stderr, "Failed to initialize GLFW");
+        return 1;
+    }
+
+    set_window_hints();
+    if (software) {
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    }
+
+    auto* monitor = glfwGetPrimaryMonitor();
+    auto* mode    = glfwGetVideoMode(monitor);
+
+    // the size of a streamed image or a frame is only known once it arrives
+    auto size = stream or listen ? std::optional{ stream_window } : first_valid(*inputs);
+    if (not size) {
+        fmt::println(stderr, "No valid QOI file found");
+        return 1;
+    }
+
+    // room for every compared image at its size: side by side for two, in a 2x2 grid for more
+    if (compare) {
+        size->x *= 2;
+        size->y *= inputs->files.size() > 2 ? 2 : 1;
+    }
+
+    auto [width, height] = fit_window(*size, request.width, request.height, mode);
+    auto background      = request.background;
+
+    auto* window = glfwCreateWindow(width, height, "QoiView", nullptr, nullptr);
+    if (window == nullptr) {
+        fmt::println(stderr, "Failed to create GLFW window");
+        glfwTerminate();
+        return 1;
+    }
+
+    if (not software) {
+        glfwMakeContextCurrent(window);
+        glbinding::initialize(glfwGetProcAddress);
+    }
+
     {
-        auto view = QoiView{ window, inputs.files, inputs.start };
-        view.run(width, height, background);
+        auto shared = open_shared_cache(shared_size);
+        auto cache  = DecodedCache{ cache_size };
+        cache.attach(shared.get());
+
+        auto use_cache = cache_size > 0 or shared != nullptr;
+
+#if defined(QOIVIEW_SOFTWARE_RENDERER)
+        if (software) {
+            auto view = qoiview::SoftView{ window, inputs->files, inputs->start, use_cache ? &cache : nullptr };
+            view.run(width, height, background);
+        } else
+#endif
+        {
+            auto view = QoiView{ window, inputs->files, inputs->start, use_cache ? &cache : nullptr, compare };
+            view.set_diff_threshold(threshold);
+            view.set_follow(follow);
+            view.set_texture_budget(vram_size);
+            view.set_transcode(etc2);
+            view.set_memory_limit(memory_size);
+            if (stream) {
+                view.stream(qoiview::LiveDecoder::read_fd(fileno(stdin)), "stdin");
+            } else if (listen) {
+                view.listen(*listen);
+            }
+            if (fps) {
+                view.play(*fps, playback, preload_size);
+            }
+            view.run(width, height, background);
+        }
     }
 
     glfwTerminate();
@@ -0,0 +1,251 @@
+#include "qoiview/metrics.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+namespace qoiview::metrics
+{
+    Stats& Stats::operator+=(const Stats& other)
+    {
+        sse       += other.sse;
+        samples   += other.samples;
+        pixels    += other.pixels;
+        differing += other.differing;
+        max_error  = std::max(max_error, other.max_error);
+
+        return *this;
+    }
+
+    double Stats::mse() const
+    {
+        return samples == 0 ? 0.0 : static_cast<double>(sse) / static_cast<double>(samples);
+    }
+
+    double Stats::psnr() const
+    {
+        auto error = mse();
+        if (error == 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return 10.0 * std::log10(255.0 * 255.0 / error);
+    }
+
+    Stats compare(qoipp::ByteCSpan a, qoipp::ByteCSpan b, std::uint8_t threshold)
+    {
+        assert(a.size() == b.size() and a.size() % 4 == 0);
+
+        // 32-bit partial sums are enough for 16k pixels: 16384 * 4 * 255^2 < 2^32
+        constexpr auto block = 16384uz;
+
+        auto stats = Stats{};
+
+        for (auto start = 0uz; start < a.size(); start += block * 4) {
+            auto count = std::min(block * 4, a.size() - start);
+            auto pa    = a.data() + start;
+            auto pb    = b.data() + start;
+
+            auto sse       = 0u;
+            auto max_error = qoipp::Byte{ 0 };
+            auto differing = 0u;
+
+            // differences stay in bytes (max - min never wraps), which keeps the vectors 8-bit wide
+            for (auto i = 0uz; i < count; i += 4) {
+                auto over = qoipp::Byte{ 0 };
+                for (auto c = 0uz; c < 4; ++c) {
+                    auto x = pa[i + c];
+                    auto y = pb[i + c];
+                    auto d = static_cast<qoipp::Byte>(std::max(x, y) - std::min(x, y));
+
+                    sse       += static_cast<std::uint32_t>(d) * d;
+                    max_error  = std::max(max_error, d);
+                    over      |= static_cast<qoipp::Byte>(d > threshold);
+                }
+                differing += over;
+            }
+
+            stats.sse       += sse;
+            stats.max_error  = std::max<std::uint32_t>(stats.max_error, max_error);
+            stats.differing += differing;
+        }
+
+        stats.samples = a.size();
+        stats.pixels  = a.size() / 4;
+
+        return stats;
+    }
+
+    Stats compare(ThreadPool& pool, qoipp::ByteCSpan a, qoipp::ByteCSpan b, std::size_t stride, std::uint8_t threshold)
+    {
+        auto rows  = a.size() / stride;
+        auto total = Stats{};
+        auto mutex = std::mutex{};
+
+        pool.parallel_for(rows, [&](std::size_t begin, std::size_t end) {
+            auto offset = begin * stride;
+            auto size   = (end - begin) * stride;
+            auto stats  = compare(a.subspan(offset, size), b.subspan(offset, size), threshold);
+
+            auto lock  = std::scoped_lock{ mutex };
+            total     += stats;
+        });
+
+        return total;
+    }
+
+    Region& Region::operator+=(const Region& other)
+    {
+        for (auto c = 0uz; c < 4; ++c) {
+            min[c]     = std::min(min[c], other.min[c]);
+            max[c]     = std::max(max[c], other.max[c]);
+            sum[c]    += other.sum[c];
+            sum_sq[c] += other.sum_sq[c];
+        }
+        pixels += other.pixels;
+
+        return *this;
+    }
+
+    double Region::mean(std::size_t channel) const
+    {
+        return pixels == 0 ? 0.0 : static_cast<double>(sum[channel]) / static_cast<double>(pixels);
+    }
+
+    double Region::stddev(std::size_t channel) const
+    {
+        if (pixels == 0) {
+            return 0.0;
+        }
+
+        auto avg = mean(channel);
+        auto var = static_cast<double>(sum_sq[channel]) / static_cast<double>(pixels) - avg * avg;
+        return std::sqrt(std::max(var, 0.0));
+    }
+
+    Region summarize(qoipp::ByteCSpan pixels)
+    {
+        assert(pixels.size() % 4 == 0);
+
+        // 32-bit partial sums are enough for 16k pixels: 16384 * 255^2 < 2^32
+        constexpr auto block = 16384uz;
+
+        auto region = Region{};
+
+        for (auto start = 0uz; start < pixels.size(); start += block * 4) {
+            auto count = std::min(block * 4, pixels.size() - start);
+            auto data  = pixels.data() + start;
+
+            auto min    = std::array<qoipp::Byte, 4>{ 255, 255, 255, 255 };
+            auto max    = std::array<qoipp::Byte, 4>{};
+            auto sum    = std::array<std::uint32_t, 4>{};
+            auto sum_sq = std::array<std::uint32_t, 4>{};
+
+            for (auto i = 0uz; i < count; i += 4) {
+                for (auto c = 0uz; c < 4; ++c) {
+                    auto v     = data[i + c];
+                    min[c]     = std::min(min[c], v);
+                    max[c]     = std::max(max[c], v);
+                    sum[c]    += v;
+                    sum_sq[c] += static_cast<std::uint32_t>(v) * v;
+                }
+            }
+
+            for (auto c = 0uz; c < 4; ++c) {
+                region.min[c]     = std::min(region.min[c], min[c]);
+                region.max[c]     = std::max(region.max[c], max[c]);
+                region.sum[c]    += sum[c];
+                region.sum_sq[c] += sum_sq[c];
+            }
+        }
+
+        region.pixels = pixels.size() / 4;
+
+        return region;
+    }
+
+    Region summarize(ThreadPool& pool, const Image& image, raster::Rect rect)
+    {
+        auto width  = static_cast<int>(image.desc.width);
+        auto height = static_cast<int>(image.desc.height);
+
+        auto x0 = std::clamp(rect.x, 0, width);
+        auto y0 = std::clamp(rect.y, 0, height);
+        auto x1 = std::clamp(rect.x + rect.width, 0, width);
+        auto y1 = std::clamp(rect.y + rect.height, 0, height);
+
+        if (x0 >= x1 or y0 >= y1) {
+            return {};
+        }
+
+        auto pixels = image.pixels();
+        auto stride = static_cast<std::size_t>(width) * 4;
+        auto offset = static_cast<std::size_t>(x0) * 4;
+        auto size   = static_cast<std::size_t>(x1 - x0) * 4;
+
+        auto total = Region{};
+        auto mutex = std::mutex{};
+
+        pool.parallel_for(static_cast<std::size_t>(y1 - y0), [&](std::size_t begin, std::size_t end) {
+            auto region = Region{};
+            auto first  = (static_cast<std::size_t>(y0) + begin) * stride;
+
+            // full rows are contiguous, no need to go row by row
+            if (size == stride) {
+                region = summarize(pixels.subspan(first, (end - begin) * stride));
+            } else {
+                for (auto y = begin; y < end; ++y) {
+                    region += summarize(pixels.subspan(first + (y - begin) * stride + offset, size));
+                }
+            }
+
+            auto lock  = std::scoped_lock{ mutex };
+            total     += region;
+        });
+
+        return total;
+    }
+
+    void Incremental::reset(std::shared_ptr<const Image> a, std::shared_ptr<const Image> b, std::uint8_t threshold)
+    {
+        m_a         = std::move(a);
+        m_b         = std::move(b);
+        m_threshold = threshold;
+        m_rows      = 0;
+        m_stats     = {};
+    }
+
+    bool Incremental::update(ThreadPool& pool, std::size_t rows_a, std::size_t rows_b)
+    {
+        if (not comparable()) {
+            return false;
+        }
+
+        auto rows = std::min({ rows_a, rows_b, static_cast<std::size_t>(m_a->desc.height) });
+        if (rows <= m_rows) {
+            return false;
+        }
+
+        auto stride = static_cast<std::size_t>(m_a->desc.width) * 4;
+        auto offset = m_rows * stride;
+        auto size   = (rows - m_rows) * stride;
+
+        auto a = m_a->pixels().subspan(offset, size);
+        auto b = m_b->pixels().subspan(offset, size);
+
+        m_stats += compare(pool, a, b, stride, m_threshold);
+        m_rows   = rows;
+
+        return true;
+    }
+
+    bool Incremental::comparable() const
+    {
+        return m_a and m_b and m_a->desc.width == m_b->desc.width and m_a->desc.height == m_b->desc.height;
+    }
+
+    bool Incremental::complete() const
+    {
+        return comparable() and m_rows == m_a->desc.height;
+    }
+}
@@ -0,0 +1,456 @@
+#include "qoiview/pipeline.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(QOIVIEW_ZSTD)
+#    include <zstd.h>
+#endif
+
+#if defined(__linux__)
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr auto zstd_magic = std::array<char, 4>{ '\x28', '\xb5', '\x2f', '\xfd' };
+
+    // waits until the followed file is written to
+    class Watch
+    {
+    public:
+        explicit Watch(const qoiview::fs::path& path)
+        {
+#if defined(__linux__)
+            m_fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+            if (m_fd < 0 or ::inotify_add_watch(m_fd, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+                auto error = std::strerror(errno);
+                spdlog::warn("Failed to watch {:?}, checking regularly instead: {}", path.c_str(), error);
+            }
+#endif
+        }
+
+        ~Watch()
+        {
+#if defined(__linux__)
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+#endif
+        }
+
+        Watch(const Watch&)            = delete;
+        Watch& operator=(const Watch&) = delete;
+
+        // returns early when the file changed, otherwise after a timeout so that a stop is noticed
+        void wait(std::chrono::milliseconds timeout)
+        {
+#if defined(__linux__)
+            if (m_fd >= 0) {
+                auto fds = pollfd{ .fd = m_fd, .events = POLLIN, .revents = 0 };
+                if (::poll(&fds, 1, static_cast<int>(timeout.count())) > 0) {
+                    auto events = std::array<char, 4096>{};
+                    while (::read(m_fd, events.data(), events.size()) > 0) { }
+                }
+                return;
+            }
+#endif
+            std::this_thread::sleep_for(timeout);
+        }
+
+    private:
+        int m_fd = -1;
+    };
+
+    // chunks filled by a thread of its own and handed to the consumer in order
+    class ReadAhead
+    {
+    public:
+        explicit ReadAhead(qoiview::pipeline::Reader reader)
+            : m_reader{ std::move(reader) }
+            , m_thread{ [this](std::stop_token token) { run(token); } }
+        {
+        }
+
+        qoipp::Result<std::size_t> read(qoipp::ByteSpan out)
+        {
+            {
+                auto lock = std::unique_lock{ m_mutex };
+                m_cv.wait(lock, [this] { return m_filled > m_taken or m_ended; });
+
+                if (m_filled == m_taken) {
+                    return m_error ? qoipp::make_error<std::size_t>(*m_error) : 0uz;
+                }
+            }
+
+            // the chunk is the consumer's until it is handed back
+            auto& chunk = m_chunks[m_taken % depth];
+            auto  count = std::min(out.size(), chunk.size - chunk.consumed);
+
+            std::memcpy(out.data(), chunk.data.data() + chunk.consumed, count);
+            chunk.consumed += count;
+
+            if (chunk.consumed == chunk.size) {
+                {
+                    auto lock = std::unique_lock{ m_mutex };
+                    ++m_taken;
+                }
+                m_cv.notify_all();
+            }
+
+            return count;
+        }
+
+    private:
+        static constexpr auto depth      = 4uz;
+        static constexpr auto chunk_size = 256uz * 1024;
+
+        struct Chunk
+        {
+            qoipp::ByteVec data     = qoipp::ByteVec(chunk_size);
+            std::size_t    size     = 0;
+            std::size_t    consumed = 0;
+        };
+
+        void run(std::stop_token token)
+        {
+            while (true) {
+                {
+                    auto lock = std::unique_lock{ m_mutex };
+                    if (not m_cv.wait(lock, token, [this] { return m_filled - m_taken < depth; })) {
+                        return;
+                    }
+                }
+
+                // only this thread moves `m_filled`, and the consumer is done with the chunk it points to
+                auto& chunk    = m_chunks[m_filled % depth];
+                auto  read     = qoiview::pipeline::read_exact(m_reader, chunk.data);
+                chunk.size     = read.value_or(0);
+                chunk.consumed = 0;
+
+                {
+                    auto lock = std::unique_lock{ m_mutex };
+                    if (chunk.size > 0) {
+                        ++m_filled;
+                    }
+                    if (not read or chunk.size < chunk_size) {
+                        m_error = read ? std::nullopt : std::optional{ read.error() };
+                        m_ended = true;
+                    }
+                }
+                m_cv.notify_all();
+
+                if (m_ended) {
+                    return;
+                }
+            }
+        }
+
+        qoiview::pipeline::Reader m_reader;
+
+        std::mutex                  m_mutex;
+        std::condition_variable_any m_cv;
+        std::array<Chunk, depth>    m_chunks;
+        std::size_t                 m_filled = 0;    // chunks handed to the consumer so far
+        std::size_t                 m_taken  = 0;    // chunks the consumer is done with
+        bool                        m_ended  = false;
+        std::optional<qoipp::Error> m_error;
+
+        std::jthread m_thread;    // last, so that everything it uses is constructed before it starts
+    };
+}
+
+namespace qoiview::pipeline
+{
+    Reader read_stream(std::istream& stream, std::size_t size)
+    {
+        return [&stream, remaining = size](qoipp::ByteSpan out) mutable -> qoipp::Result<std::size_t> {
+            auto want = std::min(out.size(), remaining);
+            if (want == 0) {
+                return 0uz;
+            }
+
+            try {
+                stream.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(want));
+            } catch (const std::ios_base::failure& e) {
+                spdlog::error("Failed to read stream: {}", e.what());
+                return qoipp::make_error<std::size_t>(qoipp::Error::IoError);
+            }
+
+            auto count  = static_cast<std::size_t>(stream.gcount());
+            remaining  -= count;
+
+            return count;
+        };
+    }
+
+    Reader read_memory(qoipp::ByteCSpan bytes)
+    {
+        return [bytes](qoipp::ByteSpan out) mutable -> qoipp::Result<std::size_t> {
+            auto count = std::min(out.size(), bytes.size());
+            std::memcpy(out.data(), bytes.data(), count);
+            bytes = bytes.subspan(count);
+
+            return count;
+        };
+    }
+
+    Reader follow_stream(std::istream& stream, const fs::path& path, std::stop_token token)
+    {
+        // the watch is set up before the first read, so no write in between goes unnoticed
+        auto watch = std::make_unique<Watch>(path);
+
+        return [&stream, watch = std::move(watch), token](qoipp::ByteSpan out) -> qoipp::Result<std::size_t> {
+            while (not token.stop_requested()) {
+                try {
+                    stream.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(out.size()));
+                } catch (const std::ios_base::failure& e) {
+                    spdlog::error("Failed to read stream: {}", e.what());
+                    return qoipp::make_error<std::size_t>(qoipp::Error::IoError);
+                }
+
+                if (auto count = static_cast<std::size_t>(stream.gcount()); count > 0) {
+                    stream.clear();
+                    return count;
+                }
+
+                // at the end of what has been written so far
+                stream.clear();
+                watch->wait(std::chrono::milliseconds{ 100 });
+            }
+
+            return 0uz;
+        };
+    }
+
+    bool sniff_zstd(std::istream& stream)
+    {
+        auto start = stream.tellg();
+        auto head  = std::array<char, 4>{};
+        stream.read(head.data(), head.size());
+
+        auto compressed = stream.gcount() == std::ssize(head) and head == zstd_magic;
+
+        stream.clear();
+        stream.seekg(start);
+
+        return compressed;
+    }
+
+    bool sniff_zstd(qoipp::ByteCSpan bytes)
+    {
+        return bytes.size() >= zstd_magic.size()
+           and std::memcmp(bytes.data(), zstd_magic.data(), zstd_magic.size()) == 0;
+    }
+
+#if defined(QOIVIEW_ZSTD)
+    Reader zstd_stream(Reader reader)
+    {
+        using Context = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>;
+
+        auto context = Context{ ZSTD_createDCtx(), &ZSTD_freeDCtx };
+        auto input   = qoipp::ByteVec(ZSTD_DStreamInSize());
+
+        return [reader  = std::move(reader),
+                context = std::move(context),
+                input   = std::move(input),
+                pos     = 0uz,
+                size    = 0uz,
+                ended   = false](qoipp::ByteSpan out) mutable -> qoipp::Result<std::size_t> {
+            auto output = ZSTD_outBuffer{ out.data(), out.size(), 0 };
+
+            // a read may only fill the decompressor's window without producing anything yet
+            while (output.pos == 0) {
+                if (pos == size and not ended) {
+                    auto read = reader(input);
+                    if (not read) {
+                        return qoipp::make_error<std::size_t>(read.error());
+                    }
+
+                    pos   = 0;
+                    size  = read.value();
+                    ended = size == 0;
+                }
+
+                auto in  = ZSTD_inBuffer{ input.data(), size, pos };
+                auto ret = ZSTD_decompressStream(context.get(), &output, &in);
+                pos      = in.pos;
+
+                if (ZSTD_isError(ret)) {
+                    spdlog::error("Failed to decompress stream: {}", ZSTD_getErrorName(ret));
+                    return qoipp::make_error<std::size_t>(qoipp::Error::IoError);
+                } else if (ended and output.pos == 0) {
+                    break;    // nothing buffered is left
+                }
+            }
+
+            return output.pos;
+        };
+    }
+#else
+    Reader zstd_stream(Reader)
+    {
+        return [](qoipp::ByteSpan) -> qoipp::Result<std::size_t> {
+            spdlog::error("Failed to decompress stream: built without zstd support");
+            return qoipp::make_error<std::size_t>(qoipp::Error::IoError);
+        };
+    }
+#endif
+
+    Reader read_ahead(Reader reader)
+    {
+        auto ahead = std::make_unique<ReadAhead>(std::move(reader));
+        return [ahead = std::move(ahead)](qoipp::ByteSpan out) { return ahead->read(out); };
+    }
+
+    qoipp::Result<std::size_t> read_exact(Reader& reader, qoipp::ByteSpan out)
+    {
+        auto filled = 0uz;
+        while (filled < out.size()) {
+            auto read = reader(out.subspan(filled));
+            if (not read) {
+                return read;
+            } else if (read.value() == 0) {
+                break;
+            }
+            filled += read.value();
+        }
+        return filled;
+    }
+
+    Generator<qoipp::Result<Rows>> decode_rows(
+        qoipp::StreamDecoder& decoder,
+        Reader                reader,
+        qoipp::ByteSpan       out,
+        std::size_t           stride,
+        std::stop_token       token
+    )
+    {
+        auto buffer   = qoipp::ByteVec(16 * 1024);
+        auto leftover = 0uz;
+        auto written  = 0uz;
+        auto line     = 0uz;
+
+        while (written < out.size() and not token.stop_requested()) {
+            auto read = reader(std::span{ buffer }.subspan(leftover));
+            if (not read) {
+                co_yield qoipp::make_error<Rows>(read.error());
+                co_return;
+            } else if (read.value() == 0) {
+                break;
+            }
+
+            auto in  = std::span{ buffer }.first(leftover + read.value());
+            leftover = 0;
+
+            while (not in.empty()) {
+                auto res = decoder.decode(out.subspan(written), in);
+                if (not res) {
+                    co_yield qoipp::make_error<Rows>(res.error());
+                    co_return;
+                }
+
+                written += res->written;
+
+                // an op is split between two reads, carry its head over to the next one
+                if (res->processed == 0) {
+                    leftover = in.size();
+                    sr::copy(in, buffer.begin());
+                    break;
+                }
+
+                in = in.subspan(res->processed);
+            }
+
+            while (decoder.has_run_count() and written < out.size()) {
+                written += decoder.drain_run(out.subspan(written)).value();
+            }
+
+            if (auto lines = written / stride; lines > line) {
+                co_yield Rows{ .start = line, .count = lines - line, .written = written };
+                line = lines;
+            }
+        }
+
+        if (written % stride != 0 and not token.stop_requested()) {
+            co_yield Rows{ .start = line, .count = 1, .written = written };
+        }
+    }
+
+    Generator<qoipp::Result<Strip>> decode_strips(
+        qoipp::StreamDecoder& decoder,
+        Reader                reader,
+        qoipp::ByteSpan       band,
+        std::size_t           stride,
+        std::size_t           height,
+        std::stop_token       token
+    )
+    {
+        assert(band.size() >= stride);
+
+        auto buffer   = qoipp::ByteVec(16 * 1024);
+        auto in       = qoipp::ByteCSpan{};
+        auto leftover = 0uz;
+        auto filled   = 0uz;
+        auto line     = 0uz;
+        auto rows     = band.size() / stride;
+
+        // unfilled part of the current strip, the last strip may be shorter than the band
+        auto room = [&] { return band.subspan(filled, std::min(rows, height - line) * stride - filled); };
+
+        while (line < height and not token.stop_requested()) {
+            if (decoder.has_run_count()) {
+                filled += decoder.drain_run(room()).value();
+            } else if (in.empty()) {
+                auto read = reader(std::span{ buffer }.subspan(leftover));
+                if (not read) {
+                    co_yield qoipp::make_error<Strip>(read.error());
+                    co_return;
+                } else if (read.value() == 0) {
+                    break;
+                }
+
+                in       = std::span{ buffer }.first(leftover + read.value());
+                leftover = 0;
+            } else {
+                auto res = decoder.decode(room(), in);
+                if (not res) {
+                    co_yield qoipp::make_error<Strip>(res.error());
+                    co_return;
+                }
+
+                filled += res->written;
+                in      = in.subspan(res->processed);
+
+                // an op is split between two reads, carry its head over to the next one
+                if (res->processed == 0) {
+                    leftover = in.size();
+                    sr::copy(in, buffer.begin());
+                    in = {};
+                }
+            }
+
+            if (room().empty()) {
+                co_yield Strip{ .start = line, .pixels = band.first(filled) };
+                line   += filled / stride;
+                filled  = 0;
+            }
+        }
+
+        if (filled > 0 and not token.stop_requested()) {
+            auto size = (filled + stride - 1) / stride * stride;
+            sr::fill(band.subspan(filled, size - filled), 0x00);
+            co_yield Strip{ .start = line, .pixels = band.first(size) };
+        }
+    }
+}
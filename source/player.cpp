@@ -0,0 +1,164 @@
+#include "qoiview/player.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace qoiview
+{
+    Player::Player(
+        ThreadPool&                     pool,
+        std::vector<fs::path>           frames,
+        Mode                            mode,
+        double                          fps,
+        std::size_t                     ahead,
+        std::shared_ptr<const Sequence> sequence
+    )
+        : m_pool{ pool }
+        , m_frames{ std::move(frames) }
+        , m_mode{ mode }
+        , m_fps{ fps }
+        , m_ahead{ std::max(ahead, 1uz) }
+        , m_sequence{ std::move(sequence) }
+    {
+        assert(not m_frames.empty() and fps > 0.0);
+        assert(not m_sequence or m_sequence->size() == m_frames.size());
+    }
+
+    // queued decodes only own their flag and path, they are skipped instead of waited for
+    Player::~Player()
+    {
+        for (auto& [_, job] : m_jobs) {
+            job.cancelled->store(true, std::memory_order::relaxed);
+        }
+    }
+
+    std::optional<std::size_t> Player::frame_at(std::size_t step) const
+    {
+        auto count = m_frames.size();
+
+        switch (m_mode) {
+        case Mode::Loop: return step % count;
+        case Mode::Once: return step < count ? std::optional{ step } : std::nullopt;
+        case Mode::PingPong: {
+            if (count == 1) {
+                return 0;
+            }
+            // 0 1 2 3 2 1 | 0 1 2 ...: the ends are shown once per bounce
+            auto period = 2 * count - 2;
+            auto phase  = step % period;
+            return phase < count ? phase : period - phase;
+        }
+        }
+
+        return std::nullopt;
+    }
+
+    std::size_t Player::step(Clock::time_point now) const
+    {
+        if (m_paused) {
+            return *m_paused;
+        }
+
+        auto elapsed = std::chrono::duration<double>(now - m_start).count();
+        return static_cast<std::size_t>(std::max(std::floor(elapsed * m_fps), 0.0));
+    }
+
+    void Player::pause(Clock::time_point now)
+    {
+        if (not m_paused) {
+            m_paused = step(now);
+        }
+    }
+
+    void Player::resume(Clock::time_point now)
+    {
+        if (auto step = std::exchange(m_paused, std::nullopt); step) {
+            seek(*step, now);
+        }
+    }
+
+    void Player::seek(std::size_t step, Clock::time_point now)
+    {
+        if (m_paused) {
+            m_paused = step;
+            return;
+        }
+
+        auto offset = std::chrono::duration<double>(static_cast<double>(step) / m_fps);
+        m_start     = now - std::chrono::duration_cast<Clock::duration>(offset);
+    }
+
+    void Player::prefetch(std::size_t step, bool backwards)
+    {
+        // decoded frames are handed out as they are, there is nothing to do ahead
+        if (preloaded() and m_sequence->storage() == Sequence::Storage::Decoded) {
+            return;
+        }
+
+        auto wanted = std::vector<std::size_t>{};
+        for (auto i = 0uz; i < m_ahead; ++i) {
+            if (backwards and i > step) {
+                break;
+            }
+
+            auto frame = frame_at(backwards ? step - i : step + i);
+            if (not frame) {
+                break;
+            }
+            if (sr::find(wanted, *frame) == wanted.end()) {
+                wanted.push_back(*frame);
+            }
+        }
+
+        // frames the playback has moved past are not decoded anymore, a running decode just finishes unused
+        for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+            if (sr::find(wanted, it->first) == wanted.end()) {
+                it->second.cancelled->store(true, std::memory_order::relaxed);
+                it = m_jobs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // submitted in play order, so the pool's FIFO works on the most urgent frame first
+        for (auto frame : wanted) {
+            if (m_jobs.contains(frame)) {
+                continue;
+            }
+
+            auto cancelled = std::make_shared<std::atomic<bool>>(false);
+            auto sequence  = preloaded() ? m_sequence : nullptr;
+            auto image     = m_pool.submit([cancelled, sequence, frame, file = m_frames[frame]] {
+                if (cancelled->load(std::memory_order::relaxed)) {
+                    return std::shared_ptr<const Image>{};
+                }
+                return sequence ? sequence->frame(frame) : Sequence::decode(file);
+            });
+
+            m_jobs.emplace(frame, Job{ std::move(cancelled), std::move(image), nullptr });
+        }
+    }
+
+    std::shared_ptr<const Image> Player::ready(std::size_t frame)
+    {
+        if (preloaded() and m_sequence->storage() == Sequence::Storage::Decoded) {
+            return m_sequence->frame(frame);
+        }
+
+        auto it = m_jobs.find(frame);
+        if (it == m_jobs.end()) {
+            return nullptr;
+        }
+
+        // kept until prefetch drops it, so a held or repeated frame doesn't decode again
+        auto& job = it->second;
+        if (job.pending.valid() and job.pending.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready) {
+            job.image = job.pending.get();
+        }
+
+        return job.image;
+    }
+}
@@ -1,5 +1,6 @@
 #include "qoiview/qoiview.hpp"
 
+#include <fmt/ranges.h>
 #include <glbinding/gl/gl.h>
 #include <spdlog/spdlog.h>
 
@@ -16,11 +17,14 @@ namespace
         uniform vec2 offset;
         uniform vec2 aspect;
         uniform float zoom;
+        uniform vec4 region;    // corners of the quad inside the image's, a tile covers part of it
+        uniform vec4 crop;      // of the texture drawn on it
 
         void main()
         {
-            gl_Position = vec4((position - offset) * aspect * zoom, 0.0, 1.0);
-            v_texcoord = texcoord;
+            vec2 corner = mix(region.xy, region.zw, position * 0.5 + 0.5);
+            gl_Position = vec4((corner - offset) * aspect * zoom, 0.0, 1.0);
+            v_texcoord = mix(crop.xy, crop.zw, texcoord);
         }
     )glsl";
 
@@ -33,10 +37,83 @@ namespace
         out vec4 fragcolor;
 
         uniform sampler2D tex;
+        uniform sampler2D tex_b;
+        uniform int mode;    // Diff
+        uniform float threshold;
+        uniform float minify;
+
+        // the texels under the pixel averaged over a grid of up to 16x16 bilinear taps, weighted by their alpha so
+        // transparent texels don't bleed their color
+        vec4 sample_area(sampler2D s, highp vec2 uv)
+        {
+            if (minify <= 1.0) {
+                return texture(s, uv);
+            }
+
+            int n = min(int(ceil(minify)), 16);
+            highp vec2 spacing = minify / vec2(textureSize(s, 0)) / float(n);
+            highp vec2 first = uv - spacing * (float(n) - 1.0) / 2.0;
+
+            highp vec4 sum = vec4(0.0);
+            for (int y = 0; y < n; ++y) {
+                for (int x = 0; x < n; ++x) {
+                    vec4 c = texture(s, first + spacing * vec2(x, y));
+                    sum += vec4(c.rgb * c.a, c.a);
+                }
+            }
+            return sum.a > 0.0 ? vec4(sum.rgb / sum.a, sum.a / float(n * n)) : vec4(0.0);
+        }
+
+        void main()
+        {
+            vec4 a = sample_area(tex, v_texcoord);
+            if (mode == 0) {
+                fragcolor = a;
+                return;
+            }
+
+            vec4 d = abs(a - texture(tex_b, v_texcoord));
+            if (mode == 1) {
+                fragcolor = vec4(max(d.rgb, vec3(d.a)), 1.0);
+            } else if (any(greaterThan(d * 255.0, vec4(threshold + 0.5)))) {
+                fragcolor = vec4(1.0, 0.0, 0.0, 1.0);
+            } else {
+                fragcolor = vec4(vec3(dot(a.rgb, vec3(0.299, 0.587, 0.114)) * 0.3), 1.0);
+            }
+        }
+    )glsl";
+
+    constexpr auto overlay_vertex_shader = R"glsl(
+        #version 300 es
+
+        layout(location = 0) in vec2 position;
+        layout(location = 1) in vec2 texcoord;
+
+        out vec2 v_texcoord;
+
+        void main()
+        {
+            gl_Position = vec4(position, 0.0, 1.0);
+            v_texcoord = texcoord;
+        }
+    )glsl";
+
+    // red, green and blue bars added together over a translucent backdrop
+    constexpr auto overlay_fragment_shader = R"glsl(
+        #version 300 es
+
+        precision mediump float;
+
+        in vec2 v_texcoord;
+        out vec4 fragcolor;
+
+        uniform sampler2D histogram;
 
         void main()
         {
-            fragcolor = texture(tex, v_texcoord);
+            vec3 height = texture(histogram, vec2(v_texcoord.x, 0.5)).rgb;
+            vec3 bar = step(vec3(1.0 - v_texcoord.y), height);
+            fragcolor = vec4(max(bar, vec3(0.1)), 0.8);
         }
     )glsl";
 
@@ -57,6 +134,48 @@ namespace
         2, 3, 0,    // lower-left triangle
     };
 
+    gl::GLuint compile_program(const char* vertex_source, const char* fragment_source)
+    {
+        auto buf     = std::array<char, 1024>{};
+        auto success = gl::GLint{};
+
+        auto vert = gl::glCreateShader(gl::GL_VERTEX_SHADER);
+        gl::glShaderSource(vert, 1, &vertex_source, nullptr);
+        gl::glCompileShader(vert);
+        gl::glGetShaderiv(vert, gl::GL_COMPILE_STATUS, &success);
+
+        if (success == false) {
+            gl::glGetShaderInfoLog(vert, buf.size(), nullptr, buf.data());
+            throw std::runtime_error{ fmt::format("Failed to compile vertex shader: {}", buf.data()) };
+        }
+
+        auto frag = gl::glCreateShader(gl::GL_FRAGMENT_SHADER);
+        gl::glShaderSource(frag, 1, &fragment_source, nullptr);
+        gl::glCompileShader(frag);
+        gl::glGetShaderiv(frag, gl::GL_COMPILE_STATUS, &success);
+
+        if (success == false) {
+            gl::glGetShaderInfoLog(frag, buf.size(), nullptr, buf.data());
+            throw std::runtime_error{ fmt::format("Failed to compile fragment shader: {}", buf.data()) };
+        }
+
+        auto program = gl::glCreateProgram();
+        gl::glAttachShader(program, vert);
+        gl::glAttachShader(program, frag);
+        gl::glLinkProgram(program);
+        gl::glGetProgramiv(program, gl::GL_LINK_STATUS, &success);
+
+        if (success == false) {
+            gl::glGetProgramInfoLog(program, buf.size(), nullptr, buf.data());
+            throw std::runtime_error{ fmt::format("Failed to link shader program: {}", buf.data()) };
+        }
+
+        gl::glDeleteShader(vert);
+        gl::glDeleteShader(frag);
+
+        return program;
+    }
+
     float scale_local_to_screen(float scale, float aspect, int image_width, int window_width)
     {
         return scale * static_cast<float>(window_width) / static_cast<float>(image_width) * aspect;
@@ -66,17 +185,62 @@ namespace
     {
         return scale * static_cast<float>(image_width) / static_cast<float>(window_width) / aspect;
     }
+
+    // RGBA8 with a full mipmap chain, the third it adds is counted whether the mipmaps are generated or not
+    std::size_t exact_bytes(const qoipp::Desc& desc)
+    {
+        return std::size_t{ desc.width } * desc.height * 4 * 4 / 3;
+    }
+
+    qoiview::TextureCache::Entry exact_entry(
+        qoiview::DecodedCache::Key key,
+        gl::GLuint                 texture,
+        const qoipp::Desc&         desc
+    )
+    {
+        return {
+            .key     = std::move(key),
+            .texture = texture,
+            .size    = { static_cast<int>(desc.width), static_cast<int>(desc.height) },
+            .bytes   = exact_bytes(desc),
+            .exact   = true,
+        };
+    }
+
+    // through a pair of framebuffers, the copy never leaves the GPU
+    void copy_texture(gl::GLuint from, gl::GLuint to, qoiview::Vec2<int> size)
+    {
+        auto framebuffers = std::array<gl::GLuint, 2>{};
+        gl::glGenFramebuffers(2, framebuffers.data());
+
+        gl::glBindFramebuffer(gl::GL_READ_FRAMEBUFFER, framebuffers[0]);
+        gl::glFramebufferTexture2D(gl::GL_READ_FRAMEBUFFER, gl::GL_COLOR_ATTACHMENT0, gl::GL_TEXTURE_2D, from, 0);
+        gl::glBindFramebuffer(gl::GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        gl::glFramebufferTexture2D(gl::GL_DRAW_FRAMEBUFFER, gl::GL_COLOR_ATTACHMENT0, gl::GL_TEXTURE_2D, to, 0);
+
+        auto [w, h] = size;
+        gl::glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, gl::GL_COLOR_BUFFER_BIT, gl::GL_NEAREST);
+
+        gl::glBindFramebuffer(gl::GL_FRAMEBUFFER, 0);
+        gl::glDeleteFramebuffers(2, framebuffers.data());
+    }
 }
 
 namespace qoiview
 {
-    QoiView::QoiView(GLFWwindow* window, std::deque<fs::path> files, std::size_t start)
+    QoiView::QoiView(
+        GLFWwindow*          window,
+        std::deque<fs::path> files,
+        std::size_t          start,
+        DecodedCache*        cache,
+        bool                 compare
+    )
         : m_window{ window }
         , m_files{ std::move(files) }
         , m_index{ start }
+        , m_compare{ compare }
+        , m_cache{ cache }
     {
-        m_decoder.launch();
-
         glfwSetWindowUserPointer(m_window, this);
 
         glfwSetFramebufferSizeCallback(window, callback_framebuffer_size);
@@ -87,6 +251,7 @@ namespace qoiview
 
         prepare_rect();
         prepare_shader();
+        prepare_slots(m_compare ? std::min(m_files.size(), max_slots) : 1);
 
         m_monitor = glfwGetPrimaryMonitor();
         m_mode    = glfwGetVideoMode(m_monitor);
@@ -94,7 +259,15 @@ namespace qoiview
 
     QoiView::~QoiView()
     {
-        gl::glDeleteTextures(1, &m_texture);
+        close_tiled();
+        for (const auto& slot : m_slots) {
+            gl::glDeleteTextures(1, &slot.texture);
+        }
+        if (m_playback) {
+            gl::glDeleteTextures(Playback::ring_size, m_playback->textures.data());
+        }
+        gl::glDeleteTextures(1, &m_histogram_texture);
+        gl::glDeleteProgram(m_overlay_program);
         gl::glDeleteProgram(m_program);
         gl::glDeleteBuffers(1, &m_ebo);
         gl::glDeleteVertexArrays(1, &m_vao);
@@ -109,11 +282,10 @@ namespace qoiview
     void QoiView::callback_framebuffer_size(GLFWwindow* window, int width, int height)
     {
         auto& view = *static_cast<QoiView*>(glfwGetWindowUserPointer(window));
-        gl::glViewport(0, 0, width, height);
         view.update_aspect(width, height);
     }
 
-    void QoiView::callback_key(GLFWwindow* window, int key, int, int action, int)
+    void QoiView::callback_key(GLFWwindow* window, int key, int, int action, int mods)
     {
         auto& view = *static_cast<QoiView*>(glfwGetWindowUserPointer(window));
         if (action == GLFW_RELEASE) {
@@ -131,9 +303,14 @@ namespace qoiview
         case GLFW_KEY_O: view.update_zoom(Zoom::Out); break;
         case GLFW_KEY_F: view.toggle_fullscreen(); break;
         case GLFW_KEY_N: view.toggle_filtering(); break;
-        case GLFW_KEY_M: view.toggle_mipmap(); break;
+        case GLFW_KEY_M: view.toggle_minify(); break;
+        case GLFW_KEY_D: view.toggle_diff(); break;
+        case GLFW_KEY_S: view.toggle_histogram(); break;
+        case GLFW_KEY_C: view.toggle_inspector(); break;
+        case GLFW_KEY_SPACE: view.toggle_pause(); break;
         case GLFW_KEY_R: (view.reset_zoom(), view.reset_offset()); break;
-        case GLFW_KEY_P: fmt::println("{}", view.m_files[view.m_index].c_str()); break;
+        case GLFW_KEY_P: fmt::println("{}", view.slot_file(view.slot_at(view.m_mouse)).c_str()); break;
+        case GLFW_KEY_E: view.export_view((mods & GLFW_MOD_SHIFT) == 0); break;
         case GLFW_KEY_UP: view.update_zoom(Zoom::In); break;
         case GLFW_KEY_DOWN: view.update_zoom(Zoom::Out); break;
         case GLFW_KEY_RIGHT: view.file_next(); break;
@@ -148,9 +325,14 @@ namespace qoiview
         auto x = static_cast<float>(xpos);
         auto y = static_cast<float>(ypos);
 
-        if (view.m_mouse_press) {
-            int width, height;
-            glfwGetWindowSize(window, &width, &height);
+        if (view.m_inspect) {
+            view.m_update_title = true;
+        }
+
+        if (view.m_selecting) {
+            view.m_selection = view.selection_rect(view.m_selection_from);
+        } else if (view.m_mouse_press) {
+            auto [width, height] = view.cell_size();
 
             auto dx = (x - view.m_mouse.x) / static_cast<float>(width);
             auto dy = (view.m_mouse.y - y) / static_cast<float>(height);
@@ -160,10 +342,19 @@ namespace qoiview
         view.m_mouse = { x, y };
     }
 
-    void QoiView::callback_mouse_button(GLFWwindow* window, int button, int action, int)
+    void QoiView::callback_mouse_button(GLFWwindow* window, int button, int action, int mods)
     {
         auto& view = *static_cast<QoiView*>(glfwGetWindowUserPointer(window));
-        if (button == GLFW_MOUSE_BUTTON_LEFT) {
+        if (button != GLFW_MOUSE_BUTTON_LEFT) {
+            return;
+        }
+
+        // shift-drag selects a rectangle instead of moving the image
+        if (action == GLFW_PRESS and (mods & GLFW_MOD_SHIFT) != 0) {
+            view.begin_selection();
+        } else if (action == GLFW_RELEASE and view.m_selecting) {
+            view.end_selection();
+        } else {
             view.m_mouse_press = action == GLFW_PRESS;
         }
     }
@@ -180,13 +371,17 @@ namespace qoiview
 
     bool QoiView::check_qoi(const fs::path& path)
     {
-        return qoipp::read_header(path).has_value();
+        return archive::read_header(path).has_value();
     }
 
     void QoiView::run(int width, int height, Color background)
     {
-        auto to_float = [](std::uint8_t c) { return static_cast<float>(c) / 255.0f; };
-        gl::glClearColor(to_float(background.r), to_float(background.g), to_float(background.b), 1.0f);
+        set_background(background);
+
+        // the decoders are stopped when the previous run returned
+        for (auto& slot : m_slots) {
+            slot.decoder->launch();
+        }
 
         gl::glBlendFunc(gl::GL_SRC_ALPHA, gl::GL_ONE_MINUS_SRC_ALPHA);
         gl::glEnable(gl::GL_BLEND);
@@ -194,78 +389,249 @@ namespace qoiview
         gl::glUseProgram(m_program);
         gl::glBindVertexArray(m_vao);
 
-        gl::glViewport(0, 0, width, height);
         update_aspect(width, height);
 
         apply_uniform(Uniform::Zoom);
         apply_uniform(Uniform::Offset);
+        apply_uniform(Uniform::TexB);
+        apply_uniform(Uniform::Mode);
+        apply_uniform(Uniform::Threshold);
+        apply_uniform(Uniform::Region);
+        apply_uniform(Uniform::Crop);
 
         glfwSwapInterval(1);
 
         while (not glfwWindowShouldClose(m_window)) {
+            if (m_on_frame) {
+                m_on_frame(*this);
+            }
+
+            // every slot decodes on its own thread, so compared images load side by side, not one after another
             if (std::exchange(m_update_texture, false)) {
-                prepare_texture();
+                for (auto i = 0uz; i < m_slots.size(); ++i) {
+                    prepare_texture(m_slots[i], slot_file(i));
+                }
+                if (m_slots.size() >= 2) {
+                    m_metrics.reset(m_slots[0].decoder->image(), m_slots[1].decoder->image(), m_threshold);
+                }
+            }
 
-                int width, height;
-                glfwGetWindowSize(m_window, &width, &height);
-                update_aspect(width, height);
+            if (m_playback) {
+                update_playback();
+            } else if (m_feed) {
+                update_feed();
             }
 
+            process_events();
+            update_tiles();
+            update_transcoder();
+            update_prefetch();
+            update_metrics();
+            report_selection();
+
             if (std::exchange(m_update_title, false)) {
                 update_title();
             }
 
-            if (auto work = m_decoder.get(); work) {
-                auto desc = m_decoder.current()->desc;
+            gl::glClear(gl::GL_COLOR_BUFFER_BIT);
 
-                gl::glTexSubImage2D(
-                    gl::GL_TEXTURE_2D,
-                    0,
-                    0,
-                    static_cast<gl::GLint>(work->start),
-                    static_cast<gl::GLsizei>(desc.width),
-                    static_cast<gl::GLsizei>(work->count),
-                    gl::GL_RGBA,
-                    gl::GL_UNSIGNED_BYTE,
-                    work->data.data()
-                );
-                gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+            int fb_width, fb_height;
+            glfwGetFramebufferSize(m_window, &fb_width, &fb_height);
+
+            auto [cols, rows] = grid();
+            auto cell_width   = fb_width / cols;
+            auto cell_height  = fb_height / rows;
+
+            // the shader compares the first two images in a single viewport
+            if (m_diff != Diff::Off) {
+                gl::glViewport(0, 0, fb_width, fb_height);
+                gl::glActiveTexture(gl::GL_TEXTURE1);
+                gl::glBindTexture(gl::GL_TEXTURE_2D, slot_texture(1));
+                gl::glActiveTexture(gl::GL_TEXTURE0);
+                gl::glBindTexture(gl::GL_TEXTURE_2D, slot_texture(0));
+                apply_uniform(Uniform::Aspect, m_slots[0]);
+                apply_uniform(Uniform::Minify, m_slots[0]);
+                gl::glDrawElements(gl::GL_TRIANGLES, indices.size(), gl::GL_UNSIGNED_INT, nullptr);
             }
 
-            gl::glClear(gl::GL_COLOR_BUFFER_BIT);
-            gl::glDrawElements(gl::GL_TRIANGLES, indices.size(), gl::GL_UNSIGNED_INT, nullptr);
+            for (auto i = 0; m_diff == Diff::Off and i < static_cast<int>(m_slots.size()); ++i) {
+                const auto& slot    = m_slots[static_cast<std::size_t>(i)];
+                const auto  texture = slot_texture(static_cast<std::size_t>(i));
+                const auto  tiled   = i == 0 and m_tiles;
+                if (texture == 0 and not tiled) {
+                    continue;
+                }
+
+                auto x = (i % cols) * cell_width;
+                auto y = fb_height - (i / cols + 1) * cell_height;
+
+                gl::glViewport(x, y, cell_width, cell_height);
+                apply_uniform(Uniform::Aspect, slot);
+
+                if (tiled) {
+                    draw_tiles(slot);
+                    continue;
+                }
+
+                gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+                apply_uniform(Uniform::Minify, slot);
+                gl::glDrawElements(gl::GL_TRIANGLES, indices.size(), gl::GL_UNSIGNED_INT, nullptr);
+            }
+
+            if (m_selection) {
+                draw_selection(fb_width, fb_height);
+            }
+
+            if (m_show_histogram and m_histogram_texture != 0) {
+                draw_histogram(fb_width, fb_height);
+            }
 
             glfwSwapBuffers(m_window);
             glfwPollEvents();
         }
 
-        m_decoder.stop();
+        for (auto& slot : m_slots) {
+            slot.decoder->stop();
+        }
     }
 
-    void QoiView::update_aspect(int width, int height)
+    void QoiView::set_background(Color background)
     {
-        auto image_ratio  = static_cast<float>(m_image_size.x) / static_cast<float>(m_image_size.y);
-        auto window_ratio = static_cast<float>(width) / static_cast<float>(height);
+        auto to_float = [](std::uint8_t c) { return static_cast<float>(c) / 255.0f; };
+        gl::glClearColor(to_float(background.r), to_float(background.g), to_float(background.b), 1.0f);
+    }
 
-        if (image_ratio > window_ratio) {
-            m_aspect.x = 1.0f;
-            m_aspect.y = window_ratio / image_ratio;
-        } else {
-            m_aspect.x = image_ratio / window_ratio;
-            m_aspect.y = 1.0f;
+    void QoiView::set_follow(bool follow)
+    {
+        m_follow = follow;
+        for (auto& slot : m_slots) {
+            slot.decoder->set_follow(follow);
+        }
+    }
+
+    void QoiView::set_texture_budget(std::size_t budget)
+    {
+        m_textures = budget > 0 ? std::make_unique<TextureCache>(budget) : nullptr;
+    }
+
+    void QoiView::set_transcode(bool transcode)
+    {
+        if (transcode and not m_textures) {
+            spdlog::warn("ETC2 textures need a texture budget, not transcoding");
+            transcode = false;
+        }
+        m_transcoder = transcode ? std::make_unique<Transcoder>() : nullptr;
+    }
+
+    void QoiView::stream(LiveDecoder::Source source, std::string name)
+    {
+        m_stream = std::make_unique<LiveDecoder>(std::move(source), std::move(name));
+
+        // the stream replaces the first slot's decoder
+        m_update_texture = false;
+        m_update_title   = true;
+    }
+
+    void QoiView::listen(fs::path socket)
+    {
+        m_feed.emplace();
+        m_feed->receiver = std::make_unique<feed::Receiver>(std::move(socket));
+
+        // the feed replaces the first slot's decoder
+        m_update_texture = false;
+        m_update_title   = true;
+    }
+
+    void QoiView::play(double fps, Player::Mode mode, std::size_t preload)
+    {
+        auto frames = std::vector<fs::path>{ m_files.begin(), m_files.end() };
+        auto ahead  = std::max(m_pool.size(), 2uz);
+
+        m_playback.emplace();
+
+        if (preload > 0) {
+            auto plan = Sequence::plan(frames, preload, fps, ahead, Playback::ring_size);
+            spdlog::info(
+                "Preloading {} frames {}, {:.1f} MiB",
+                frames.size(),
+                plan.storage == Sequence::Storage::Decoded ? "decoded" : "compressed",
+                static_cast<double>(plan.bytes) / (1024.0 * 1024.0)
+            );
+
+            m_playback->sequence   = std::make_shared<Sequence>(m_pool, frames, plan.storage);
+            m_playback->preloading = true;
+        }
+
+        auto& player = m_playback->player;
+        player = std::make_unique<Player>(m_pool, std::move(frames), mode, fps, ahead, m_playback->sequence);
+        player->seek(m_index, Player::Clock::now());
+        if (m_playback->preloading) {
+            player->pause(Player::Clock::now());
+        }
+
+        gl::glGenTextures(Playback::ring_size, m_playback->textures.data());
+        for (auto texture : m_playback->textures) {
+            gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+            apply_filtering();
+        }
+
+        // the player replaces the first slot's decoder
+        m_update_texture = false;
+        m_update_title   = true;
+    }
+
+    void QoiView::open(std::deque<fs::path> files, std::size_t start)
+    {
+        m_files   = std::move(files);
+        m_index   = start;
+        m_compare = false;
+        m_diff    = Diff::Off;
+
+        m_selecting = false;
+        m_selection.reset();
+
+        prepare_slots(1);
+        m_prefetch_from.reset();
+
+        reset_zoom();
+        reset_offset();
+
+        m_update_texture = true;
+        m_update_title   = true;
+    }
+
+    void QoiView::update_aspect(int width, int height)
+    {
+        auto [cols, rows] = grid();
+        auto window_ratio = (static_cast<float>(width) / static_cast<float>(cols))
+                          / (static_cast<float>(height) / static_cast<float>(rows));
+
+        for (auto& slot : m_slots) {
+            auto image_ratio = static_cast<float>(slot.size.x) / static_cast<float>(slot.size.y);
+
+            if (slot.size.y == 0) {
+                slot.aspect = { 1.0f, 1.0f };
+            } else if (image_ratio > window_ratio) {
+                slot.aspect.x = 1.0f;
+                slot.aspect.y = window_ratio / image_ratio;
+            } else {
+                slot.aspect.x = image_ratio / window_ratio;
+                slot.aspect.y = 1.0f;
+            }
         }
 
-        apply_uniform(Uniform::Aspect);
         m_update_title = true;
     }
 
     void QoiView::update_zoom(Zoom zoom)
     {
-        int width, height;
-        glfwGetWindowSize(m_window, &width, &height);
+        const auto& slot  = m_slots.front();
+        const auto  width = cell_size().x;
 
-        const auto min = scale_screen_to_local(1e-3f, m_aspect.x, m_image_size.x, width);
-        const auto max = scale_screen_to_local(1e3f, m_aspect.x, m_image_size.x, width);
+        const auto min = scale_screen_to_local(1e-3f, slot.aspect.x, slot.size.x, width);
+        const auto max = scale_screen_to_local(1e3f, slot.aspect.x, slot.size.x, width);
 
         if (zoom == Zoom::In) {
             m_zoom = std::min(m_zoom * 1.1f, max);
@@ -291,8 +657,10 @@ namespace qoiview
 
     void QoiView::increment_offset(Vec2<> offset)
     {
-        m_offset.x -= offset.x / m_aspect.x / m_zoom * 2.0f;
-        m_offset.y -= offset.y / m_aspect.y / m_zoom * 2.0f;
+        const auto& aspect = m_slots.front().aspect;
+
+        m_offset.x -= offset.x / aspect.x / m_zoom * 2.0f;
+        m_offset.y -= offset.y / aspect.y / m_zoom * 2.0f;
         apply_uniform(Uniform::Offset);
     }
 
@@ -315,177 +683,808 @@ namespace qoiview
     {
         auto count  = static_cast<int>(Filter::count);
         auto filter = static_cast<Filter>((static_cast<int>(m_filter) + 1) % count);
-        update_filtering(filter, m_mipmap);
+        update_filtering(filter, m_minify);
         m_update_title = true;
     }
 
-    void QoiView::toggle_mipmap()
+    void QoiView::toggle_minify()
     {
-        update_filtering(m_filter, not m_mipmap);
+        auto count = static_cast<int>(Minify::count);
+        update_filtering(m_filter, static_cast<Minify>((static_cast<int>(m_minify) + 1) % count));
         m_update_title = true;
     }
 
-    void QoiView::file_next()
+    void QoiView::toggle_diff()
     {
-        if (m_files.size() == 1) {
+        if (not m_compare or m_slots.size() < 2) {
             return;
         }
 
-        auto prev = m_index;
-        m_index   = (m_index + 1) % m_files.size();
+        auto count = static_cast<int>(Diff::count);
+        m_diff     = static_cast<Diff>((static_cast<int>(m_diff) + 1) % count);
 
-        while (true and not m_files.empty()) {
-            m_index = m_index % m_files.size();
-            if (check_qoi(m_files[m_index])) {
-                break;
-            } else {
-                m_files.erase(m_files.begin() + static_cast<std::ptrdiff_t>(m_index));
-            }
-        }
+        // the grid collapses into a single viewport while diffing
+        int width, height;
+        glfwGetFramebufferSize(m_window, &width, &height);
+        update_aspect(width, height);
 
-        m_update_texture = prev >= m_files.size() or m_files[prev] != m_files[m_index];
-        m_update_title   = true;
+        apply_uniform(Uniform::Mode);
     }
 
-    void QoiView::file_previous()
+    void QoiView::toggle_histogram()
     {
-        if (m_files.size() == 1) {
+        m_show_histogram = not m_show_histogram;
+
+        const auto& slot = m_slots.front();
+        if (not m_show_histogram or not slot.decoded) {
             return;
         }
 
-        auto prev = m_index;
-        while (true and not m_files.empty()) {
-            m_index = (m_index + m_files.size() - 1) % m_files.size();
-            if (check_qoi(m_files[m_index])) {
-                break;
-            } else {
-                m_files.erase(m_files.begin() + static_cast<std::ptrdiff_t>(m_index));
+        // streams, feeds and playback move on too quickly to count every image, the one on screen is counted on demand
+        auto counted = std::optional<Histogram>{};
+        if (m_stream or m_playback or m_feed) {
+            counted.emplace(Histogram::compute(m_pool, slot_image(0)->pixels(), 4));
+            update_histogram(*counted);
+        }
+
+        const auto& histogram = counted ? *counted : slot.decoder->histogram();
+        fmt::println("{}:", slot_file(0).c_str());
+        for (auto c = 0uz; c < histogram.channels(); ++c) {
+            fmt::println("    {}: {}", "RGBA"[c], histogram.describe(c));
+        }
+    }
+
+    // bars are scaled to the tallest bin between the extremes, so clipping shows up as full height bars at the edges
+    void QoiView::update_histogram(const Histogram& histogram)
+    {
+        auto heights = std::array<std::array<qoipp::Byte, 4>, 256>{};
+        for (auto c = 0uz; c < std::min(histogram.channels(), 3uz); ++c) {
+            const auto& counts = histogram.counts(c);
+
+            auto peak = *sr::max_element(counts.begin() + 1, counts.end() - 1);
+            if (peak == 0) {
+                peak = sr::max(counts);
+            }
+
+            for (auto v = 0uz; v < 256; ++v) {
+                auto ratio    = peak == 0 ? 0.0 : static_cast<double>(counts[v]) / static_cast<double>(peak);
+                heights[v][c] = static_cast<qoipp::Byte>(std::min(ratio, 1.0) * 255.0 + 0.5);
             }
         }
 
-        m_update_texture = prev >= m_files.size() or m_files[prev] != m_files[m_index];
-        m_update_title   = true;
+        if (m_histogram_texture == 0) {
+            gl::glGenTextures(1, &m_histogram_texture);
+            gl::glBindTexture(gl::GL_TEXTURE_2D, m_histogram_texture);
+
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_NEAREST);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_NEAREST);
+        }
+
+        gl::glBindTexture(gl::GL_TEXTURE_2D, m_histogram_texture);
+        gl::glTexImage2D(
+            gl::GL_TEXTURE_2D, 0, gl::GL_RGBA, 256, 1, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, heights.data()
+        );
+
+        spdlog::info("Histogram of {:?}:", slot_file(0).c_str());
+        for (auto c = 0uz; c < histogram.channels(); ++c) {
+            spdlog::info("    {}: {}", "RGBA"[c], histogram.describe(c));
+        }
     }
 
-    void QoiView::reset_zoom()
+    // in the bottom-left corner, on top of whatever is drawn
+    void QoiView::draw_histogram(int fb_width, int fb_height)
     {
-        m_zoom = 1.0f;
-        apply_uniform(Uniform::Zoom);
+        auto width  = std::min(512, fb_width / 2);
+        auto height = width * 3 / 8;
+        auto margin = 8;
+
+        gl::glViewport(margin, margin, width, std::min(height, fb_height - 2 * margin));
+        gl::glUseProgram(m_overlay_program);
+        gl::glUniform1i(gl::glGetUniformLocation(m_overlay_program, "histogram"), 0);
+        gl::glBindTexture(gl::GL_TEXTURE_2D, m_histogram_texture);
+        gl::glDrawElements(gl::GL_TRIANGLES, indices.size(), gl::GL_UNSIGNED_INT, nullptr);
+        gl::glUseProgram(m_program);
+    }
+
+    void QoiView::toggle_inspector()
+    {
+        m_inspect      = not m_inspect;
         m_update_title = true;
     }
 
-    void QoiView::reset_offset()
+    void QoiView::begin_selection()
     {
-        m_offset = { 0.0f, 0.0f };
-        apply_uniform(Uniform::Offset);
+        m_selecting      = true;
+        m_selection_slot = slot_at(m_mouse);
+        m_selection_from = image_at(m_selection_slot, m_mouse);
+        m_selection      = selection_rect(m_selection_from);
     }
 
-    void QoiView::update_title()
+    void QoiView::end_selection()
     {
-        int width, height;
-        glfwGetWindowSize(m_window, &width, &height);
+        m_selecting = false;
+        m_selection = selection_rect(m_selection_from);
 
-        auto zoom = scale_local_to_screen(m_zoom, m_aspect.x, m_image_size.x, width);
-
-        auto title = fmt::format(
-            "[{}/{}] [{}x{}] [{:.2f}%] QoiView - {} [filter:{}|mipmap:{}]",
-            m_index + 1,
-            m_files.size(),
-            m_image_size.x,
-            m_image_size.y,
-            zoom * 100.0f,
-            m_files[m_index].filename().c_str(),
-            m_filter == Filter::Linear ? "linear" : "nearest",
-            m_mipmap ? "yes" : "no"
-        );
-        glfwSetWindowTitle(m_window, title.c_str());
+        const auto& slot = m_slots[m_selection_slot];
+        if (m_tiles and m_selection_slot == 0) {
+            spdlog::warn("Selection ignored: not available for a tiled image");
+            return;
+        } else if (not slot.decoded) {
+            spdlog::warn("Selection ignored: image is not decoded yet");
+            return;
+        }
+
+        // summarized off the render thread, the result is picked up by `report_selection`
+        if (not m_inspector.submit(slot_image(m_selection_slot), *m_selection)) {
+            spdlog::warn("Selection ignored: it is empty or the previous one is still being summarized");
+        }
     }
 
-    void QoiView::prepare_rect()
+    void QoiView::report_selection()
     {
-        gl::glGenVertexArrays(1, &m_vao);
-        gl::glBindVertexArray(m_vao);
-
-        gl::glGenBuffers(1, &m_vbo);
-        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, m_vbo);
-        gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(), gl::GL_STATIC_DRAW);
+        auto selection = m_inspector.poll();
+        if (not selection) {
+            return;
+        }
 
-        gl::glGenBuffers(1, &m_ebo);
-        gl::glBindBuffer(gl::GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-        gl::glBufferData(gl::GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(), gl::GL_STATIC_DRAW);
+        const auto& [rect, region] = *selection;
 
-        gl::glVertexAttribPointer(0, 2, gl::GL_FLOAT, gl::GL_FALSE, 4 * sizeof(float), (void*)0);
-        gl::glVertexAttribPointer(
-            1, 2, gl::GL_FLOAT, gl::GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float))
+        fmt::println(
+            "{} [{},{} {}x{}] {} pixels:",
+            slot_file(m_selection_slot).c_str(),
+            rect.x,
+            rect.y,
+            rect.width,
+            rect.height,
+            region.pixels
         );
-        gl::glEnableVertexAttribArray(0);
-        gl::glEnableVertexAttribArray(1);
-
-        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
-        gl::glBindVertexArray(0);
+        for (auto c = 0uz; c < 4; ++c) {
+            fmt::println(
+                "    {}: min {:>3}, max {:>3}, mean {:>6.2f}, stddev {:>6.2f}",
+                "RGBA"[c],
+                region.min[c],
+                region.max[c],
+                region.mean(c),
+                region.stddev(c)
+            );
+        }
     }
 
-    void QoiView::prepare_shader()
+    // a one pixel outline drawn with scissored clears, no geometry needed
+    void QoiView::draw_selection(int fb_width, int fb_height)
     {
-        auto buf     = std::array<char, 1024>{};
-        auto success = gl::GLint{};
+        auto index = m_selection_slot;
+        if (index >= m_slots.size() or (m_diff != Diff::Off and index != 0)) {
+            return;
+        }
 
-        auto vert = gl::glCreateShader(gl::GL_VERTEX_SHADER);
-        gl::glShaderSource(vert, 1, &vertex_shader, nullptr);
-        gl::glCompileShader(vert);
-        gl::glGetShaderiv(vert, gl::GL_COMPILE_STATUS, &success);
+        const auto& slot = m_slots[index];
 
-        if (success == false) {
-            gl::glGetShaderInfoLog(vert, buf.size(), nullptr, buf.data());
-            throw std::runtime_error{ fmt::format("Failed to compile vertex shader: {}", buf.data()) };
+        auto [cols, rows] = grid();
+        auto cell         = Vec2<int>{ fb_width / cols, fb_height / rows };
+        auto view         = raster::view_mapping(cell, slot.size, slot.aspect, m_zoom, m_offset);
+
+        auto cell_x = static_cast<int>(index) % cols * cell.x;
+        auto cell_y = static_cast<int>(index) / cols * cell.y;
+
+        // image pixels back to framebuffer pixels, y going up
+        auto to_x = [&](int u) { return static_cast<int>((u - view.origin.x) / view.scale.x) + cell_x; };
+        auto to_y = [&](int v) { return fb_height - static_cast<int>((v - view.origin.y) / view.scale.y) - cell_y; };
+
+        const auto& rect = *m_selection;
+
+        auto x0 = to_x(rect.x);
+        auto x1 = to_x(rect.x + rect.width);
+        auto y0 = to_y(rect.y + rect.height);
+        auto y1 = to_y(rect.y);
+
+        auto clear = std::array<float, 4>{};
+        gl::glGetFloatv(gl::GL_COLOR_CLEAR_VALUE, clear.data());
+
+        gl::glEnable(gl::GL_SCISSOR_TEST);
+        gl::glClearColor(1.0f, 0.8f, 0.0f, 1.0f);
+
+        auto edges = std::array{
+            std::array{ x0, y0, x1 - x0, 1 },        // bottom
+            std::array{ x0, y1 - 1, x1 - x0, 1 },    // top
+            std::array{ x0, y0, 1, y1 - y0 },        // left
+            std::array{ x1 - 1, y0, 1, y1 - y0 },    // right
+        };
+
+        for (auto [x, y, w, h] : edges) {
+            gl::glScissor(x, y, std::max(w, 1), std::max(h, 1));
+            gl::glClear(gl::GL_COLOR_BUFFER_BIT);
         }
 
-        auto frag = gl::glCreateShader(gl::GL_FRAGMENT_SHADER);
-        gl::glShaderSource(frag, 1, &fragment_shader, nullptr);
-        gl::glCompileShader(frag);
-        gl::glGetShaderiv(frag, gl::GL_COMPILE_STATUS, &success);
+        gl::glDisable(gl::GL_SCISSOR_TEST);
+        gl::glClearColor(clear[0], clear[1], clear[2], clear[3]);
+    }
 
-        if (success == false) {
-            gl::glGetShaderInfoLog(frag, buf.size(), nullptr, buf.data());
-            throw std::runtime_error{ fmt::format("Failed to compile fragment shader: {}", buf.data()) };
+    void QoiView::toggle_pause()
+    {
+        if (not m_playback or m_playback->preloading) {
+            return;
         }
 
-        m_program = gl::glCreateProgram();
-        gl::glAttachShader(m_program, vert);
-        gl::glAttachShader(m_program, frag);
-        gl::glLinkProgram(m_program);
-        gl::glGetProgramiv(m_program, gl::GL_LINK_STATUS, &success);
+        auto& player = *m_playback->player;
+        auto  now    = Player::Clock::now();
 
-        if (success == false) {
-            gl::glGetProgramInfoLog(m_program, buf.size(), nullptr, buf.data());
-            throw std::runtime_error{ fmt::format("Failed to link shader program: {}", buf.data()) };
+        if (player.paused()) {
+            player.resume(now);
+            if (not player.frame_at(player.step(now))) {
+                player.seek(0, now);    // played through once, start over
+            }
+            m_playback->backwards = false;
+            m_playback->step.reset();
+        } else {
+            player.pause(now);
         }
 
-        gl::glDeleteShader(vert);
-        gl::glDeleteShader(frag);
+        m_update_title = true;
+    }
+
+    // scrubbing: stepping pauses, holding the key steps on every repeat
+    void QoiView::step_playback(bool backwards)
+    {
+        if (m_playback->preloading) {
+            return;
+        }
+
+        auto& player = *m_playback->player;
+        auto  now    = Player::Clock::now();
+        auto  step   = player.step(now);
+
+        player.pause(now);
+        if (backwards and step == 0) {
+            return;
+        }
+
+        player.seek(backwards ? step - 1 : step + 1, now);
+        m_playback->backwards = backwards;
+        m_playback->step.reset();
     }
 
-    bool QoiView::prepare_texture()
+    void QoiView::update_playback()
     {
-        const auto& file = m_files[m_index];
+        auto& playback = *m_playback;
+        auto& player   = *playback.player;
+
+        if (playback.preloading) {
+            if (not playback.sequence->done()) {
+                // the title shows the progress
+                auto loaded = playback.sequence->loaded();
+                if (std::exchange(playback.loaded, loaded) != loaded) {
+                    m_update_title = true;
+                }
+                return;
+            }
+
+            auto elapsed = std::chrono::duration<double>(Player::Clock::now() - playback.since).count();
+            spdlog::info("Preloaded {} frames in {:.2f} s", playback.sequence->size(), elapsed);
+
+            playback.preloading = false;
+            playback.since      = Player::Clock::now();
+            player.resume(playback.since);
+        }
+
+        auto now   = Player::Clock::now();
+        auto step  = player.step(now);
+        auto ahead = [&](std::size_t i) {
+            return playback.backwards ? (i <= step ? player.frame_at(step - i) : std::nullopt)
+                                      : player.frame_at(step + i);
+        };
+
+        player.prefetch(step, playback.backwards);
+
+        // upload the next frame in play order that is decoded and not in the ring yet, one per iteration so a
+        // single frame never costs more than one texture upload
+        for (auto i = 0uz; i < Playback::ring_size; ++i) {
+            auto frame = ahead(i);
+            if (not frame) {
+                break;
+            } else if (sr::find(playback.frames, frame) != playback.frames.end()) {
+                continue;
+            }
+
+            auto image = player.ready(*frame);
+            if (not image) {
+                break;
+            }
+
+            // the texture holding the frame furthest from being shown, never the one on screen
+            auto upcoming = [&](std::size_t ring) {
+                for (auto j = 0uz; j < Playback::ring_size; ++j) {
+                    if (playback.frames[ring] == ahead(j)) {
+                        return j;
+                    }
+                }
+                return Playback::ring_size;
+            };
+
+            auto target = Playback::ring_size;
+            for (auto ring = 0uz; ring < Playback::ring_size; ++ring) {
+                if (playback.step and ring == playback.shown) {
+                    continue;
+                }
+                if (target == Playback::ring_size or upcoming(ring) > upcoming(target)) {
+                    target = ring;
+                }
+            }
+
+            upload_frame(target, *frame, std::move(image));
+            break;
+        }
+
+        // present the frame the clock is at if it has arrived, otherwise hold the one on screen
+        if (auto frame = player.frame_at(step); frame and playback.step != step) {
+            auto ring = sr::find(playback.frames, frame) - playback.frames.begin();
 
-        auto prep = m_decoder.prepare(file);
+            if (ring < static_cast<std::ptrdiff_t>(Playback::ring_size)) {
+                if (playback.step and step > *playback.step and not player.paused()) {
+                    playback.dropped += step - *playback.step - 1;
+                }
+
+                playback.shown = static_cast<std::size_t>(ring);
+                playback.step  = step;
+                ++playback.presented;
+
+                auto& slot   = m_slots.front();
+                auto  image  = playback.images[playback.shown];
+                auto  size   = Vec2<int>{ static_cast<int>(image->desc.width), static_cast<int>(image->desc.height) };
+                slot.rows    = image->desc.height;
+                slot.decoded = true;
+
+                if (size.x != slot.size.x or size.y != slot.size.y) {
+                    slot.size = size;
+
+                    int width, height;
+                    glfwGetWindowSize(m_window, &width, &height);
+                    update_aspect(width, height);
+                }
+
+                m_index        = *frame;
+                m_update_title = true;
+            }
+        } else if (not frame and not player.paused()) {
+            player.pause(now);    // played through once
+            m_update_title = true;
+        }
+
+        auto elapsed = std::chrono::duration<double>(now - playback.since).count();
+        if (elapsed >= 1.0) {
+            playback.achieved  = static_cast<double>(playback.presented) / elapsed;
+            playback.since     = now;
+            playback.presented = 0;
+
+            if (not player.paused()) {
+                spdlog::debug(
+                    "Playback: {:.2f}/{:.2f} fps, {} dropped", playback.achieved, player.fps(), playback.dropped
+                );
+            }
+            m_update_title = true;
+        }
+    }
+
+    void QoiView::upload_frame(std::size_t ring, std::size_t frame, std::shared_ptr<const Image> image)
+    {
+        auto& playback = *m_playback;
+
+        auto w = static_cast<gl::GLsizei>(image->desc.width);
+        auto h = static_cast<gl::GLsizei>(image->desc.height);
+
+        const auto& previous = playback.images[ring];
+        auto        resize   = not previous or previous->desc.width != image->desc.width
+                        or previous->desc.height != image->desc.height;
+
+        // the texture still holds the frame uploaded into it before, only the rows that differ are replaced
+        auto uploaded = true;
+        if (resize) {
+            auto data = image->pixels().data();
+            gl::glBindTexture(gl::GL_TEXTURE_2D, playback.textures[ring]);
+            gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_RGBA, w, h, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, data);
+        } else {
+            auto band = AsyncDecoder::Band{ .data = image->pixels(), .start = 0, .count = image->desc.height };
+            uploaded  = upload_changed(playback.textures[ring], *previous, band);
+        }
+
+        if (m_minify == Minify::Mipmap and uploaded) {
+            gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+        }
+
+        playback.images[ring] = std::move(image);
+        playback.frames[ring] = frame;
+    }
+
+    void QoiView::update_feed()
+    {
+        auto& state = *m_feed;
+        auto& slot  = m_slots.front();
+
+        // only the newest frame is taken, the ones that arrived since the last are never uploaded
+        if (auto frame = state.receiver->take()) {
+            const auto& desc = frame->image->desc;
+
+            auto uploaded = true;
+            if (slot.shown and slot.shown->desc.width == desc.width and slot.shown->desc.height == desc.height) {
+                auto band = AsyncDecoder::Band{ .data = frame->image->pixels(), .start = 0, .count = desc.height };
+                uploaded  = upload_changed(slot.texture, *slot.shown, band);
+            } else {
+                allocate_texture(slot, desc);
+                gl::glTexSubImage2D(
+                    gl::GL_TEXTURE_2D,
+                    0,
+                    0,
+                    0,
+                    slot.size.x,
+                    slot.size.y,
+                    gl::GL_RGBA,
+                    gl::GL_UNSIGNED_BYTE,
+                    frame->image->pixels().data()
+                );
+            }
+
+            if (m_minify == Minify::Mipmap and uploaded) {
+                gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+            }
+
+            slot.id      = frame->number;
+            slot.image   = frame->image;
+            slot.shown   = slot.image;
+            slot.rows    = desc.height;
+            slot.decoded = true;
+
+            state.dropped += frame->number - state.last - 1;
+            state.last     = frame->number;
+            state.total   += std::chrono::duration<double, std::milli>(feed::Clock::now() - frame->sent).count();
+            ++state.presented;
+        }
+
+        auto now     = feed::Clock::now();
+        auto elapsed = std::chrono::duration<double>(now - state.since).count();
+        if (elapsed >= 1.0) {
+            state.achieved  = static_cast<double>(state.presented) / elapsed;
+            state.latency   = state.presented == 0 ? 0.0 : state.total / static_cast<double>(state.presented);
+            state.since     = now;
+            state.presented = 0;
+            state.total     = 0.0;
+
+            if (state.last > 0) {
+                spdlog::debug(
+                    "Feed: {:.2f} fps, {:.2f} ms latency, {} dropped", state.achieved, state.latency, state.dropped
+                );
+            }
+            m_update_title = true;
+        }
+    }
+
+    void QoiView::update_metrics()
+    {
+        if (not m_compare or m_slots.size() < 2) {
+            return;
+        }
+
+        if (not m_metrics.update(m_pool, m_slots[0].rows, m_slots[1].rows)) {
+            return;
+        }
+
+        m_update_title = m_update_title or m_diff != Diff::Off;
+
+        if (m_metrics.complete()) {
+            const auto& stats = m_metrics.stats();
+            spdlog::info(
+                "Difference: PSNR {:.2f} dB, max error {}, {} of {} pixels differ",
+                stats.psnr(),
+                stats.max_error,
+                stats.differing,
+                stats.pixels
+            );
+        }
+    }
+
+    void QoiView::file_next()
+    {
+        if (m_playback) {
+            step_playback(false);
+            return;
+        } else if (m_compare or m_files.size() == 1) {
+            return;
+        }
+
+        auto prev   = m_index;
+        m_index     = (m_index + 1) % m_files.size();
+        m_backwards = false;
+
+        while (true and not m_files.empty()) {
+            m_index = m_index % m_files.size();
+            if (check_qoi(m_files[m_index])) {
+                break;
+            } else {
+                m_files.erase(m_files.begin() + static_cast<std::ptrdiff_t>(m_index));
+            }
+        }
+
+        m_update_texture = prev >= m_files.size() or m_files[prev] != m_files[m_index];
+        m_update_title   = true;
+        m_selection.reset();
+    }
+
+    void QoiView::file_previous()
+    {
+        if (m_playback) {
+            step_playback(true);
+            return;
+        } else if (m_compare or m_files.size() == 1) {
+            return;
+        }
+
+        auto prev   = m_index;
+        m_backwards = true;
+        while (true and not m_files.empty()) {
+            m_index = (m_index + m_files.size() - 1) % m_files.size();
+            if (check_qoi(m_files[m_index])) {
+                break;
+            } else {
+                m_files.erase(m_files.begin() + static_cast<std::ptrdiff_t>(m_index));
+            }
+        }
+
+        m_update_texture = prev >= m_files.size() or m_files[prev] != m_files[m_index];
+        m_update_title   = true;
+        m_selection.reset();
+    }
+
+    void QoiView::reset_zoom()
+    {
+        m_zoom = 1.0f;
+        apply_uniform(Uniform::Zoom);
+        m_update_title = true;
+    }
+
+    void QoiView::reset_offset()
+    {
+        m_offset = { 0.0f, 0.0f };
+        apply_uniform(Uniform::Offset);
+    }
+
+    void QoiView::update_title()
+    {
+        const auto& slot  = m_slots.front();
+        const auto  width = cell_size().x;
+
+        auto zoom   = scale_local_to_screen(m_zoom, slot.aspect.x, slot.size.x, width);
+        auto filter = m_filter == Filter::Linear ? "linear" : "nearest";
+        auto minify = std::array{ "shader", "mipmap", "off" }[static_cast<std::size_t>(m_minify)];
+
+        auto title = std::string{};
+
+        if (m_compare and m_diff != Diff::Off) {
+            const auto& stats = m_metrics.stats();
+
+            auto summary = std::string{ "sizes differ" };
+            if (m_metrics.comparable()) {
+                auto differing = static_cast<double>(stats.differing);
+                auto percent   = stats.pixels == 0 ? 0.0 : 100.0 * differing / static_cast<double>(stats.pixels);
+                summary        = fmt::format(
+                    "PSNR {:.2f} dB|max {}|{} px differ ({:.3f}%){}",
+                    stats.psnr(),
+                    stats.max_error,
+                    stats.differing,
+                    percent,
+                    m_metrics.complete() ? "" : "|partial"
+                );
+            }
+
+            title = fmt::format(
+                "[diff:{}] [{:.2f}%] QoiView - {} vs {} [{}]",
+                m_diff == Diff::Absolute ? "absolute" : "threshold",
+                zoom * 100.0f,
+                m_files[0].filename().c_str(),
+                m_files[1].filename().c_str(),
+                summary
+            );
+        } else if (m_stream) {
+            title = fmt::format(
+                "[{} {}] [{}x{}] [{:.2f}%] QoiView - {} [filter:{}|minify:{}]",
+                m_stream->ended() ? "ended after" : "image",
+                slot.id,
+                slot.size.x,
+                slot.size.y,
+                zoom * 100.0f,
+                m_stream->name(),
+                filter,
+                minify
+            );
+        } else if (m_feed) {
+            title = fmt::format(
+                "[feed {}] [{:.1f} fps|latency {:.1f} ms|dropped {}] [{}x{}] [{:.2f}%] QoiView - {} "
+                "[filter:{}|minify:{}]",
+                m_feed->last,
+                m_feed->achieved,
+                m_feed->latency,
+                m_feed->dropped,
+                slot.size.x,
+                slot.size.y,
+                zoom * 100.0f,
+                m_feed->receiver->socket().c_str(),
+                filter,
+                minify
+            );
+        } else if (m_playback) {
+            const auto& player = *m_playback->player;
+
+            auto state = std::string{ player.paused() ? "paused" : "play" };
+            if (m_playback->preloading) {
+                state = fmt::format("preloading {}%", m_playback->loaded * 100 / m_playback->sequence->size());
+            }
+
+            title = fmt::format(
+                "[{}] [{}/{}] [{:.1f}/{:.1f} fps|dropped {}] [{:.2f}%] QoiView - {} [filter:{}|minify:{}]",
+                state,
+                m_index + 1,
+                m_files.size(),
+                m_playback->achieved,
+                player.fps(),
+                m_playback->dropped,
+                zoom * 100.0f,
+                m_files[m_index].filename().c_str(),
+                filter,
+                minify
+            );
+        } else if (m_compare) {
+            auto names = m_files | sv::take(m_slots.size())
+                       | sv::transform([](const fs::path& path) { return path.filename().string(); });
+
+            title = fmt::format(
+                "[compare] [{:.2f}%] QoiView - {} [filter:{}|minify:{}]",
+                zoom * 100.0f,
+                fmt::join(names, " | "),
+                filter,
+                minify
+            );
+        } else {
+            auto tiled = std::string{};
+            if (m_tiles) {
+                tiled = m_tiles->image->finished() ? " [tiled]" : " [tiling]";
+            }
+
+            title = fmt::format(
+                "[{}/{}] [{}x{}]{} [{:.2f}%] QoiView - {} [filter:{}|minify:{}]",
+                m_index + 1,
+                m_files.size(),
+                slot.size.x,
+                slot.size.y,
+                tiled,
+                zoom * 100.0f,
+                m_files[m_index].filename().c_str(),
+                filter,
+                minify
+            );
+        }
+
+        if (m_inspect) {
+            auto index = slot_at(m_mouse);
+            auto at    = image_at(index, m_mouse);
+            auto image = slot_image(index);
+            auto x     = static_cast<int>(std::floor(at.x));
+            auto y     = static_cast<int>(std::floor(at.y));
+            auto pixel = image ? Inspector::pixel(*image, { x, y }, m_slots[index].rows) : std::nullopt;
+
+            if (pixel) {
+                auto [r, g, b, a] = *pixel;
+                title += fmt::format(" [{},{}: #{:02x}{:02x}{:02x}{:02x} ({} {} {} {})]", x, y, r, g, b, a, r, g, b, a);
+            } else {
+                title += " [-]";
+            }
+        }
+
+        glfwSetWindowTitle(m_window, title.c_str());
+    }
+
+    void QoiView::prepare_rect()
+    {
+        gl::glGenVertexArrays(1, &m_vao);
+        gl::glBindVertexArray(m_vao);
+
+        gl::glGenBuffers(1, &m_vbo);
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, m_vbo);
+        gl::glBufferData(gl::GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(), gl::GL_STATIC_DRAW);
+
+        gl::glGenBuffers(1, &m_ebo);
+        gl::glBindBuffer(gl::GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+        gl::glBufferData(gl::GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(), gl::GL_STATIC_DRAW);
+
+        gl::glVertexAttribPointer(0, 2, gl::GL_FLOAT, gl::GL_FALSE, 4 * sizeof(float), (void*)0);
+        gl::glVertexAttribPointer(
+            1, 2, gl::GL_FLOAT, gl::GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float))
+        );
+        gl::glEnableVertexAttribArray(0);
+        gl::glEnableVertexAttribArray(1);
+
+        gl::glBindBuffer(gl::GL_ARRAY_BUFFER, 0);
+        gl::glBindVertexArray(0);
+    }
+
+    void QoiView::prepare_shader()
+    {
+        m_program         = compile_program(vertex_shader, fragment_shader);
+        m_overlay_program = compile_program(overlay_vertex_shader, overlay_fragment_shader);
+    }
+
+    void QoiView::prepare_slots(std::size_t count)
+    {
+        while (m_slots.size() > count) {
+            if (m_textures and m_slots.back().resident != 0) {
+                m_textures->unpin(m_slots.back().resident);
+            }
+            gl::glDeleteTextures(1, &m_slots.back().texture);
+            m_slots.pop_back();
+        }
+
+        while (m_slots.size() < count) {
+            auto& slot   = m_slots.emplace_back();
+            slot.decoder = std::make_unique<AsyncDecoder>();
+            slot.decoder->set_cache(m_cache);
+            slot.decoder->set_pool(&m_pool);
+            slot.decoder->set_follow(m_follow);
+            slot.decoder->launch();
+        }
+    }
+
+    bool QoiView::prepare_texture(Slot& slot, const fs::path& file)
+    {
+        // only an image browsed on its own is tiled, the other modes need its pixels
+        auto single = &slot == &m_slots.front() and not m_compare and not m_follow and not m_playback;
+        if (single and m_memory > 0) {
+            auto desc = archive::read_header(file);
+            if (desc and std::size_t{ desc->width } * desc->height * 4 > m_memory) {
+                return open_tiled(slot, file, *desc);
+            }
+        }
+        if (single) {
+            close_tiled();
+        }
+
+        auto prep = slot.decoder->prepare(file);
         if (not prep) {
             spdlog::info("Failed to decode file {:?}: {}", file.c_str(), to_string(prep.error()));
             return false;
         }
 
-        if (m_texture == 0) {
-            gl::glGenTextures(1, &m_texture);
-            gl::glBindTexture(gl::GL_TEXTURE_2D, m_texture);
+        keep_texture(slot);
+        if (slot.resident != 0) {
+            m_textures->unpin(slot.resident);
+            slot.resident = 0;
+        }
+
+        // a resident image is drawn from its texture at once, the decode only provides its pixels to the rest
+        slot.key = m_textures and not m_follow and not m_stream and not m_feed ? DecodedCache::key_of(file)
+                                                                                : std::nullopt;
+        if (slot.key) {
+            m_textures->touch(*slot.key);
+            slot.resident = m_textures->pin(*slot.key);
+        }
+
+        slot.id      = prep->id;
+        slot.decoded = false;
+        slot.decoder->start();
+
+        return true;
+    }
+
+    void QoiView::allocate_texture(Slot& slot, const qoipp::Desc& desc)
+    {
+        if (slot.texture == 0) {
+            gl::glGenTextures(1, &slot.texture);
+            gl::glBindTexture(gl::GL_TEXTURE_2D, slot.texture);
 
             gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
             gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
-            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, gl::GL_LINEAR_MIPMAP_LINEAR);
-            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
+            apply_filtering();
         }
 
-        auto&& [desc, buffer] = *prep;
+        gl::glBindTexture(gl::GL_TEXTURE_2D, slot.texture);
 
         auto w = static_cast<gl::GLint>(desc.width);
         auto h = static_cast<gl::GLint>(desc.height);
@@ -493,47 +1492,946 @@ namespace qoiview
         // NOTE: clear texture without copying data: https://stackoverflow.com/a/7196109
         gl::glTexImage2D(gl::GL_TEXTURE_2D, 0, gl::GL_RGBA, w, h, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, NULL);
         const auto clear_color = std::array{ 0.0, 0.0, 0.0, 0.0 };
-        gl::glClearTexImage(m_texture, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, clear_color.data());
+        gl::glClearTexImage(slot.texture, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, clear_color.data());
 
         gl::glUseProgram(m_program);
         apply_uniform(Uniform::Tex);
 
         gl::glActiveTexture(gl::GL_TEXTURE0);
 
-        m_image_size = {
+        resize_slot(slot, desc);
+    }
+
+    void QoiView::resize_slot(Slot& slot, const qoipp::Desc& desc)
+    {
+        slot.size = {
             .x = static_cast<int>(desc.width),
             .y = static_cast<int>(desc.height),
         };
 
-        m_decoder.start();
+        int width, height;
+        glfwGetWindowSize(m_window, &width, &height);
+        update_aspect(width, height);
+    }
+
+    void QoiView::keep_texture(Slot& slot)
+    {
+        if (not m_textures or not slot.key or slot.resident != 0 or slot.texture == 0 or not slot.decoded) {
+            return;
+        } else if (exact_bytes(slot.image->desc) > m_textures->budget()) {
+            return;    // the cache would delete it right away, the slot keeps drawing it from its own texture
+        }
+
+        // rows still held back out of view go in first, the cache only holds whole images
+        if (not slot.pending.empty()) {
+            upload_pending(slot, { 0, 0 }, std::numeric_limits<std::size_t>::max());
+        }
+
+        if (m_minify == Minify::Mipmap) {
+            gl::glBindTexture(gl::GL_TEXTURE_2D, slot.texture);
+            gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+        }
+
+        m_textures->insert(exact_entry(*slot.key, slot.texture, slot.image->desc));
+
+        slot.resident = m_textures->pin(*slot.key);
+        slot.texture  = 0;
+        slot.kept     = slot.key;
+    }
+
+    void QoiView::process_events()
+    {
+        for (auto i = 0uz; i < m_slots.size(); ++i) {
+            auto& slot     = m_slots[i];
+            auto  uploaded = false;
+            auto  live     = m_stream and i == 0;
+            auto  poll     = [&] { return live ? m_stream->poll() : slot.decoder->poll(); };
+
+            while (auto event = poll()) {
+                // every image of a stream follows the previous one, none are cancelled
+                if (live and std::holds_alternative<AsyncDecoder::Prepared>(event->payload)) {
+                    slot.id        = event->id;
+                    slot.decoded   = false;
+                    m_update_title = true;
+                } else if (event->id != slot.id) {
+                    continue;    // left over from a cancelled decode, its rows belong to another image
+                }
+
+                auto handler = Overload{
+                    [&](const AsyncDecoder::Prepared& prepared) {
+                        // a cancelled image left some of its rows behind, the texture can't be diffed against;
+                        // a finished one still waiting for rows out of view gets them before it is replaced
+                        if (std::exchange(slot.partial, false)) {
+                            slot.pending.clear();
+                            slot.shown.reset();
+                            slot.kept.reset();
+                        } else if (not slot.pending.empty()) {
+                            uploaded |= upload_pending(slot, { 0, 0 }, std::numeric_limits<std::size_t>::max());
+                        }
+
+                        slot.rows  = 0;
+                        slot.image = prepared.image;
+
+                        const auto& desc = prepared.desc;
+                        if (slot.resident != 0) {
+                            resize_slot(slot, desc);
+                            return;
+                        }
+
+                        slot.dirty = slot.shown and slot.shown->desc.width == desc.width
+                                 and slot.shown->desc.height == desc.height;
+
+                        // the texture of `shown` went into the cache, diffing starts from a copy of it
+                        if (slot.dirty and slot.texture == 0) {
+                            auto source = slot.kept ? m_textures->pin(*slot.kept) : 0;
+                            if (source != 0) {
+                                allocate_texture(slot, desc);
+                                copy_texture(source, slot.texture, slot.size);
+                                m_textures->unpin(source);
+                            }
+                            slot.dirty = source != 0;
+                        }
+
+                        if (not slot.dirty) {
+                            slot.shown.reset();
+                            slot.kept.reset();
+                            allocate_texture(slot, prepared.desc);
+                        }
+                    },
+                    // uploaded after the events, so that rows in view don't wait behind the ones above them
+                    [&](const AsyncDecoder::Band& band) {
+                        slot.rows = std::max(slot.rows, band.start + band.count);
+                        if (slot.resident != 0) {
+                            return;
+                        }
+
+                        slot.partial = true;
+
+                        auto& pending = slot.pending;
+                        if (not pending.empty() and pending.back().start + pending.back().count == band.start) {
+                            pending.back().count += band.count;
+                        } else {
+                            pending.push_back({ band.start, band.count });
+                        }
+                    },
+                    [&](const AsyncDecoder::Finished& finished) {
+                        slot.decoded = true;
+                        slot.partial = false;
+
+                        // the rows never decoded are zero in the image but still hold the previous one on screen
+                        const auto height = std::size_t{ slot.image->desc.height };
+                        if (finished.truncated and slot.dirty and slot.resident == 0 and slot.rows < height) {
+                            slot.pending.push_back({ slot.rows, height - slot.rows });
+                        }
+
+                        if (slot.pending.empty() and slot.resident == 0) {
+                            slot.shown = slot.image;
+                            slot.kept.reset();
+                        }
+
+                        // a truncated image isn't worth keeping
+                        if (finished.truncated) {
+                            slot.key.reset();
+                        } else if (m_transcoder and slot.key and not m_textures->contains(*slot.key, false)) {
+                            m_transcoder->submit(*slot.key, slot.image);
+                        }
+                        if (&slot == &m_slots.front() and not live) {
+                            update_histogram(slot.decoder->histogram());
+                        }
+                        spdlog::debug("Image {} finished{}", event->id, finished.truncated ? " (trunc)" : "");
+                    },
+                    [&](const AsyncDecoder::Failed& failed) {
+                        spdlog::info("Image {} failed: {}", event->id, to_string(failed.error));
+                    },
+                };
+                std::visit(handler, event->payload);
+            }
+
+            uploaded |= upload_pending(slot, visible_rows(i), upload_budget);
+
+            if (m_minify == Minify::Mipmap and uploaded) {
+                gl::glBindTexture(gl::GL_TEXTURE_2D, slot.texture);
+                gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+            }
+
+            if (slot.pending.empty()) {
+                keep_texture(slot);
+            }
+
+            if (live and m_stream->ended() and not std::exchange(m_stream_ended, true)) {
+                m_update_title = true;
+            }
+        }
+    }
+
+    void QoiView::update_transcoder()
+    {
+        if (not m_transcoder) {
+            return;
+        }
+
+        while (auto done = m_transcoder->poll()) {
+            auto& [key, texture, seconds] = *done;
+
+            auto format = texture.format == etc2::Format::Rgb ? gl::GL_COMPRESSED_RGB8_ETC2
+                                                              : gl::GL_COMPRESSED_RGBA8_ETC2_EAC;
+
+            // compressed textures can't have their mipmaps generated, they are sampled from the base level only and
+            // minified by the shader like the others
+            auto entry = TextureCache::Entry{
+                .key     = std::move(key),
+                .texture = 0,
+                .size    = texture.size,
+                .bytes   = texture.blocks.size(),
+                .exact   = false,
+            };
+            gl::glGenTextures(1, &entry.texture);
+            gl::glBindTexture(gl::GL_TEXTURE_2D, entry.texture);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+            apply_filtering(false);
+
+            gl::glCompressedTexImage2D(
+                gl::GL_TEXTURE_2D,
+                0,
+                format,
+                texture.size.x,
+                texture.size.y,
+                0,
+                static_cast<gl::GLsizei>(texture.blocks.size()),
+                texture.blocks.data()
+            );
+
+            m_textures->insert(std::move(entry));
+
+            spdlog::info(
+                "Textures: {:.1f} of {:.1f} MiB in use, transcoding at {:.1f} MPx/s",
+                static_cast<double>(m_textures->used()) / 1024.0 / 1024.0,
+                static_cast<double>(m_textures->budget()) / 1024.0 / 1024.0,
+                m_transcoder->throughput() / 1e6
+            );
+        }
+    }
+
+    void QoiView::update_prefetch()
+    {
+        if (not m_textures or m_compare or m_playback or m_stream or m_feed or m_follow or m_files.size() < 2) {
+            return;
+        }
+
+        // chosen once the image on screen is decoded, so that decoding the next ones doesn't slow it down
+        if (m_slots.front().decoded and m_prefetch_from != m_index) {
+            m_prefetch_from = m_index;
+            m_upcoming.clear();
+
+            auto count = m_files.size();
+            for (auto n = 1uz; n <= std::min(prefetch_count, count - 1); ++n) {
+                auto index = m_backwards ? (m_index + count - n) % count : (m_index + n) % count;
+                auto key   = DecodedCache::key_of(m_files[index]);
+                if (not key) {
+                    continue;
+                }
+
+                // an image over the memory limit is only ever tiled, never decoded whole
+                auto desc = archive::read_header(m_files[index]);
+                if (not desc or (m_memory > 0 and std::size_t{ desc->width } * desc->height * 4 > m_memory)) {
+                    continue;
+                }
+
+                auto queued = sr::any_of(m_prefetch, [&](const Prefetch& p) { return p.key == *key; });
+                if (not queued and not m_textures->contains(*key, true)) {
+                    auto image = m_pool.submit([file = m_files[index], key = *key, cache = m_cache] {
+                        auto cached = cache ? cache->find(key) : nullptr;
+                        return cached ? cached : Sequence::decode(file);
+                    });
+                    m_prefetch.push_back({ *key, std::move(image) });
+                }
+                m_upcoming.push_back(*std::move(key));
+            }
+        }
+
+        // one upload per frame, like the playback ring
+        auto ready = sr::find_if(m_prefetch, [](Prefetch& p) {
+            return p.image.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready;
+        });
+        if (ready == m_prefetch.end()) {
+            return;
+        }
+
+        auto key   = std::move(ready->key);
+        auto image = ready->image.get();
+        m_prefetch.erase(ready);
+
+        // moved on in the meantime
+        if (not image or sr::find(m_upcoming, key) == m_upcoming.end() or m_textures->contains(key, true)) {
+            return;
+        } else if (exact_bytes(image->desc) > m_textures->budget()) {
+            return;    // too large for the cache, it would be deleted as soon as it's uploaded
+        }
+
+        if (m_cache) {
+            m_cache->insert(key, image);
+        }
+
+        auto texture = gl::GLuint{ 0 };
+        gl::glGenTextures(1, &texture);
+        gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+        gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+        apply_filtering();
+
+        gl::glTexImage2D(
+            gl::GL_TEXTURE_2D,
+            0,
+            gl::GL_RGBA,
+            static_cast<gl::GLsizei>(image->desc.width),
+            static_cast<gl::GLsizei>(image->desc.height),
+            0,
+            gl::GL_RGBA,
+            gl::GL_UNSIGNED_BYTE,
+            image->pixels().data()
+        );
+        if (m_minify == Minify::Mipmap) {
+            gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+        }
+
+        spdlog::debug("Prefetched texture: {}", key.path.c_str());
+        m_textures->insert(exact_entry(std::move(key), texture, image->desc));
+    }
+
+    bool QoiView::open_tiled(Slot& slot, const fs::path& file, const qoipp::Desc& desc)
+    {
+        close_tiled();
+
+        // half of the limit goes to decoding and loading the tiles, the other half to their textures
+        auto tile = TiledImage::plan(desc, m_memory / 2, m_pool.size());
+        if (not tile) {
+            spdlog::error("Image {:?} is too wide to be tiled within {} MiB", file.c_str(), m_memory >> 20);
+            return false;
+        }
+
+        // the pixels of the previous image would count against the limit too
+        slot.decoder->cancel();
+        if (slot.resident != 0) {
+            m_textures->unpin(slot.resident);
+            slot.resident = 0;
+        }
+
+        slot.id      = 0;
+        slot.rows    = 0;
+        slot.decoded = false;
+        slot.dirty   = false;
+        slot.partial = false;
+        slot.image.reset();
+        slot.shown.reset();
+        slot.kept.reset();
+        slot.key.reset();
+        slot.pending.clear();
+
+        try {
+            auto image    = std::make_unique<TiledImage>(m_pool, file, *tile);
+            auto capacity = m_memory / 2 / ((*tile + 2) * (*tile + 2) * 4);
+            m_tiles.emplace();
+            m_tiles->image    = std::move(image);
+            m_tiles->capacity = std::max(capacity, 1uz);
+        } catch (const std::runtime_error& e) {
+            spdlog::error("Failed to tile {:?}: {}", file.c_str(), e.what());
+            return false;
+        }
+
+        resize_slot(slot, desc);
+        m_update_title = true;
+
+        return true;
+    }
+
+    void QoiView::close_tiled()
+    {
+        if (not m_tiles) {
+            return;
+        }
+
+        // loads still running keep the cache file open on their own
+        for (auto [index, texture] : m_tiles->textures) {
+            gl::glDeleteTextures(1, &texture);
+        }
+        m_tiles.reset();
+    }
+
+    void QoiView::update_tiles()
+    {
+        if (not m_tiles) {
+            return;
+        }
+
+        auto& tiles = *m_tiles;
+        auto& image = *tiles.image;
+
+        std::erase_if(tiles.loading, [&](Tiles::Load& load) {
+            if (load.pixels.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready) {
+                return false;
+            }
+
+            auto pixels = load.pixels.get();
+            if (not pixels) {
+                spdlog::warn("Failed to load tile {}: {}", load.index, to_string(pixels.error()));
+                return true;
+            }
+
+            auto texture = gl::GLuint{};
+            gl::glGenTextures(1, &texture);
+            gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_S, gl::GL_CLAMP_TO_EDGE);
+            gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_WRAP_T, gl::GL_CLAMP_TO_EDGE);
+            apply_filtering(false);
+
+            gl::glTexImage2D(
+                gl::GL_TEXTURE_2D,
+                0,
+                gl::GL_RGBA,
+                static_cast<gl::GLsizei>(load.size.x),
+                static_cast<gl::GLsizei>(load.size.y),
+                0,
+                gl::GL_RGBA,
+                gl::GL_UNSIGNED_BYTE,
+                pixels->data()
+            );
+
+            tiles.textures.emplace_front(load.index, texture);
+            tiles.lookup[load.index] = tiles.textures.begin();
+
+            while (tiles.textures.size() > tiles.capacity) {
+                auto [evicted, old] = tiles.textures.back();
+                gl::glDeleteTextures(1, &old);
+                tiles.lookup.erase(evicted);
+                tiles.textures.pop_back();
+            }
+            return true;
+        });
+
+        if (image.finished() and not std::exchange(tiles.reported, true)) {
+            update_histogram(image.histogram());
+            m_update_title = true;
+        }
+
+        // as many loads at once as the footprint of the image leaves room for
+        const auto max_loading = 2 * m_pool.size();
+        const auto levels      = image.levels().size();
+
+        auto request = [&](std::size_t level, std::size_t column, std::size_t row) {
+            auto index   = image.index(level, column, row);
+            auto pending = sr::any_of(tiles.loading, [&](const Tiles::Load& load) { return load.index == index; });
+            if (tiles.loading.size() < max_loading and not pending and not tiles.lookup.contains(index)
+                and image.available(index)) {
+                tiles.loading.push_back({ index, image.padded(level, column, row).size, image.load(index) });
+            }
+        };
+
+        // the coarsest level is a single tile, with it there is always something on screen
+        request(levels - 1, 0, 0);
+        if (tiles.loading.size() >= max_loading) {
+            return;
+        }
+
+        // the tiles in view from the center out
+        const auto& slot = m_slots.front();
+        auto        span = visible_tiles(slot, tile_level(slot));
+
+        auto order = std::vector<Vec2<std::size_t>>{};
+        for (auto row = span.from.y; row < span.to.y; ++row) {
+            for (auto column = span.from.x; column < span.to.x; ++column) {
+                order.push_back({ column, row });
+            }
+        }
+
+        auto center   = Vec2<double>{
+            static_cast<double>(span.from.x + span.to.x) / 2.0,
+            static_cast<double>(span.from.y + span.to.y) / 2.0,
+        };
+        auto distance = [&](Vec2<std::size_t> at) {
+            auto dx = static_cast<double>(at.x) + 0.5 - center.x;
+            auto dy = static_cast<double>(at.y) + 0.5 - center.y;
+            return dx * dx + dy * dy;
+        };
+        sr::sort(order, {}, distance);
+
+        for (auto [column, row] : order) {
+            request(span.level, column, row);
+        }
+    }
 
+    void QoiView::draw_tiles(const Slot& slot)
+    {
+        auto&       tiles  = *m_tiles;
+        const auto& image  = *tiles.image;
+        const auto& levels = image.levels();
+        const auto  tile   = image.tile_size();
+
+        auto loc    = [this](const char* name) { return gl::glGetUniformLocation(m_program, name); };
+        auto region = loc("region");
+        auto crop   = loc("crop");
+        auto minify = loc("minify");
+
+        // the part of its level a tile covers, left, top, right and bottom in [0, 1]
+        auto bounds = [&](std::size_t level, std::size_t column, std::size_t row) {
+            const auto& size = levels[level].size;
+
+            auto [w, h] = image.extent(level, column, row);
+            auto x      = static_cast<double>(column * tile);
+            auto y      = static_cast<double>(row * tile);
+            auto sx     = static_cast<double>(size.x);
+            auto sy     = static_cast<double>(size.y);
+
+            return std::array{ x / sx, y / sy, (x + static_cast<double>(w)) / sx, (y + static_cast<double>(h)) / sy };
+        };
+
+        auto span = visible_tiles(slot, tile_level(slot));
+        auto base = minification(slot);
+
+        for (auto row = span.from.y; row < span.to.y; ++row) {
+            for (auto column = span.from.x; column < span.to.x; ++column) {
+                auto [x0, y0, x1, y1] = bounds(span.level, column, row);
+
+                // the tile itself, or the part of the nearest coarser one under it while it loads
+                for (auto level = span.level; level < levels.size(); ++level) {
+                    auto shift = level - span.level;
+                    auto found = tiles.lookup.find(image.index(level, column >> shift, row >> shift));
+                    if (found == tiles.lookup.end()) {
+                        continue;
+                    }
+
+                    auto [u0, v0, u1, v1] = bounds(level, column >> shift, row >> shift);
+                    auto [origin, size]   = image.padded(level, column >> shift, row >> shift);
+                    auto [w, h]           = image.extent(level, column >> shift, row >> shift);
+                    auto texture          = found->second->second;
+                    tiles.textures.splice(tiles.textures.begin(), tiles.textures, found->second);
+
+                    auto f     = [](double value) { return static_cast<float>(value); };
+                    auto scale = static_cast<double>(levels[level].size.x) / static_cast<double>(levels[0].size.x);
+
+                    // from the part of the tile's extent covered to the texture, which holds a border around it
+                    auto s = [&](double value) {
+                        return f((static_cast<double>(origin.x) + value * static_cast<double>(w))
+                                 / static_cast<double>(size.x));
+                    };
+                    auto t = [&](double value) {
+                        return f((static_cast<double>(origin.y) + value * static_cast<double>(h))
+                                 / static_cast<double>(size.y));
+                    };
+
+                    // the quad's coordinates go up, the image's rows go down
+                    gl::glUniform4f(region, f(x0 * 2 - 1), f(1 - y1 * 2), f(x1 * 2 - 1), f(1 - y0 * 2));
+                    gl::glUniform4f(
+                        crop,
+                        s((x0 - u0) / (u1 - u0)),
+                        t((y0 - v0) / (v1 - v0)),
+                        s((x1 - u0) / (u1 - u0)),
+                        t((y1 - v0) / (v1 - v0))
+                    );
+                    gl::glUniform1f(minify, std::max(f(base * scale), 1.0f));
+
+                    gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+                    gl::glDrawElements(gl::GL_TRIANGLES, indices.size(), gl::GL_UNSIGNED_INT, nullptr);
+                    break;
+                }
+            }
+        }
+
+        apply_uniform(Uniform::Region);
+        apply_uniform(Uniform::Crop);
+    }
+
+    bool QoiView::upload_rows(Slot& slot, raster::Rows rows)
+    {
+        const auto stride = slot.image->desc.width * 4uz;
+        const auto data   = slot.image->pixels().subspan(rows.start * stride, rows.count * stride);
+
+        if (slot.dirty) {
+            auto band = AsyncDecoder::Band{ .data = data, .start = rows.start, .count = rows.count };
+            return upload_changed(slot.texture, *slot.shown, band);
+        }
+
+        gl::glBindTexture(gl::GL_TEXTURE_2D, slot.texture);
+        gl::glTexSubImage2D(
+            gl::GL_TEXTURE_2D,
+            0,
+            0,
+            static_cast<gl::GLint>(rows.start),
+            slot.size.x,
+            static_cast<gl::GLsizei>(rows.count),
+            gl::GL_RGBA,
+            gl::GL_UNSIGNED_BYTE,
+            data.data()
+        );
         return true;
     }
 
-    void QoiView::update_filtering(Filter filter, bool mipmap)
+    bool QoiView::upload_pending(Slot& slot, raster::Rows visible, std::size_t budget)
     {
+        if (slot.pending.empty()) {
+            return false;
+        }
+
+        auto uploaded  = false;
+        auto allowance = budget / std::max(slot.image->desc.width * 4uz, 1uz);    // in rows
+        auto remaining = std::vector<raster::Rows>{};
+
+        for (auto [start, count] : slot.pending) {
+            auto end   = start + count;
+            auto first = std::clamp(visible.start, start, end);
+            auto last  = std::clamp(visible.start + visible.count, start, end);
+
+            if (first < last) {
+                uploaded |= upload_rows(slot, { first, last - first });
+            }
+
+            // the rows above the view, then the ones below it
+            for (auto part : { raster::Rows{ start, first - start }, raster::Rows{ last, end - last } }) {
+                auto now   = std::min(part.count, allowance);
+                allowance -= now;
+
+                if (now > 0) {
+                    uploaded |= upload_rows(slot, { part.start, now });
+                }
+                if (now < part.count) {
+                    remaining.push_back({ part.start + now, part.count - now });
+                }
+            }
+        }
+
+        slot.pending = std::move(remaining);
+
+        // a finished image is diffed against by the next one only once all of it is in the texture
+        if (slot.pending.empty() and not slot.partial) {
+            slot.shown = slot.image;
+            slot.kept.reset();
+        }
+
+        return uploaded;
+    }
+
+    bool QoiView::upload_changed(gl::GLuint texture, const Image& before, const AsyncDecoder::Band& band)
+    {
+        const auto width  = static_cast<gl::GLsizei>(before.desc.width);
+        const auto stride = before.desc.width * 4uz;
+        const auto rows   = before.pixels().subspan(band.start * stride, band.count * stride);
+
+        auto runs    = raster::changed_rows(rows, band.data, stride, upload_gap);
+        auto changed = 0uz;
+
+        gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+        for (auto [start, count] : runs) {
+            gl::glTexSubImage2D(
+                gl::GL_TEXTURE_2D,
+                0,
+                0,
+                static_cast<gl::GLint>(band.start + start),
+                width,
+                static_cast<gl::GLsizei>(count),
+                gl::GL_RGBA,
+                gl::GL_UNSIGNED_BYTE,
+                band.data.data() + start * stride
+            );
+            changed += count;
+        }
+
+        if (band.count > 0) {
+            spdlog::debug("Uploaded {}/{} changed rows from row {}", changed, band.count, band.start);
+        }
+
+        return changed > 0;
+    }
+
+    void QoiView::update_filtering(Filter filter, Minify minify)
+    {
+        // textures uploaded under another mode have no mipmaps or stale ones, they are rebuilt once here
+        auto rebuild = minify == Minify::Mipmap and m_minify != Minify::Mipmap;
+
         m_filter = filter;
-        m_mipmap = mipmap;
+        m_minify = minify;
+
+        for (const auto& slot : m_slots) {
+            if (slot.texture != 0) {
+                gl::glBindTexture(gl::GL_TEXTURE_2D, slot.texture);
+                apply_filtering();
+                if (rebuild) {
+                    gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+                }
+            }
+        }
+
+        if (m_textures) {
+            for (const auto& entry : m_textures->entries()) {
+                gl::glBindTexture(gl::GL_TEXTURE_2D, entry.texture);
+                apply_filtering(entry.exact and m_minify == Minify::Mipmap);
+                if (rebuild and entry.exact) {
+                    gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+                }
+            }
+        }
+
+        // tiles are never mipmapped, the levels of their pyramid stand in for the mipmaps
+        if (m_tiles) {
+            for (auto [index, texture] : m_tiles->textures) {
+                gl::glBindTexture(gl::GL_TEXTURE_2D, texture);
+                apply_filtering(false);
+            }
+        }
+
+        if (m_playback) {
+            for (auto i = 0uz; i < Playback::ring_size; ++i) {
+                gl::glBindTexture(gl::GL_TEXTURE_2D, m_playback->textures[i]);
+                apply_filtering();
+                if (m_minify == Minify::Mipmap and m_playback->images[i]) {
+                    gl::glGenerateMipmap(gl::GL_TEXTURE_2D);
+                }
+            }
+        }
+    }
+
+    const fs::path& QoiView::slot_file(std::size_t slot) const
+    {
+        return m_compare ? m_files[slot] : m_files[m_index];
+    }
+
+    std::shared_ptr<const Image> QoiView::slot_image(std::size_t slot) const
+    {
+        if (m_playback and slot == 0) {
+            return m_playback->images[m_playback->shown];
+        }
+        return m_slots[slot].image;
+    }
+
+    gl::GLuint QoiView::slot_texture(std::size_t slot) const
+    {
+        if (m_playback and slot == 0) {
+            return m_playback->step ? m_playback->textures[m_playback->shown] : 0;
+        } else if (m_tiles and slot == 0) {
+            return 0;
+        }
+
+        const auto& current = m_slots[slot];
+        if (current.resident != 0) {
+            return current.resident;
+        }
 
+        // until the image is decoded again, its compressed copy stands in for it
+        if (not current.decoded and current.key) {
+            if (auto entry = m_textures->find(*current.key)) {
+                return entry->texture;
+            }
+        }
+        return current.texture;
+    }
+
+    // applies to the bound texture
+    void QoiView::apply_filtering(bool mipmap)
+    {
         if (m_filter == Filter::Linear) {
-            auto min = m_mipmap ? gl::GL_LINEAR_MIPMAP_LINEAR : gl::GL_LINEAR;
+            auto min = mipmap ? gl::GL_LINEAR_MIPMAP_LINEAR : gl::GL_LINEAR;
             gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, min);
             gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_LINEAR);
         } else {
-            auto min = m_mipmap ? gl::GL_NEAREST_MIPMAP_NEAREST : gl::GL_NEAREST;
+            auto min = mipmap ? gl::GL_NEAREST_MIPMAP_NEAREST : gl::GL_NEAREST;
             gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MIN_FILTER, min);
             gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GL_NEAREST);
         }
     }
 
-    void QoiView::apply_uniform(Uniform uniform)
+    void QoiView::export_view(bool native)
+    {
+        auto        index = slot_at(m_mouse);
+        const auto& slot  = m_slots[index];
+
+        if (m_tiles and index == 0) {
+            spdlog::warn("Export ignored: not available for a tiled image");
+            return;
+        } else if (not slot.decoded) {
+            spdlog::warn("Export ignored: image is not decoded yet");
+            return;
+        } else if (m_exporter.busy()) {
+            spdlog::warn("Export ignored: previous export is still running");
+            return;
+        }
+
+        auto [cols, rows] = grid();
+        auto screen       = Vec2<int>{};
+        glfwGetFramebufferSize(m_window, &screen.x, &screen.y);
+        screen = { screen.x / cols, screen.y / rows };
+
+        auto view = raster::view_mapping(screen, slot.size, slot.aspect, m_zoom, m_offset);
+        auto job  = Exporter::viewport(
+            slot_image(index), slot_file(index), screen, view, native, m_filter == Filter::Linear
+        );
+
+        if (not job) {
+            spdlog::warn("Export ignored: image is out of view");
+            return;
+        }
+
+        m_exporter.submit(std::move(job).value());
+    }
+
+    void QoiView::apply_uniform(Uniform uniform, const Slot& slot)
     {
         auto loc = [this](const char* name) { return gl::glGetUniformLocation(m_program, name); };
         switch (uniform) {
         case Uniform::Zoom: gl::glUniform1f(loc("zoom"), m_zoom); break;
         case Uniform::Offset: gl::glUniform2f(loc("offset"), m_offset.x, m_offset.y); break;
-        case Uniform::Aspect: gl::glUniform2f(loc("aspect"), m_aspect.x, m_aspect.y); break;
+        case Uniform::Aspect: gl::glUniform2f(loc("aspect"), slot.aspect.x, slot.aspect.y); break;
         case Uniform::Tex: gl::glUniform1i(loc("tex"), 0); break;
+        case Uniform::TexB: gl::glUniform1i(loc("tex_b"), 1); break;
+        case Uniform::Mode: gl::glUniform1i(loc("mode"), static_cast<gl::GLint>(m_diff)); break;
+        case Uniform::Threshold: gl::glUniform1f(loc("threshold"), static_cast<float>(m_threshold)); break;
+        case Uniform::Minify: gl::glUniform1f(loc("minify"), minification(slot)); break;
+        case Uniform::Region: gl::glUniform4f(loc("region"), -1.0f, -1.0f, 1.0f, 1.0f); break;
+        case Uniform::Crop: gl::glUniform4f(loc("crop"), 0.0f, 0.0f, 1.0f, 1.0f); break;
+        }
+    }
+
+    // 1x1, 2x1 side by side, or 2x2
+    Vec2<int> QoiView::grid() const
+    {
+        if (m_diff != Diff::Off) {
+            return { 1, 1 };
+        }
+
+        switch (m_slots.size()) {
+        case 1: return { 1, 1 };
+        case 2: return { 2, 1 };
+        default: return { 2, 2 };
+        }
+    }
+
+    Vec2<int> QoiView::cell_size() const
+    {
+        auto [cols, rows] = grid();
+        auto size         = Vec2<int>{};
+        glfwGetWindowSize(m_window, &size.x, &size.y);
+
+        return { size.x / cols, size.y / rows };
+    }
+
+    float QoiView::minification(const Slot& slot) const
+    {
+        // nearest filtering is asked for to see the texels as they are, a diff must not blend them away either
+        if (m_minify != Minify::Shader or m_filter != Filter::Linear or m_diff != Diff::Off or slot.size.x <= 0) {
+            return 1.0f;
+        }
+
+        auto [cols, rows] = grid();
+        int width, height;
+        glfwGetFramebufferSize(m_window, &width, &height);
+
+        auto scale = scale_local_to_screen(m_zoom, slot.aspect.x, slot.size.x, width / cols);
+        return scale > 0.0f ? std::max(1.0f / scale, 1.0f) : 1.0f;
+    }
+
+    std::size_t QoiView::tile_level(const Slot& slot) const
+    {
+        const auto& tiles  = *m_tiles;
+        const auto  levels = tiles.image->levels().size();
+
+        auto [cols, rows] = grid();
+        int width, height;
+        glfwGetFramebufferSize(m_window, &width, &height);
+
+        auto scale = scale_local_to_screen(m_zoom, slot.aspect.x, slot.size.x, width / cols);
+        auto level = 0uz;
+        if (scale > 0.0f and scale < 1.0f) {
+            level = std::min(static_cast<std::size_t>(std::log2(1.0f / scale)), levels - 1);
+        }
+
+        // the coarser tiles drawn under the ones still loading take up to a third more
+        while (level + 1 < levels and visible_tiles(slot, level).count() * 4 / 3 + levels > tiles.capacity) {
+            ++level;
+        }
+        return level;
+    }
+
+    QoiView::TileSpan QoiView::visible_tiles(const Slot& slot, std::size_t level) const
+    {
+        const auto& image   = *m_tiles->image;
+        const auto& current = image.levels()[level];
+        const auto  tile    = static_cast<double>(image.tile_size());
+
+        auto cell = cell_size();
+        if (slot.size.x <= 0 or slot.size.y <= 0 or cell.x <= 0 or cell.y <= 0) {
+            return { level, { 0, 0 }, { 0, 0 } };
         }
+
+        // corners of the cell in pixels of the level
+        auto view = raster::view_mapping(cell, slot.size, slot.aspect, m_zoom, m_offset);
+        auto fx   = static_cast<double>(current.size.x) / slot.size.x;
+        auto fy   = static_cast<double>(current.size.y) / slot.size.y;
+        auto x0   = view.origin.x * fx;
+        auto y0   = view.origin.y * fy;
+        auto x1   = (view.origin.x + cell.x * view.scale.x) * fx;
+        auto y1   = (view.origin.y + cell.y * view.scale.y) * fy;
+
+        auto clamp = [](double value, std::size_t count) {
+            return static_cast<std::size_t>(std::clamp(value, 0.0, static_cast<double>(count)));
+        };
+
+        return {
+            .level = level,
+            .from  = { clamp(std::floor(x0 / tile), current.tiles.x), clamp(std::floor(y0 / tile), current.tiles.y) },
+            .to    = { clamp(std::ceil(x1 / tile), current.tiles.x), clamp(std::ceil(y1 / tile), current.tiles.y) },
+        };
+    }
+
+    Vec2<double> QoiView::image_at(std::size_t index, Vec2<> cursor) const
+    {
+        const auto& slot = m_slots[index];
+
+        auto [cols, rows] = grid();
+        auto cell         = cell_size();
+        auto view         = raster::view_mapping(cell, slot.size, slot.aspect, m_zoom, m_offset);
+
+        auto x = static_cast<double>(cursor.x) - static_cast<double>(static_cast<int>(index) % cols * cell.x);
+        auto y = static_cast<double>(cursor.y) - static_cast<double>(static_cast<int>(index) / cols * cell.y);
+
+        return { x * view.scale.x + view.origin.x, y * view.scale.y + view.origin.y };
+    }
+
+    raster::Rect QoiView::selection_rect(Vec2<double> from) const
+    {
+        auto to = image_at(m_selection_slot, m_mouse);
+
+        auto x0 = static_cast<int>(std::floor(std::min(from.x, to.x)));
+        auto y0 = static_cast<int>(std::floor(std::min(from.y, to.y)));
+        auto x1 = static_cast<int>(std::floor(std::max(from.x, to.x))) + 1;
+        auto y1 = static_cast<int>(std::floor(std::max(from.y, to.y))) + 1;
+
+        return { x0, y0, x1 - x0, y1 - y0 };
+    }
+
+    raster::Rows QoiView::visible_rows(std::size_t index) const
+    {
+        const auto& slot = m_slots[index];
+
+        auto cell = cell_size();
+        if (cell.x <= 0 or cell.y <= 0) {
+            return { 0, 0 };
+        }
+
+        // image rows at the top and bottom edges of the cell, the scale is the same at every row
+        auto view   = raster::view_mapping(cell, slot.size, slot.aspect, m_zoom, m_offset);
+        auto height = static_cast<double>(slot.size.y);
+        auto top    = std::clamp(std::floor(view.origin.y), 0.0, height);
+        auto bottom = std::clamp(std::ceil(view.origin.y + view.scale.y * cell.y), 0.0, height);
+
+        return { static_cast<std::size_t>(top), static_cast<std::size_t>(std::max(bottom - top, 0.0)) };
+    }
+
+    std::size_t QoiView::slot_at(Vec2<> cursor) const
+    {
+        auto [cols, rows]     = grid();
+        auto [cell_w, cell_h] = cell_size();
+
+        auto col = std::clamp(static_cast<int>(cursor.x) / std::max(cell_w, 1), 0, cols - 1);
+        auto row = std::clamp(static_cast<int>(cursor.y) / std::max(cell_h, 1), 0, rows - 1);
+
+        return std::min(static_cast<std::size_t>(row * cols + col), m_slots.size() - 1);
     }
 }
@@ -0,0 +1,274 @@
+#include "qoiview/raster.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    using qoiview::Color;
+    using qoiview::raster::Mapping;
+    using qoiview::raster::Rect;
+    using qoiview::raster::Source;
+    using qoiview::raster::Target;
+
+    // weights are 8-bit fixed point
+    constexpr auto one = 256u;
+
+    // horizontal sampling positions, shared by every row of a draw
+    struct Columns
+    {
+        std::vector<std::int32_t>  x0;    // -1 if outside of the source
+        std::vector<std::int32_t>  x1;
+        std::vector<std::uint32_t> fx;
+    };
+
+    Columns make_columns(const Source& src, Rect damage, const Mapping& mapping, bool bilinear)
+    {
+        auto columns = Columns{
+            .x0 = std::vector<std::int32_t>(static_cast<std::size_t>(damage.width)),
+            .x1 = std::vector<std::int32_t>(static_cast<std::size_t>(damage.width)),
+            .fx = std::vector<std::uint32_t>(static_cast<std::size_t>(damage.width)),
+        };
+
+        for (auto i = 0uz; i < columns.x0.size(); ++i) {
+            auto u = (static_cast<double>(damage.x) + static_cast<double>(i) + 0.5) * mapping.scale.x
+                   + mapping.origin.x;
+
+            if (u < 0.0 or u >= src.width) {
+                columns.x0[i] = -1;
+                continue;
+            }
+
+            if (not bilinear) {
+                columns.x0[i] = static_cast<std::int32_t>(u);
+                continue;
+            }
+
+            // texel centers are at +0.5, edges are clamped like GL_CLAMP_TO_EDGE
+            auto c  = std::max(u - 0.5, 0.0);
+            auto x0 = static_cast<std::int32_t>(c);
+
+            columns.x0[i] = x0;
+            columns.x1[i] = std::min(x0 + 1, src.width - 1);
+            columns.fx[i] = static_cast<std::uint32_t>((c - x0) * one);
+        }
+
+        return columns;
+    }
+
+    std::uint32_t lerp(std::uint32_t a, std::uint32_t b, std::uint32_t f)
+    {
+        return (a * (one - f) + b * f) >> 8;
+    }
+
+    // gather pass: fills `row` with RGBA of the sampled source pixels, alpha 0 outside of the source
+    void sample_nearest(const Source& src, const Columns& columns, int v, std::span<std::uint32_t> row)
+    {
+        const auto* line = src.pixels.data() + static_cast<std::size_t>(v) * static_cast<std::size_t>(src.width) * 4;
+
+        for (auto i = 0uz; i < row.size(); ++i) {
+            auto x = columns.x0[i];
+            if (x < 0) {
+                row[i] = 0;
+                continue;
+            }
+
+            const auto* p = line + static_cast<std::size_t>(x) * 4;
+            row[i] = static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8
+                   | static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+        }
+    }
+
+    void sample_bilinear(const Source& src, const Columns& columns, double v, std::span<std::uint32_t> row)
+    {
+        auto c  = std::max(v - 0.5, 0.0);
+        auto y0 = static_cast<int>(c);
+        auto y1 = std::min(y0 + 1, src.height - 1);
+        auto fy = static_cast<std::uint32_t>((c - y0) * one);
+
+        const auto stride = static_cast<std::size_t>(src.width) * 4;
+        const auto* top   = src.pixels.data() + static_cast<std::size_t>(y0) * stride;
+        const auto* bot   = src.pixels.data() + static_cast<std::size_t>(y1) * stride;
+
+        for (auto i = 0uz; i < row.size(); ++i) {
+            if (columns.x0[i] < 0) {
+                row[i] = 0;
+                continue;
+            }
+
+            const auto x0 = static_cast<std::size_t>(columns.x0[i]) * 4;
+            const auto x1 = static_cast<std::size_t>(columns.x1[i]) * 4;
+            const auto fx = columns.fx[i];
+
+            auto pixel = 0u;
+            for (auto ch = 0uz; ch < 4; ++ch) {
+                auto t  = lerp(top[x0 + ch], top[x1 + ch], fx);
+                auto b  = lerp(bot[x0 + ch], bot[x1 + ch], fx);
+                pixel  |= lerp(t, b, fy) << (ch * 8);
+            }
+            row[i] = pixel;
+        }
+    }
+
+    // blend pass: contiguous and branch-free so the compiler vectorizes it
+    void blend(std::span<const std::uint32_t> row, std::span<std::uint32_t> out, Color bg)
+    {
+        const auto red   = static_cast<std::uint32_t>(bg.r);
+        const auto green = static_cast<std::uint32_t>(bg.g);
+        const auto blue  = static_cast<std::uint32_t>(bg.b);
+
+        for (auto i = 0uz; i < row.size(); ++i) {
+            auto p  = row[i];
+            auto a  = p >> 24;
+            auto ia = 255 - a;
+
+            // x / 255 == (x + 1 + (x >> 8)) >> 8 for x in [0, 255 * 255]
+            auto mix = [&](std::uint32_t s, std::uint32_t d) {
+                auto x = s * a + d * ia;
+                return (x + 1 + (x >> 8)) >> 8;
+            };
+
+            auto r = mix(p & 0xff, red);
+            auto g = mix((p >> 8) & 0xff, green);
+            auto b = mix((p >> 16) & 0xff, blue);
+
+            out[i] = r << 16 | g << 8 | b;
+        }
+    }
+}
+
+namespace qoiview::raster
+{
+    Mapping view_mapping(Vec2<int> screen, Vec2<int> image, Vec2<> aspect, float zoom, Vec2<> offset)
+    {
+        auto w = static_cast<double>(screen.x);
+        auto h = static_cast<double>(screen.y);
+
+        auto sx = static_cast<double>(aspect.x) * zoom;
+        auto sy = static_cast<double>(aspect.y) * zoom;
+
+        auto iw = static_cast<double>(image.x);
+        auto ih = static_cast<double>(image.y);
+
+        // u = ((x / w * 2 - 1) / sx + offset.x + 1) / 2 * iw
+        // v = (1 - ((1 - y / h * 2) / sy + offset.y)) / 2 * ih
+        return {
+            .scale  = { .x = iw / (w * sx), .y = ih / (h * sy) },
+            .origin = {
+                .x = (-1.0 / sx + offset.x + 1.0) / 2.0 * iw,
+                .y = (1.0 - 1.0 / sy - offset.y) / 2.0 * ih,
+            },
+        };
+    }
+
+    void draw(
+        ThreadPool&    pool,
+        const Source&  src,
+        const Target&  dst,
+        Rect           damage,
+        const Mapping& mapping,
+        Color          background,
+        bool           bilinear
+    )
+    {
+        damage.width  = std::min(damage.x + damage.width, dst.width) - std::max(damage.x, 0);
+        damage.height = std::min(damage.y + damage.height, dst.height) - std::max(damage.y, 0);
+        damage.x      = std::max(damage.x, 0);
+        damage.y      = std::max(damage.y, 0);
+
+        if (damage.empty()) {
+            return;
+        }
+
+        const auto columns = make_columns(src, damage, mapping, bilinear);
+        const auto width   = static_cast<std::size_t>(damage.width);
+        const auto valid   = src.width > 0 and src.height > 0 and not src.pixels.empty();
+
+        pool.parallel_for(static_cast<std::size_t>(damage.height), [&](std::size_t begin, std::size_t end) {
+            auto row = std::vector<std::uint32_t>(width);
+
+            for (auto i = begin; i < end; ++i) {
+                auto y   = damage.y + static_cast<int>(i);
+                auto v   = (y + 0.5) * mapping.scale.y + mapping.origin.y;
+                auto out = dst.pixels.subspan(static_cast<std::size_t>(y * dst.stride + damage.x), width);
+
+                if (not valid or v < 0.0 or v >= src.height) {
+                    sr::fill(row, 0u);
+                } else if (bilinear) {
+                    sample_bilinear(src, columns, v, row);
+                } else {
+                    sample_nearest(src, columns, static_cast<int>(v), row);
+                }
+
+                blend(row, out, background);
+            }
+        });
+    }
+
+    qoipp::ByteVec resample(
+        ThreadPool&    pool,
+        const Source&  src,
+        int            width,
+        int            height,
+        const Mapping& mapping,
+        bool           bilinear
+    )
+    {
+        const auto columns = make_columns(src, { 0, 0, width, height }, mapping, bilinear);
+        const auto stride  = static_cast<std::size_t>(width) * 4;
+
+        auto out = qoipp::ByteVec(stride * static_cast<std::size_t>(height));
+
+        pool.parallel_for(static_cast<std::size_t>(height), [&](std::size_t begin, std::size_t end) {
+            auto row = std::vector<std::uint32_t>(static_cast<std::size_t>(width));
+
+            for (auto i = begin; i < end; ++i) {
+                auto v = (static_cast<double>(i) + 0.5) * mapping.scale.y + mapping.origin.y;
+
+                if (v < 0.0 or v >= src.height) {
+                    sr::fill(row, 0u);
+                } else if (bilinear) {
+                    sample_bilinear(src, columns, v, row);
+                } else {
+                    sample_nearest(src, columns, static_cast<int>(v), row);
+                }
+
+                auto line = std::span{ out }.subspan(i * stride, stride);
+                for (auto x = 0uz; x < row.size(); ++x) {
+                    line[x * 4 + 0] = static_cast<qoipp::Byte>(row[x]);
+                    line[x * 4 + 1] = static_cast<qoipp::Byte>(row[x] >> 8);
+                    line[x * 4 + 2] = static_cast<qoipp::Byte>(row[x] >> 16);
+                    line[x * 4 + 3] = static_cast<qoipp::Byte>(row[x] >> 24);
+                }
+            }
+        });
+
+        return out;
+    }
+
+    std::vector<Rows> changed_rows(qoipp::ByteCSpan before, qoipp::ByteCSpan after, std::size_t stride, std::size_t gap)
+    {
+        assert(before.size() == after.size() and stride > 0);
+
+        auto runs  = std::vector<Rows>{};
+        auto count = after.size() / stride;
+
+        // memcmp stops at the first difference and is vectorized, so unchanged rows cost about a memory read
+        for (auto row = 0uz; row < count; ++row) {
+            if (std::memcmp(before.data() + row * stride, after.data() + row * stride, stride) == 0) {
+                continue;
+            }
+
+            if (not runs.empty() and row - (runs.back().start + runs.back().count) <= gap) {
+                runs.back().count = row - runs.back().start + 1;
+            } else {
+                runs.push_back({ row, 1 });
+            }
+        }
+
+        return runs;
+    }
+}
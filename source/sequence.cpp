@@ -0,0 +1,267 @@
+#include "qoiview/sequence.hpp"
+#include "qoiview/archive.hpp"
+#include "qoiview/pipeline.hpp"
+
+#include <qoipp/simple.hpp>
+#include <spdlog/spdlog.h>
+
+#include <cassert>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+
+namespace
+{
+    namespace fs = qoiview::fs;
+
+    constexpr auto mib = 1024.0 * 1024.0;
+
+    // required decode rate over the target frame rate, leaves room for uneven frames and the render thread
+    constexpr auto decode_margin = 1.25;
+
+    std::optional<qoipp::ByteVec> read(const fs::path& file)
+    {
+        auto stream = qoiview::archive::open(file);
+        if (not stream) {
+            return std::nullopt;
+        }
+
+        auto bytes = qoipp::ByteVec(stream->size);
+        stream->handle.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+        return stream->handle ? std::optional{ std::move(bytes) } : std::nullopt;
+    }
+
+    // `qoipp::read_header` for a zstd-compressed frame in memory
+    qoipp::Result<qoipp::Desc> read_zstd_header(qoipp::ByteCSpan bytes)
+    {
+        namespace pipeline = qoiview::pipeline;
+
+        auto reader = pipeline::zstd_stream(pipeline::read_memory(bytes));
+        auto header = qoipp::ByteArr<qoipp::constants::header_size>{};
+        auto count  = pipeline::read_exact(reader, header);
+        if (not count) {
+            return qoipp::make_error<qoipp::Desc>(count.error());
+        }
+
+        return qoipp::read_header(std::span{ header }.first(*count));
+    }
+
+    // decoded as it is decompressed, the QOI data in between is never whole in memory
+    qoipp::Result<qoipp::Image> decode_zstd(qoipp::ByteCSpan bytes)
+    {
+        namespace pipeline = qoiview::pipeline;
+
+        auto reader = pipeline::zstd_stream(pipeline::read_memory(bytes));
+        auto header = qoipp::ByteArr<qoipp::constants::header_size>{};
+        if (auto read = pipeline::read_exact(reader, header); not read or *read < header.size()) {
+            return qoipp::make_error<qoipp::Image>(read ? qoipp::Error::TooShort : read.error());
+        }
+
+        auto decoder = qoipp::StreamDecoder{};
+        auto desc    = decoder.initialize(header, qoipp::Channels::RGBA);
+        if (not desc) {
+            return qoipp::make_error<qoipp::Image>(desc.error());
+        }
+
+        auto stride = std::size_t{ desc->width } * 4;
+        auto image  = qoipp::Image{ .data = qoipp::ByteVec(stride * desc->height), .desc = *desc };
+
+        // like qoipp::decode, a truncated frame keeps the rows it has and zeroes after them
+        for (auto&& rows : pipeline::decode_rows(decoder, std::move(reader), image.data, stride, {})) {
+            if (not rows) {
+                return qoipp::make_error<qoipp::Image>(rows.error());
+            }
+        }
+
+        return image;
+    }
+
+    double to_mib(std::size_t bytes)
+    {
+        return static_cast<double>(bytes) / mib;
+    }
+}
+
+namespace qoiview
+{
+    Sequence::Plan Sequence::plan(
+        const std::vector<fs::path>& frames,
+        std::size_t                  budget,
+        double                       fps,
+        std::size_t                  ahead,
+        std::size_t                  held
+    )
+    {
+        auto decoded    = 0uz;
+        auto compressed = 0uz;
+        auto largest    = std::optional<std::size_t>{};    // index of the frame with the most pixels
+
+        auto frame_bytes = [](const qoipp::Desc& desc) { return std::size_t{ desc.width } * desc.height * 4; };
+        auto descs       = std::vector<std::optional<qoipp::Desc>>{};
+
+        for (auto i = 0uz; i < frames.size(); ++i) {
+            auto desc   = archive::read_header(frames[i]);
+            auto status = archive::status(frames[i]);
+
+            if (not desc or not status) {
+                descs.emplace_back();
+                continue;    // stays empty when preloaded, costs nothing
+            }
+
+            decoded    += frame_bytes(*desc);
+            compressed += status->size;
+            descs.push_back(*desc);
+
+            if (not largest or frame_bytes(*desc) > frame_bytes(*descs[*largest])) {
+                largest = i;
+            }
+        }
+
+        if (not largest) {
+            throw std::runtime_error{ "No valid frame to preload" };
+        }
+
+        spdlog::info(
+            "Sequence of {} frames: {:.1f} MiB decoded, {:.1f} MiB compressed, budget {:.1f} MiB",
+            frames.size(),
+            to_mib(decoded),
+            to_mib(compressed),
+            to_mib(budget)
+        );
+
+        if (decoded <= budget) {
+            return { Storage::Decoded, decoded };
+        }
+
+        // the frames being decoded ahead and those the viewer still holds come on top of the compressed files
+        auto needed = compressed + (ahead + held) * frame_bytes(*descs[*largest]);
+        if (needed > budget) {
+            throw std::runtime_error{ fmt::format(
+                "Sequence doesn't fit the preload budget of {:.1f} MiB: needs {:.1f} MiB decoded or {:.1f} MiB "
+                "compressed",
+                to_mib(budget),
+                to_mib(decoded),
+                to_mib(needed)
+            ) };
+        }
+
+        auto bytes = read(frames[*largest]);
+        if (not bytes) {
+            throw std::runtime_error{ fmt::format("Failed to read {:?}", frames[*largest].c_str()) };
+        }
+
+        auto start   = std::chrono::steady_clock::now();
+        auto image   = decode(*bytes, frames[*largest]);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // the worst case: every frame as slow as the largest one, decoded `ahead` at a time
+        auto achievable = static_cast<double>(ahead) / std::max(elapsed, 1e-6);
+        spdlog::info("Decoding the largest frame took {:.1f} ms, up to {:.1f} fps", elapsed * 1000.0, achievable);
+
+        if (not image or achievable < fps * decode_margin) {
+            throw std::runtime_error{ fmt::format(
+                "Decoding from memory reaches {:.1f} fps, too slow for {:.1f} fps; keeping the frames decoded needs "
+                "a preload budget of {:.1f} MiB",
+                achievable,
+                fps,
+                to_mib(decoded)
+            ) };
+        }
+
+        return { Storage::Compressed, needed };
+    }
+
+    std::shared_ptr<const Image> Sequence::decode(qoipp::ByteCSpan bytes, const fs::path& file)
+    {
+        auto compressed = pipeline::sniff_zstd(bytes);
+        auto image      = compressed ? decode_zstd(bytes) : qoipp::decode(bytes, qoipp::Channels::RGBA);
+        if (not image) {
+            spdlog::warn("Failed to decode frame {:?}: {}", file.c_str(), to_string(image.error()));
+            return nullptr;
+        }
+
+        auto result  = std::make_shared<Image>();
+        result->desc = image->desc;
+        result->data = std::move(image->data);
+
+        return result;
+    }
+
+    std::shared_ptr<const Image> Sequence::decode(const fs::path& file)
+    {
+        auto stream = archive::open(file);
+        auto bytes  = qoipp::ByteVec(stream ? stream->size : 0);
+
+        if (stream) {
+            stream->handle.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        if (not stream or not stream->handle) {
+            spdlog::warn("Failed to read frame {:?}", file.c_str());
+            return nullptr;
+        }
+
+        return decode(bytes, file);
+    }
+
+    Sequence::Sequence(ThreadPool& pool, std::vector<fs::path> frames, Storage storage)
+        : m_frames{ std::move(frames) }
+        , m_storage{ storage }
+    {
+        if (m_storage == Storage::Decoded) {
+            m_decoded.resize(m_frames.size());
+        } else {
+            m_compressed.resize(m_frames.size());
+        }
+
+        // every job writes its own element, `done` publishes them all
+        m_loads.reserve(m_frames.size());
+        for (auto i = 0uz; i < m_frames.size(); ++i) {
+            m_loads.push_back(pool.submit([this, i] { load(i); }));
+        }
+    }
+
+    Sequence::~Sequence()
+    {
+        m_cancelled.store(true, std::memory_order::relaxed);
+        for (auto& load : m_loads) {
+            load.wait();
+        }
+    }
+
+    std::shared_ptr<const Image> Sequence::frame(std::size_t index) const
+    {
+        assert(done());
+
+        if (m_storage == Storage::Decoded) {
+            return m_decoded[index];
+        } else if (m_compressed[index].empty()) {
+            return nullptr;
+        }
+
+        return decode(m_compressed[index], m_frames[index]);
+    }
+
+    void Sequence::load(std::size_t index)
+    {
+        if (m_cancelled.load(std::memory_order::relaxed)) {
+            return;
+        }
+
+        const auto& file  = m_frames[index];
+        auto        bytes = read(file);
+
+        if (not bytes) {
+            spdlog::warn("Failed to read frame {:?}", file.c_str());
+        } else if (m_storage == Storage::Decoded) {
+            m_decoded[index] = decode(*bytes, file);
+        } else if (pipeline::sniff_zstd(*bytes) ? read_zstd_header(*bytes) : qoipp::read_header(*bytes)) {
+            m_compressed[index] = std::move(*bytes);
+        } else {
+            spdlog::warn("Frame {:?} is not a valid QOI file", file.c_str());
+        }
+
+        m_loaded.fetch_add(1, std::memory_order::release);
+    }
+}
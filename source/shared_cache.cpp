@@ -0,0 +1,446 @@
+#include "qoiview/shared_cache.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(__unix__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+    using Ord = std::memory_order;
+
+    constexpr auto index_magic  = std::uint64_t{ 0x31'78'65'64'6e'69'76'71 };    // "qvindex1"
+    constexpr auto object_magic = std::uint64_t{ 0x31'6a'62'6f'6d'68'73'71 };    // "qshmobj1"
+
+    // slot states besides a published hash
+    constexpr auto slot_empty    = std::uint64_t{ 0 };
+    constexpr auto slot_reserved = std::uint64_t{ 1 };
+
+    // a slot left reserved this long belongs to a process that died while publishing
+    constexpr auto reserve_timeout = std::chrono::seconds{ 10 };
+
+    std::int64_t now()
+    {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    std::int64_t to_ticks(std::chrono::seconds seconds)
+    {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(seconds).count();
+    }
+
+    // FNV-1a, never returns one of the reserved slot states
+    std::uint64_t hash_of(const qoiview::DecodedCache::Key& key)
+    {
+        auto hash = std::uint64_t{ 0xcbf29ce484222325 };
+        auto mix  = [&](const void* data, std::size_t size) {
+            for (auto byte : std::span{ static_cast<const unsigned char*>(data), size }) {
+                hash = (hash ^ byte) * 0x100000001b3;
+            }
+        };
+
+        const auto& path = key.path.native();
+        auto        time = key.time.time_since_epoch().count();
+
+        mix(path.data(), path.size());
+        mix(&key.size, sizeof(key.size));
+        mix(&time, sizeof(time));
+
+        return hash <= slot_reserved ? hash + 2 : hash;
+    }
+
+    // read and written in place in the mapping, the magic is stored last to publish the rest
+    struct ObjectHeader
+    {
+        std::atomic<std::uint64_t> magic;
+        std::uint64_t file_size;
+        std::int64_t  file_time;
+        std::uint64_t data_size;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint8_t  channels;
+        std::uint8_t  colorspace;
+        std::uint32_t path_size;
+    };
+
+    std::size_t data_offset(std::size_t path_size)
+    {
+        return (sizeof(ObjectHeader) + path_size + 63) / 64 * 64;
+    }
+}
+
+namespace qoiview
+{
+    struct SharedCache::Slot
+    {
+        std::atomic<std::uint64_t> hash;
+        std::atomic<std::uint64_t> size;
+        std::atomic<std::int64_t>  last_used;
+    };
+
+    struct SharedCache::Index
+    {
+        std::atomic<std::uint64_t> magic;
+        std::uint64_t              slot_count;
+        Slot                       slots[1];
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "index must be usable across processes");
+}
+
+#if defined(__unix__)
+
+namespace qoiview
+{
+    using stat_t = struct stat;
+
+    SharedCache::SharedCache(std::size_t budget)
+        : m_budget{ budget }
+        , m_prefix{ fmt::format("/qoiview-{}-", ::getuid()) }
+    {
+        const auto slot_count = std::clamp(budget / (1024 * 1024), 64uz, 4096uz);
+        const auto size       = sizeof(Index) + (slot_count - 1) * sizeof(Slot);
+        const auto name       = m_prefix + "index";
+
+        // a creator that died before initializing the index leaves it unusable for everyone, start over once
+        if (not attach(name, size, slot_count)) {
+            spdlog::warn("Shared cache index was left uninitialized, recreating it");
+            ::shm_unlink(name.c_str());
+            if (not attach(name, size, slot_count)) {
+                throw std::runtime_error{ "Shared cache index is not initialized" };
+            }
+        }
+
+        auto max_slots = (m_size - sizeof(Index)) / sizeof(Slot) + 1;
+        if (m_index->magic.load(Ord::acquire) != index_magic or m_index->slot_count > max_slots) {
+            ::munmap(m_index, m_size);
+            throw std::runtime_error{ "Shared cache index is corrupted or from an incompatible version" };
+        }
+
+        spdlog::info("Shared cache attached ({} slots, {} MiB)", m_index->slot_count, m_budget / 1024 / 1024);
+
+        collect_orphans();
+    }
+
+    SharedCache::~SharedCache()
+    {
+        ::munmap(m_index, m_size);
+    }
+
+    bool SharedCache::attach(const std::string& name, std::size_t size, std::size_t slot_count)
+    {
+        // whoever creates the segment initializes it, everyone else waits for the magic to appear
+        auto created = true;
+        auto fd      = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 and errno == EEXIST) {
+            created = false;
+            fd      = ::shm_open(name.c_str(), O_RDWR, 0600);
+        }
+        if (fd < 0) {
+            throw std::runtime_error{ fmt::format("Failed to open shared cache index: {}", std::strerror(errno)) };
+        }
+
+        if (created and ::ftruncate(fd, static_cast<off_t>(size)) < 0) {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error{ fmt::format("Failed to size shared cache index: {}", std::strerror(errno)) };
+        }
+
+        // the creator may not have sized the segment yet
+        auto stat = stat_t{};
+        for (auto i = 0; i < 100 and ::fstat(fd, &stat) == 0 and stat.st_size == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+        }
+        m_size = static_cast<std::size_t>(stat.st_size);
+
+        if (m_size < sizeof(Index)) {
+            ::close(fd);
+            return false;
+        }
+
+        auto* addr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error{ fmt::format("Failed to map shared cache index: {}", std::strerror(errno)) };
+        }
+
+        // a zero-filled segment is a valid empty index, only the slot count needs to be written
+        m_index = static_cast<Index*>(addr);
+        if (created) {
+            m_index->slot_count = slot_count;
+            m_index->magic.store(index_magic, Ord::release);
+        }
+
+        for (auto i = 0; i < 100 and m_index->magic.load(Ord::acquire) == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+        }
+
+        if (m_index->magic.load(Ord::acquire) == 0) {
+            ::munmap(m_index, m_size);
+            m_index = nullptr;
+            return false;
+        }
+
+        return true;
+    }
+
+    std::shared_ptr<const Image> SharedCache::find(const DecodedCache::Key& key)
+    {
+        auto hash  = hash_of(key);
+        auto slots = std::span{ m_index->slots, m_index->slot_count };
+
+        auto slot = sr::find_if(slots, [&](const Slot& slot) { return slot.hash.load(Ord::acquire) == hash; });
+        if (slot == slots.end()) {
+            return nullptr;
+        }
+
+        auto name = object_name(hash);
+        auto fd   = ::shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            // the object is gone (evicted, or its owner died): drop the dangling slot
+            auto expected = hash;
+            slot->hash.compare_exchange_strong(expected, slot_empty, Ord::acq_rel);
+            return nullptr;
+        }
+
+        auto stat = stat_t{};
+        auto size = ::fstat(fd, &stat) == 0 ? static_cast<std::size_t>(stat.st_size) : 0uz;
+        auto addr = size >= sizeof(ObjectHeader) ? ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+
+        auto mapping = std::shared_ptr<void>{ addr, [size](void* addr) { ::munmap(addr, size); } };
+        auto bytes   = static_cast<const qoipp::Byte*>(addr);
+
+        // the rest of an object is only complete once its magic is there
+        const auto& header = *reinterpret_cast<const ObjectHeader*>(bytes);
+        if (header.magic.load(Ord::acquire) != object_magic) {
+            return nullptr;
+        }
+
+        const auto& path   = key.path.native();
+        const auto  offset = data_offset(header.path_size);
+
+        // guard against hash collisions and objects of a previous slot owner
+        auto valid = header.file_size == key.size                                       //
+                 and header.file_time == key.time.time_since_epoch().count()            //
+                 and header.path_size == path.size()                                    //
+                 and offset + header.data_size <= size                                  //
+                 and std::memcmp(bytes + sizeof(header), path.data(), path.size()) == 0;
+
+        if (not valid) {
+            return nullptr;
+        }
+
+        slot->last_used.store(now(), Ord::relaxed);
+
+        auto image     = std::make_shared<Image>();
+        image->desc    = {
+               .width      = header.width,
+               .height     = header.height,
+               .channels   = static_cast<qoipp::Channels>(header.channels),
+               .colorspace = static_cast<qoipp::Colorspace>(header.colorspace),
+        };
+        image->shared  = { bytes + offset, header.data_size };
+        image->mapping = std::move(mapping);
+
+        return image;
+    }
+
+    void SharedCache::publish(const DecodedCache::Key& key, const Image& image)
+    {
+        auto hash   = hash_of(key);
+        auto slots  = std::span{ m_index->slots, m_index->slot_count };
+        auto pixels = image.pixels();
+
+        if (sr::any_of(slots, [&](const Slot& slot) { return slot.hash.load(Ord::acquire) == hash; })) {
+            return;
+        }
+
+        const auto& path   = key.path.native();
+        const auto  offset = data_offset(path.size());
+        const auto  size   = offset + pixels.size();
+
+        if (size > m_budget or not make_room(size)) {
+            return;
+        }
+
+        // reserve a slot before creating the object so a full index doesn't leave an orphan behind
+        auto slot = slots.end();
+        for (auto it = slots.begin(); it != slots.end() and slot == slots.end(); ++it) {
+            auto expected = slot_empty;
+            if (it->hash.compare_exchange_strong(expected, slot_reserved, Ord::acq_rel)) {
+                it->last_used.store(now(), Ord::relaxed);
+                slot = it;
+            }
+        }
+        if (slot == slots.end()) {
+            return;
+        }
+
+        auto release = [&] { slot->hash.store(slot_empty, Ord::release); };
+
+        // O_EXCL: if another process is publishing the same image, let it
+        auto name = object_name(hash);
+        auto fd   = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            return release();
+        }
+
+        auto addr = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+            addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+
+        if (addr == MAP_FAILED) {
+            ::shm_unlink(name.c_str());
+            return release();
+        }
+
+        // the mapping is zero-filled, so the magic stays unset until everything else is written
+        auto  bytes  = static_cast<qoipp::Byte*>(addr);
+        auto& header = *reinterpret_cast<ObjectHeader*>(bytes);
+
+        header.file_size  = key.size;
+        header.file_time  = key.time.time_since_epoch().count();
+        header.data_size  = pixels.size();
+        header.width      = image.desc.width;
+        header.height     = image.desc.height;
+        header.channels   = static_cast<std::uint8_t>(image.desc.channels);
+        header.colorspace = static_cast<std::uint8_t>(image.desc.colorspace);
+        header.path_size  = static_cast<std::uint32_t>(path.size());
+
+        std::memcpy(bytes + sizeof(header), path.data(), path.size());
+        std::memcpy(bytes + offset, pixels.data(), pixels.size());
+        header.magic.store(object_magic, Ord::release);
+        ::munmap(addr, size);
+
+        // the object is complete before the hash makes it visible to other processes
+        slot->size.store(size, Ord::relaxed);
+        slot->last_used.store(now(), Ord::relaxed);
+        slot->hash.store(hash, Ord::release);
+
+        spdlog::debug("Shared cache publish: {} ({} bytes)", key.path.c_str(), size);
+    }
+
+    std::string SharedCache::object_name(std::uint64_t hash) const
+    {
+        return fmt::format("{}{:016x}", m_prefix, hash);
+    }
+
+    // evict the least recently used images until `size` more bytes fit the budget
+    bool SharedCache::make_room(std::size_t size)
+    {
+        auto slots = std::span{ m_index->slots, m_index->slot_count };
+
+        for (auto attempt = 0uz; attempt < slots.size(); ++attempt) {
+            auto used   = 0uz;
+            auto oldest = slots.end();
+
+            for (auto it = slots.begin(); it != slots.end(); ++it) {
+                auto hash = it->hash.load(Ord::acquire);
+                auto time = it->last_used.load(Ord::relaxed);
+
+                if (hash == slot_reserved and now() - time > to_ticks(reserve_timeout)) {
+                    auto expected = slot_reserved;
+                    it->hash.compare_exchange_strong(expected, slot_empty, Ord::acq_rel);
+                } else if (hash > slot_reserved) {
+                    used += it->size.load(Ord::relaxed);
+                    if (oldest == slots.end() or time < oldest->last_used.load(Ord::relaxed)) {
+                        oldest = it;
+                    }
+                }
+            }
+
+            if (used + size <= m_budget) {
+                return true;
+            } else if (oldest == slots.end()) {
+                return false;
+            }
+
+            // whoever wins the exchange owns the unlink; mappings held by readers stay valid
+            auto hash = oldest->hash.load(Ord::acquire);
+            if (hash > slot_reserved and oldest->hash.compare_exchange_strong(hash, slot_empty, Ord::acq_rel)) {
+                spdlog::debug("Shared cache evict: {:016x}", hash);
+                ::shm_unlink(object_name(hash).c_str());
+            }
+        }
+
+        return false;
+    }
+
+    // objects not referenced by any slot were left by a process that died between creating and publishing them
+    void SharedCache::collect_orphans()
+    {
+        const auto dir = fs::path{ "/dev/shm" };
+        if (not fs::is_directory(dir)) {
+            return;
+        }
+
+        auto slots  = std::span{ m_index->slots, m_index->slot_count };
+        auto prefix = m_prefix.substr(1);
+        auto ec     = std::error_code{};
+
+        for (const auto& entry : fs::directory_iterator{ dir, ec }) {
+            auto name = entry.path().filename().string();
+            if (not name.starts_with(prefix) or name.size() != prefix.size() + 16) {
+                continue;
+            }
+
+            auto hash = std::uint64_t{};
+            auto hex  = std::string_view{ name }.substr(prefix.size());
+            if (std::from_chars(hex.begin(), hex.end(), hash, 16).ec != std::errc{}) {
+                continue;
+            }
+
+            auto indexed = sr::any_of(slots, [&](const Slot& slot) {
+                auto value = slot.hash.load(Ord::acquire);
+                return value == hash or value == slot_reserved;
+            });
+
+            auto age = fs::file_time_type::clock::now() - entry.last_write_time(ec);
+            if (not indexed and age > reserve_timeout) {
+                spdlog::debug("Shared cache orphan: {}", name);
+                ::shm_unlink(('/' + name).c_str());
+            }
+        }
+    }
+}
+
+#else
+
+namespace qoiview
+{
+    SharedCache::SharedCache(std::size_t budget)
+        : m_budget{ budget }
+    {
+        throw std::runtime_error{ "Shared cache is not supported on this platform" };
+    }
+
+    SharedCache::~SharedCache() = default;
+
+    std::shared_ptr<const Image> SharedCache::find(const DecodedCache::Key&)
+    {
+        return nullptr;
+    }
+
+    void SharedCache::publish(const DecodedCache::Key&, const Image&) { }
+}
+
+#endif
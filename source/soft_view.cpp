@@ -0,0 +1,500 @@
+#include "qoiview/soft_view.hpp"
+
+#include <spdlog/spdlog.h>
+
+#define GLFW_EXPOSE_NATIVE_X11
+#include <GLFW/glfw3native.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <cmath>
+
+namespace
+{
+    using qoiview::raster::Rect;
+
+    Rect merge(Rect a, Rect b)
+    {
+        if (a.empty()) {
+            return b;
+        } else if (b.empty()) {
+            return a;
+        }
+
+        auto x0 = std::min(a.x, b.x);
+        auto y0 = std::min(a.y, b.y);
+        auto x1 = std::max(a.x + a.width, b.x + b.width);
+        auto y1 = std::max(a.y + a.height, b.y + b.height);
+
+        return { x0, y0, x1 - x0, y1 - y0 };
+    }
+
+    // set by the error handler installed around XShmAttach
+    auto shm_error = false;
+
+    int catch_shm_error(Display*, XErrorEvent*)
+    {
+        shm_error = true;
+        return 0;
+    }
+}
+
+namespace qoiview
+{
+    // XImage backed by MIT-SHM when the server supports it (local display), by client memory otherwise
+    struct SoftView::Surface
+    {
+        Surface(GLFWwindow* window)
+            : display{ glfwGetX11Display() }
+            , drawable{ glfwGetX11Window(window) }
+        {
+            auto screen = DefaultScreen(display);
+
+            visual = DefaultVisual(display, screen);
+            depth  = DefaultDepth(display, screen);
+            gc     = XCreateGC(display, drawable, 0, nullptr);
+            shm    = XShmQueryExtension(display) == True;
+
+            if (depth != 24 or visual->red_mask != 0xff0000 or visual->blue_mask != 0x0000ff) {
+                spdlog::warn("Unexpected X11 visual (depth {}), colors may be wrong", depth);
+            }
+            spdlog::info("Software presenter: X11 {}", shm ? "MIT-SHM" : "XPutImage");
+        }
+
+        ~Surface()
+        {
+            release();
+            XFreeGC(display, gc);
+        }
+
+        void resize(int w, int h)
+        {
+            release();
+
+            width  = std::max(w, 1);
+            height = std::max(h, 1);
+
+            if (shm and not create_shm()) {
+                spdlog::warn("MIT-SHM is not usable on this display, falling back to XPutImage");
+                shm = false;
+            }
+
+            if (not shm) {
+                image = XCreateImage(
+                    display, visual, static_cast<unsigned>(depth), ZPixmap, 0, nullptr, width, height, 32, 0
+                );
+                image->data = static_cast<char*>(std::malloc(
+                    static_cast<std::size_t>(image->bytes_per_line) * static_cast<std::size_t>(height)
+                ));
+            }
+        }
+
+        // false with nothing left allocated if the segment can't be created or the server can't attach it
+        bool create_shm()
+        {
+            image = XShmCreateImage(
+                display, visual, static_cast<unsigned>(depth), ZPixmap, nullptr, &info, width, height
+            );
+            if (image == nullptr) {
+                return false;
+            }
+
+            auto bytes = static_cast<std::size_t>(image->bytes_per_line) * static_cast<std::size_t>(height);
+
+            info.shmid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0600);
+            if (info.shmid < 0) {
+                XDestroyImage(image);
+                image = nullptr;
+                return false;
+            }
+
+            auto* addr = shmat(info.shmid, nullptr, 0);
+            if (addr == reinterpret_cast<void*>(-1)) {
+                shmctl(info.shmid, IPC_RMID, nullptr);
+                XDestroyImage(image);
+                image = nullptr;
+                return false;
+            }
+
+            info.shmaddr  = image->data = static_cast<char*>(addr);
+            info.readOnly = False;
+
+            // a remote server reports the failed attach as an X error, not through the return value
+            shm_error     = false;
+            auto previous = XSetErrorHandler(catch_shm_error);
+            auto attached = XShmAttach(display, &info);
+            XSync(display, False);
+            XSetErrorHandler(previous);
+
+            // the segment goes away as soon as both sides detach
+            shmctl(info.shmid, IPC_RMID, nullptr);
+
+            if (not attached or shm_error) {
+                XDestroyImage(image);
+                shmdt(addr);
+                image = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+        void release()
+        {
+            if (image == nullptr) {
+                return;
+            }
+
+            if (shm) {
+                XShmDetach(display, &info);
+                XDestroyImage(image);
+                shmdt(info.shmaddr);
+            } else {
+                XDestroyImage(image);    // frees data as well
+            }
+            image = nullptr;
+        }
+
+        raster::Target target()
+        {
+            auto stride = image->bytes_per_line / 4;
+            auto size   = static_cast<std::size_t>(stride) * static_cast<std::size_t>(height);
+            auto pixels = std::span{ reinterpret_cast<std::uint32_t*>(image->data), size };
+
+            return { .pixels = pixels, .width = width, .height = height, .stride = stride };
+        }
+
+        void present(Rect rect)
+        {
+            auto [x, y, w, h] = rect;
+            auto uw           = static_cast<unsigned>(w);
+            auto uh           = static_cast<unsigned>(h);
+
+            if (shm) {
+                XShmPutImage(display, drawable, gc, image, x, y, x, y, uw, uh, False);
+            } else {
+                XPutImage(display, drawable, gc, image, x, y, x, y, uw, uh);
+            }
+
+            // the server reads the shared buffer asynchronously, it must be done before the next draw
+            XSync(display, False);
+        }
+
+        Display*        display;
+        Window          drawable;
+        Visual*         visual;
+        int             depth;
+        GC              gc;
+        bool            shm;
+        XShmSegmentInfo info  = {};
+        XImage*         image = nullptr;
+        int             width  = 0;
+        int             height = 0;
+    };
+
+    SoftView::SoftView(GLFWwindow* window, std::deque<fs::path> files, std::size_t start, DecodedCache* cache)
+        : m_window{ window }
+        , m_files{ std::move(files) }
+        , m_index{ start }
+        , m_surface{ std::make_unique<Surface>(window) }
+    {
+        m_decoder.set_cache(cache);
+        m_decoder.launch();
+
+        glfwSetWindowUserPointer(m_window, this);
+
+        glfwSetFramebufferSizeCallback(window, callback_framebuffer_size);
+        glfwSetWindowRefreshCallback(window, callback_refresh);
+        glfwSetKeyCallback(window, callback_key);
+        glfwSetCursorPosCallback(window, callback_cursor);
+        glfwSetMouseButtonCallback(window, callback_mouse_button);
+        glfwSetScrollCallback(window, callback_scroll);
+    }
+
+    SoftView::~SoftView() = default;
+
+    void SoftView::callback_framebuffer_size(GLFWwindow* window, int width, int height)
+    {
+        auto& view = *static_cast<SoftView*>(glfwGetWindowUserPointer(window));
+        view.m_surface->resize(width, height);
+        view.update_aspect(width, height);
+    }
+
+    void SoftView::callback_refresh(GLFWwindow* window)
+    {
+        auto& view    = *static_cast<SoftView*>(glfwGetWindowUserPointer(window));
+        view.m_damage = { 0, 0, view.m_surface->width, view.m_surface->height };
+    }
+
+    void SoftView::callback_key(GLFWwindow* window, int key, int, int action, int mods)
+    {
+        auto& view = *static_cast<SoftView*>(glfwGetWindowUserPointer(window));
+        if (action == GLFW_RELEASE) {
+            return;
+        }
+
+        switch (key) {
+        case GLFW_KEY_ESCAPE:
+        case GLFW_KEY_Q: glfwSetWindowShouldClose(window, GLFW_TRUE); break;
+        case GLFW_KEY_H: view.update_offset({ -0.1f, 0.0f }); break;
+        case GLFW_KEY_L: view.update_offset({ 0.1f, 0.0f }); break;
+        case GLFW_KEY_J: view.update_offset({ 0.0f, -0.1f }); break;
+        case GLFW_KEY_K: view.update_offset({ 0.0f, 0.1f }); break;
+        case GLFW_KEY_UP:
+        case GLFW_KEY_I: view.update_zoom(true); break;
+        case GLFW_KEY_DOWN:
+        case GLFW_KEY_O: view.update_zoom(false); break;
+        case GLFW_KEY_N: (view.m_bilinear = not view.m_bilinear, view.callback_refresh(window)); break;
+        case GLFW_KEY_R: {
+            view.m_zoom   = 1.0f;
+            view.m_offset = { 0.0f, 0.0f };
+            view.callback_refresh(window);
+            view.m_update_title = true;
+        } break;
+        case GLFW_KEY_P: fmt::println("{}", view.m_files[view.m_index].c_str()); break;
+        case GLFW_KEY_E: view.export_view((mods & GLFW_MOD_SHIFT) == 0); break;
+        case GLFW_KEY_RIGHT: view.file_step(1); break;
+        case GLFW_KEY_LEFT: view.file_step(-1); break;
+        }
+    }
+
+    void SoftView::callback_cursor(GLFWwindow* window, double xpos, double ypos)
+    {
+        auto& view = *static_cast<SoftView*>(glfwGetWindowUserPointer(window));
+
+        auto x = static_cast<float>(xpos);
+        auto y = static_cast<float>(ypos);
+
+        if (view.m_mouse_press) {
+            int width, height;
+            glfwGetWindowSize(window, &width, &height);
+
+            auto dx = (x - view.m_mouse.x) / static_cast<float>(width);
+            auto dy = (view.m_mouse.y - y) / static_cast<float>(height);
+            view.increment_offset({ dx, dy });
+        }
+
+        view.m_mouse = { x, y };
+    }
+
+    void SoftView::callback_mouse_button(GLFWwindow* window, int button, int action, int)
+    {
+        auto& view = *static_cast<SoftView*>(glfwGetWindowUserPointer(window));
+        if (button == GLFW_MOUSE_BUTTON_LEFT) {
+            view.m_mouse_press = action == GLFW_PRESS;
+        }
+    }
+
+    void SoftView::callback_scroll(GLFWwindow* window, double, double yoffset)
+    {
+        auto& view = *static_cast<SoftView*>(glfwGetWindowUserPointer(window));
+        view.update_zoom(yoffset > 0);
+    }
+
+    void SoftView::run(int width, int height, Color background)
+    {
+        m_background = background;
+        m_surface->resize(width, height);
+        update_aspect(width, height);
+
+        while (not glfwWindowShouldClose(m_window)) {
+            if (std::exchange(m_update_image, false)) {
+                prepare_image();
+            }
+
+            process_events();
+
+            if (std::exchange(m_update_title, false)) {
+                update_title();
+            }
+
+            redraw();
+
+            // nothing changes on screen without input unless rows are still arriving
+            if (m_decoding) {
+                glfwWaitEventsTimeout(1.0 / 60.0);
+            } else {
+                glfwWaitEvents();
+            }
+        }
+
+        m_decoder.stop();
+    }
+
+    void SoftView::update_aspect(int width, int height)
+    {
+        auto image_ratio  = static_cast<float>(m_source.width) / static_cast<float>(m_source.height);
+        auto window_ratio = static_cast<float>(width) / static_cast<float>(height);
+
+        if (m_source.height == 0) {
+            m_aspect = { 1.0f, 1.0f };
+        } else if (image_ratio > window_ratio) {
+            m_aspect = { 1.0f, window_ratio / image_ratio };
+        } else {
+            m_aspect = { image_ratio / window_ratio, 1.0f };
+        }
+
+        m_damage       = { 0, 0, width, height };
+        m_update_title = true;
+    }
+
+    void SoftView::update_zoom(bool in)
+    {
+        m_zoom = std::clamp(in ? m_zoom * 1.1f : m_zoom / 1.1f, 1e-3f, 1e3f);
+
+        m_damage       = { 0, 0, m_surface->width, m_surface->height };
+        m_update_title = true;
+    }
+
+    void SoftView::update_offset(Vec2<> delta)
+    {
+        m_offset.x += delta.x / m_zoom;
+        m_offset.y += delta.y / m_zoom;
+        m_damage    = { 0, 0, m_surface->width, m_surface->height };
+    }
+
+    void SoftView::increment_offset(Vec2<> offset)
+    {
+        m_offset.x -= offset.x / m_aspect.x / m_zoom * 2.0f;
+        m_offset.y -= offset.y / m_aspect.y / m_zoom * 2.0f;
+        m_damage    = { 0, 0, m_surface->width, m_surface->height };
+    }
+
+    void SoftView::file_step(int step)
+    {
+        if (m_files.size() <= 1) {
+            return;
+        }
+
+        auto size = static_cast<std::ptrdiff_t>(m_files.size());
+        m_index   = static_cast<std::size_t>((static_cast<std::ptrdiff_t>(m_index) + step + size) % size);
+
+        m_update_image = true;
+        m_update_title = true;
+    }
+
+    void SoftView::update_title()
+    {
+        auto title = fmt::format(
+            "[{}/{}] [{}x{}] [{:.2f}%] QoiView - {} [software|filter:{}]",
+            m_index + 1,
+            m_files.size(),
+            m_source.width,
+            m_source.height,
+            m_zoom * m_aspect.x * static_cast<float>(m_surface->width) / static_cast<float>(m_source.width) * 100.0f,
+            m_files[m_index].filename().c_str(),
+            m_bilinear ? "linear" : "nearest"
+        );
+        glfwSetWindowTitle(m_window, title.c_str());
+    }
+
+    void SoftView::prepare_image()
+    {
+        const auto& file = m_files[m_index];
+
+        auto prep = m_decoder.prepare(file);
+        if (not prep) {
+            spdlog::info("Failed to decode file {:?}: {}", file.c_str(), to_string(prep.error()));
+            return;
+        }
+
+        // the decoder fills this buffer progressively and keeps it alive until the next prepare
+        m_image_id = prep->id;
+        m_source   = {
+              .pixels = prep->buffer,
+              .width  = static_cast<int>(prep->desc.width),
+              .height = static_cast<int>(prep->desc.height),
+        };
+        m_decoding = true;
+        m_decoded  = false;
+
+        update_aspect(m_surface->width, m_surface->height);
+        m_decoder.start();
+    }
+
+    void SoftView::process_events()
+    {
+        while (auto event = m_decoder.poll()) {
+            if (event->id != m_image_id) {
+                continue;
+            }
+
+            auto handler = Overload{
+                [&](const AsyncDecoder::Prepared&) { },
+                [&](const AsyncDecoder::Band& band) {
+                    m_damage = merge(m_damage, rows_to_screen(band.start, band.start + band.count));
+                },
+                [&](const AsyncDecoder::Finished&) {
+                    m_decoding = false;
+                    m_decoded  = true;
+                },
+                [&](const AsyncDecoder::Failed&) { m_decoding = false; },
+            };
+            std::visit(handler, event->payload);
+        }
+    }
+
+    void SoftView::redraw()
+    {
+        auto damage = std::exchange(m_damage, {});
+        if (damage.empty()) {
+            return;
+        }
+
+        auto target = m_surface->target();
+        raster::draw(m_pool, m_source, target, damage, mapping(), m_background, m_bilinear);
+
+        damage.width  = std::min(damage.x + damage.width, target.width) - std::max(damage.x, 0);
+        damage.height = std::min(damage.y + damage.height, target.height) - std::max(damage.y, 0);
+        damage.x      = std::max(damage.x, 0);
+        damage.y      = std::max(damage.y, 0);
+
+        if (not damage.empty()) {
+            m_surface->present(damage);
+        }
+    }
+
+    void SoftView::export_view(bool native)
+    {
+        if (not m_decoded) {
+            spdlog::warn("Export ignored: image is not decoded yet");
+            return;
+        } else if (m_exporter.busy()) {
+            spdlog::warn("Export ignored: previous export is still running");
+            return;
+        }
+
+        auto screen = Vec2<int>{ m_surface->width, m_surface->height };
+        auto job = Exporter::viewport(m_decoder.image(), m_files[m_index], screen, mapping(), native, m_bilinear);
+
+        if (not job) {
+            spdlog::warn("Export ignored: image is out of view");
+            return;
+        }
+
+        m_exporter.submit(std::move(job).value());
+    }
+
+    raster::Mapping SoftView::mapping() const
+    {
+        auto screen = Vec2<int>{ m_surface->width, m_surface->height };
+        auto image  = Vec2<int>{ m_source.width, m_source.height };
+
+        return raster::view_mapping(screen, image, m_aspect, m_zoom, m_offset);
+    }
+
+    raster::Rect SoftView::rows_to_screen(std::size_t first, std::size_t last) const
+    {
+        auto map = mapping();
+
+        auto y0 = std::floor((static_cast<double>(first) - map.origin.y) / map.scale.y);
+        auto y1 = std::ceil((static_cast<double>(last) - map.origin.y) / map.scale.y);
+
+        auto top    = static_cast<int>(std::clamp(y0, 0.0, static_cast<double>(m_surface->height)));
+        auto bottom = static_cast<int>(std::clamp(y1, 0.0, static_cast<double>(m_surface->height)));
+
+        return { 0, top, m_surface->width, bottom - top };
+    }
+}
@@ -0,0 +1,102 @@
+#include "qoiview/texture_cache.hpp"
+
+#include <glbinding/gl/gl.h>
+#include <spdlog/spdlog.h>
+
+namespace qoiview
+{
+    TextureCache::~TextureCache()
+    {
+        for (const auto& entry : m_entries) {
+            gl::glDeleteTextures(1, &entry.texture);
+        }
+    }
+
+    const TextureCache::Entry* TextureCache::find(const DecodedCache::Key& key) const
+    {
+        const Entry* found = nullptr;
+        for (const auto& entry : m_entries) {
+            if (entry.key == key and (found == nullptr or entry.exact)) {
+                found = &entry;
+            }
+        }
+        return found;
+    }
+
+    bool TextureCache::contains(const DecodedCache::Key& key, bool exact) const
+    {
+        return sr::any_of(m_entries, [&](const Entry& e) { return e.exact == exact and e.key == key; });
+    }
+
+    void TextureCache::touch(const DecodedCache::Key& key)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            auto next = std::next(it);
+            if (it->key == key) {
+                m_entries.splice(m_entries.begin(), m_entries, it);
+            }
+            it = next;
+        }
+    }
+
+    gl::GLuint TextureCache::pin(const DecodedCache::Key& key)
+    {
+        auto entry = sr::find_if(m_entries, [&](const Entry& e) { return e.exact and e.key == key; });
+        if (entry == m_entries.end()) {
+            return 0;
+        }
+
+        ++entry->pins;
+        return entry->texture;
+    }
+
+    void TextureCache::unpin(gl::GLuint texture)
+    {
+        auto entry = sr::find(m_entries, texture, &Entry::texture);
+        if (entry == m_entries.end() or --entry->pins > 0) {
+            return;
+        }
+
+        // no longer shown, the compressed copy stands in for it from now on
+        if (entry->exact and contains(entry->key, false)) {
+            erase(entry);
+        }
+    }
+
+    void TextureCache::insert(Entry entry)
+    {
+        if (entry.bytes > m_budget) {
+            gl::glDeleteTextures(1, &entry.texture);
+            return;
+        }
+
+        // the exact texture of an image that isn't shown gives way to its compressed copy
+        auto replaced = [&](const Entry& e) {
+            return e.key == entry.key and (e.exact == entry.exact or not entry.exact);
+        };
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            it = replaced(*it) and it->pins == 0 ? erase(it) : std::next(it);
+        }
+
+        // pinned textures stay even over budget, they are evicted once unpinned and something else comes in
+        for (auto it = m_entries.end(); m_used + entry.bytes > m_budget and it != m_entries.begin();) {
+            --it;
+            if (it->pins > 0) {
+                continue;
+            }
+
+            spdlog::debug("Texture evict: {} ({})", it->key.path.c_str(), it->exact ? "exact" : "ETC2");
+            it = erase(it);
+        }
+
+        m_used += entry.bytes;
+        m_entries.push_front(std::move(entry));
+    }
+
+    std::list<TextureCache::Entry>::iterator TextureCache::erase(std::list<Entry>::iterator it)
+    {
+        m_used -= it->bytes;
+        gl::glDeleteTextures(1, &it->texture);
+        return m_entries.erase(it);
+    }
+}
@@ -0,0 +1,107 @@
+#include "qoiview/thread_pool.hpp"
+
+#include <atomic>
+#include <latch>
+
+namespace qoiview
+{
+    ThreadPool::ThreadPool(std::size_t count)
+        : m_count{ count == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : count }
+    {
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        for (auto& worker : m_workers) {
+            worker.request_stop();
+        }
+        m_cv.notify_all();
+
+        // joined here, while the queue and the condition variable they wait on are still alive
+        m_workers.clear();
+    }
+
+    void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t, std::size_t)>& fn)
+    {
+        auto chunks = std::min(count, m_count + 1);
+        if (chunks <= 1) {
+            if (count > 0) {
+                fn(0, count);
+            }
+            return;
+        }
+
+        auto latch = std::latch{ static_cast<std::ptrdiff_t>(chunks - 1) };
+        auto range = [&](std::size_t i) { return std::pair{ count * i / chunks, count * (i + 1) / chunks }; };
+
+        for (auto i = 1uz; i < chunks; ++i) {
+            enqueue([&, i] {
+                auto [begin, end] = range(i);
+                fn(begin, end);
+                latch.count_down();
+            });
+        }
+
+        auto [begin, end] = range(0);
+        fn(begin, end);
+
+        latch.wait();
+    }
+
+    void ThreadPool::for_each(std::size_t count, const std::function<void(std::size_t)>& fn)
+    {
+        auto next = std::atomic<std::size_t>{ 0 };
+        auto pull = [&] {
+            for (auto i = next++; i < count; i = next++) {
+                fn(i);
+            }
+        };
+
+        // the caller pulls too, a worker more than there are items would have nothing to do
+        auto helpers = count > 1 ? std::min(count - 1, m_count) : 0uz;
+        auto latch   = std::latch{ static_cast<std::ptrdiff_t>(helpers) };
+
+        for (auto i = 0uz; i < helpers; ++i) {
+            enqueue([&] {
+                pull();
+                latch.count_down();
+            });
+        }
+
+        pull();
+        latch.wait();
+    }
+
+    void ThreadPool::enqueue(std::move_only_function<void()> job)
+    {
+        // a viewer that never needs the pool doesn't keep a thread per core waiting on it
+        std::call_once(m_started, [this] {
+            m_workers.reserve(m_count);
+            for (auto i = 0uz; i < m_count; ++i) {
+                m_workers.emplace_back([this](std::stop_token token) { work(token); });
+            }
+        });
+
+        {
+            auto lock = std::unique_lock{ m_mutex };
+            m_jobs.push_back(std::move(job));
+        }
+        m_cv.notify_one();
+    }
+
+    void ThreadPool::work(std::stop_token token)
+    {
+        while (true) {
+            auto job = std::move_only_function<void()>{};
+            {
+                auto lock = std::unique_lock{ m_mutex };
+                if (not m_cv.wait(lock, token, [this] { return not m_jobs.empty(); })) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            job();
+        }
+    }
+}
@@ -0,0 +1,340 @@
+#include "qoiview/thumbnail.hpp"
+#include "qoiview/archive.hpp"
+#include "qoiview/pipeline.hpp"
+
+#include <qoipp/simple.hpp>
+#include <qoipp/stream.hpp>
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using qoipp::Byte;
+
+    // rows decoded at a time, the full resolution image is never resident
+    constexpr auto band_rows = 16uz;
+
+    // the file name, prefixed with a hash of the full path when files from different directories share it
+    std::vector<qoiview::fs::path> output_names(std::span<const qoiview::fs::path> files)
+    {
+        auto counts = std::unordered_map<std::string, std::size_t>{};
+        for (const auto& file : files) {
+            ++counts[file.filename().string()];
+        }
+
+        auto names = std::vector<qoiview::fs::path>{};
+        names.reserve(files.size());
+
+        for (const auto& file : files) {
+            auto name = file.filename().string();
+            if (counts[name] > 1) {
+                auto ec   = std::error_code{};
+                auto full = qoiview::fs::absolute(file, ec);
+                auto hash = std::hash<std::string>{}((ec ? file : full).lexically_normal().string());
+                name      = fmt::format("{:08x}-{}", hash & 0xffff'ffff, name);
+            }
+            names.emplace_back(std::move(name));
+        }
+
+        return names;
+    }
+
+    // averaging happens in linear light for sRGB images, otherwise dark/bright edges shift in brightness
+    struct Transfer
+    {
+        std::array<float, 256>  to_linear;
+        std::array<Byte, 4096>  from_linear;
+
+        static const Transfer& get(qoipp::Colorspace colorspace)
+        {
+            static const auto srgb   = make(true);
+            static const auto linear = make(false);
+            return colorspace == qoipp::Colorspace::sRGB ? srgb : linear;
+        }
+
+        Byte encode(float value) const
+        {
+            constexpr auto max_index = static_cast<float>(std::tuple_size_v<decltype(from_linear)> - 1);
+            auto index = static_cast<std::size_t>(std::clamp(value, 0.0f, 1.0f) * max_index + 0.5f);
+            return from_linear[index];
+        }
+
+    private:
+        static Transfer make(bool srgb)
+        {
+            auto transfer = Transfer{};
+
+            for (auto i = 0uz; i < transfer.to_linear.size(); ++i) {
+                auto v = static_cast<double>(i) / 255.0;
+                if (srgb) {
+                    v = v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+                }
+                transfer.to_linear[i] = static_cast<float>(v);
+            }
+
+            for (auto i = 0uz; i < transfer.from_linear.size(); ++i) {
+                auto v = static_cast<double>(i) / static_cast<double>(transfer.from_linear.size() - 1);
+                if (srgb) {
+                    v = v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+                }
+                transfer.from_linear[i] = static_cast<Byte>(std::lround(v * 255.0));
+            }
+
+            return transfer;
+        }
+    };
+
+    // area weights of one axis; every output sample has the same number of taps, padded with zero weights,
+    // so the inner loops have a fixed trip count
+    struct Axis
+    {
+        std::vector<std::size_t> first;
+        std::vector<float>       weights;
+        std::size_t              taps;
+
+        Axis(std::size_t src, std::size_t dst)
+        {
+            auto scale = static_cast<double>(src) / static_cast<double>(dst);
+
+            taps = std::min(static_cast<std::size_t>(std::ceil(scale)) + 1, src);
+            first.resize(dst);
+            weights.resize(dst * taps, 0.0f);
+
+            for (auto i = 0uz; i < dst; ++i) {
+                auto lo = static_cast<double>(i) * scale;
+                auto hi = lo + scale;
+
+                first[i] = std::min(static_cast<std::size_t>(lo), src - taps);
+
+                for (auto k = 0uz; k < taps; ++k) {
+                    auto j       = static_cast<double>(first[i] + k);
+                    auto overlap = std::min(hi, j + 1.0) - std::max(lo, j);
+                    if (overlap > 0.0) {
+                        weights[i * taps + k] = static_cast<float>(overlap / scale);
+                    }
+                }
+            }
+        }
+    };
+
+    // separable box filter with fractional coverage fed a row at a time, premultiplied so transparent pixels don't
+    // bleed into the thumbnail
+    class Downsampler
+    {
+    public:
+        Downsampler(const qoipp::Desc& src, const qoipp::Desc& dst)
+            : m_src{ src }
+            , m_dst{ dst }
+            , m_channels{ static_cast<std::size_t>(src.channels) }
+            , m_transfer{ Transfer::get(src.colorspace) }
+            , m_columns{ src.width, dst.width }
+            , m_scale{ static_cast<double>(src.height) / static_cast<double>(dst.height) }
+            , m_planes(4 * src.width)
+            , m_row(4 * dst.width)
+            , m_output(dst.width * dst.height * m_channels)
+        {
+            for (auto& acc : m_acc) {
+                acc.resize(4 * dst.width, 0.0f);
+            }
+        }
+
+        void push(std::size_t y, qoipp::ByteCSpan pixels)
+        {
+            to_planes(pixels);
+            filter_row();
+
+            // a source row overlaps at most two output rows since the image is never upscaled
+            auto y0 = static_cast<double>(y);
+            auto y1 = y0 + 1.0;
+
+            for (auto o = m_next; o < m_dst.height; ++o) {
+                auto lo = static_cast<double>(o) * m_scale;
+                auto hi = lo + m_scale;
+                if (lo >= y1) {
+                    break;
+                }
+
+                auto  weight = static_cast<float>(std::max(std::min(y1, hi) - std::max(y0, lo), 0.0) / m_scale);
+                auto& acc    = m_acc[o % 2];
+
+                for (auto i = 0uz; i < acc.size(); ++i) {
+                    acc[i] += weight * m_row[i];
+                }
+
+                // tolerance for boundaries like 15 * 6.4 that land a hair past a whole row
+                if (hi <= y1 + 1e-9 or y + 1 == m_src.height) {
+                    emit(o);
+                    m_next = o + 1;
+                }
+            }
+        }
+
+        qoipp::ByteCSpan output() const { return m_output; }
+
+    private:
+        // split into premultiplied linear planes: r, g, b, a each `width` long
+        void to_planes(qoipp::ByteCSpan pixels)
+        {
+            auto width = static_cast<std::size_t>(m_src.width);
+            auto r     = m_planes.data();
+            auto g     = r + width;
+            auto b     = g + width;
+            auto a     = b + width;
+
+            for (auto x = 0uz; x < width; ++x) {
+                auto px    = pixels.subspan(x * m_channels);
+                auto alpha = m_channels == 4 ? static_cast<float>(px[3]) / 255.0f : 1.0f;
+
+                r[x] = m_transfer.to_linear[px[0]] * alpha;
+                g[x] = m_transfer.to_linear[px[1]] * alpha;
+                b[x] = m_transfer.to_linear[px[2]] * alpha;
+                a[x] = alpha;
+            }
+        }
+
+        void filter_row()
+        {
+            auto src_w = static_cast<std::size_t>(m_src.width);
+            auto dst_w = static_cast<std::size_t>(m_dst.width);
+            auto taps  = m_columns.taps;
+
+            for (auto c = 0uz; c < 4; ++c) {
+                const auto* plane = m_planes.data() + c * src_w;
+                auto*       out   = m_row.data() + c * dst_w;
+
+                for (auto x = 0uz; x < dst_w; ++x) {
+                    const auto* in = plane + m_columns.first[x];
+                    const auto* w  = m_columns.weights.data() + x * taps;
+
+                    auto sum = 0.0f;
+                    for (auto k = 0uz; k < taps; ++k) {
+                        sum += w[k] * in[k];
+                    }
+                    out[x] = sum;
+                }
+            }
+        }
+
+        void emit(std::size_t o)
+        {
+            auto  dst_w = static_cast<std::size_t>(m_dst.width);
+            auto& acc   = m_acc[o % 2];
+            auto  out   = std::span{ m_output }.subspan(o * dst_w * m_channels, dst_w * m_channels);
+
+            for (auto x = 0uz; x < dst_w; ++x) {
+                auto alpha = acc[3 * dst_w + x];
+                auto inv   = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+                auto px    = out.subspan(x * m_channels);
+
+                px[0] = m_transfer.encode(acc[x] * inv);
+                px[1] = m_transfer.encode(acc[dst_w + x] * inv);
+                px[2] = m_transfer.encode(acc[2 * dst_w + x] * inv);
+                if (m_channels == 4) {
+                    px[3] = static_cast<Byte>(std::lround(std::clamp(alpha, 0.0f, 1.0f) * 255.0f));
+                }
+            }
+
+            std::ranges::fill(acc, 0.0f);
+        }
+
+        qoipp::Desc     m_src;
+        qoipp::Desc     m_dst;
+        std::size_t     m_channels;
+        const Transfer& m_transfer;
+        Axis            m_columns;
+        double          m_scale;
+        std::size_t     m_next = 0;    // first output row not emitted yet
+
+        std::vector<float>                m_planes;
+        std::vector<float>                m_row;
+        std::array<std::vector<float>, 2> m_acc;
+        qoipp::ByteVec                    m_output;
+    };
+}
+
+namespace qoiview::thumbnail
+{
+    qoipp::Desc fit(const qoipp::Desc& desc, std::uint32_t size)
+    {
+        auto scale = std::min(
+            { 1.0, static_cast<double>(size) / desc.width, static_cast<double>(size) / desc.height }
+        );
+
+        auto width  = std::max(static_cast<std::uint32_t>(std::lround(desc.width * scale)), 1u);
+        auto height = std::max(static_cast<std::uint32_t>(std::lround(desc.height * scale)), 1u);
+
+        return { width, height, desc.channels, desc.colorspace };
+    }
+
+    qoipp::Result<qoipp::ByteVec> make(const fs::path& file, std::uint32_t size)
+    {
+        auto input = archive::Input{};
+        if (auto opened = archive::open_input(input, file); not opened) {
+            return qoipp::make_error<qoipp::ByteVec>(opened.error());
+        }
+
+        const auto& desc = input.desc;
+
+        auto stride      = desc.width * static_cast<std::size_t>(desc.channels);
+        auto band        = qoipp::ByteVec(stride * std::min(band_rows, static_cast<std::size_t>(desc.height)));
+        auto downsampler = Downsampler{ desc, fit(desc, size) };
+
+        auto strips = pipeline::decode_strips(input.decoder, std::move(input.reader), band, stride, desc.height, {});
+        for (auto&& strip : strips) {
+            if (not strip) {
+                return qoipp::make_error<qoipp::ByteVec>(strip.error());
+            }
+
+            for (auto i = 0uz; i < strip->pixels.size() / stride; ++i) {
+                downsampler.push(strip->start + i, strip->pixels.subspan(i * stride, stride));
+            }
+        }
+
+        return qoipp::encode(downsampler.output(), fit(desc, size));
+    }
+
+    Summary generate(ThreadPool& pool, std::span<const fs::path> files, const fs::path& outdir, std::uint32_t size)
+    {
+        auto written = std::atomic<std::size_t>{ 0 };
+        auto failed  = std::atomic<std::size_t>{ 0 };
+        auto names   = output_names(files);
+
+        pool.for_each(files.size(), [&](std::size_t i) {
+            const auto& file = files[i];
+            auto        out  = outdir / names[i];
+
+            if (auto ec = std::error_code{}; fs::equivalent(file, out, ec)) {
+                spdlog::warn("Skipping {:?}: thumbnail would overwrite it", file.c_str());
+                ++failed;
+                return;
+            }
+
+            auto thumbnail = make(file, size);
+            if (not thumbnail) {
+                spdlog::warn("Failed to create thumbnail of {:?}: {}", file.c_str(), to_string(thumbnail.error()));
+                ++failed;
+                return;
+            }
+
+            auto stream = std::ofstream{ out, std::ios::binary | std::ios::trunc };
+            stream.write(reinterpret_cast<const char*>(thumbnail->data()), std::ssize(*thumbnail));
+
+            if (not stream) {
+                spdlog::warn("Failed to write {:?}", out.c_str());
+                ++failed;
+                return;
+            }
+
+            ++written;
+        });
+
+        return { written.load(), failed.load() };
+    }
+}
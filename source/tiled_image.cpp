@@ -0,0 +1,478 @@
+#include "qoiview/tiled_image.hpp"
+
+#include <fmt/format.h>
+#include <qoipp/simple.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__unix__)
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+    using Ord = std::memory_order;
+
+    // rows of the full image decoded at a time, copied into the window of the first level from there
+    constexpr auto band_rows = 16uz;
+
+    // worst case of the QOI encoding of `pixels` RGBA pixels: a tag byte on top of every pixel
+    std::size_t encoded_bound(std::size_t pixels)
+    {
+        return qoipp::constants::header_size + pixels * 5 + qoipp::constants::end_marker_size;
+    }
+
+    // $XDG_CACHE_HOME/qoiview or ~/.cache/qoiview, next to the archive indexes
+    std::optional<qoiview::fs::path> cache_dir()
+    {
+        if (auto* cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr and *cache != '\0') {
+            return qoiview::fs::path{ cache } / "qoiview";
+        } else if (auto* home = std::getenv("HOME"); home != nullptr and *home != '\0') {
+            return qoiview::fs::path{ home } / ".cache" / "qoiview";
+        }
+        return std::nullopt;
+    }
+
+    // rows `a` and `b` of RGBA pixels shrunk to half the width, each output pixel weighted by the alpha of the four
+    // it covers so transparent pixels don't bleed their color; the last column is repeated for an odd width
+    void shrink(qoipp::ByteCSpan a, qoipp::ByteCSpan b, qoipp::ByteSpan out)
+    {
+        const auto width = a.size() / 4;
+
+        for (auto x = 0uz; x < out.size() / 4; ++x) {
+            auto x0 = x * 2 * 4;
+            auto x1 = std::min(x * 2 + 1, width - 1) * 4;
+
+            auto color = std::array<unsigned, 3>{};
+            auto alpha = 0u;
+            for (auto p : { a.subspan(x0, 4), a.subspan(x1, 4), b.subspan(x0, 4), b.subspan(x1, 4) }) {
+                for (auto c = 0uz; c < 3; ++c) {
+                    color[c] += unsigned{ p[c] } * p[3];
+                }
+                alpha += p[3];
+            }
+
+            for (auto c = 0uz; c < 3; ++c) {
+                out[x * 4 + c] = alpha == 0 ? 0 : static_cast<qoipp::Byte>((color[c] + alpha / 2) / alpha);
+            }
+            out[x * 4 + 3] = static_cast<qoipp::Byte>((alpha + 2) / 4);
+        }
+    }
+}
+
+#if defined(__unix__)
+
+namespace qoiview
+{
+    // the cache file, closed once the image and the last load reading from it are gone
+    struct TiledImage::File
+    {
+        int fd = -1;
+
+        ~File()
+        {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        bool write_at(qoipp::ByteCSpan data, std::uint64_t offset) const
+        {
+            while (not data.empty()) {
+                auto count = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+                if (count < 0 and errno == EINTR) {
+                    continue;
+                } else if (count <= 0) {
+                    return false;
+                }
+                data    = data.subspan(static_cast<std::size_t>(count));
+                offset += static_cast<std::uint64_t>(count);
+            }
+            return true;
+        }
+
+        bool read_at(qoipp::ByteSpan data, std::uint64_t offset) const
+        {
+            while (not data.empty()) {
+                auto count = ::pread(fd, data.data(), data.size(), static_cast<off_t>(offset));
+                if (count < 0 and errno == EINTR) {
+                    continue;
+                } else if (count <= 0) {
+                    return false;
+                }
+                data    = data.subspan(static_cast<std::size_t>(count));
+                offset += static_cast<std::uint64_t>(count);
+            }
+            return true;
+        }
+    };
+
+    std::size_t TiledImage::footprint(const qoipp::Desc& desc, std::size_t tile, std::size_t workers)
+    {
+        auto size    = Vec2<std::size_t>{ desc.width, desc.height };
+        auto windows = size.x * 4 * std::min(band_rows, size.y);
+        while (true) {
+            windows += size.x * 4 * (std::min(tile, size.y) + 2);
+            if (size.x <= tile and size.y <= tile) {
+                break;
+            }
+
+            // the rows of a row of tiles shrunk for the next level
+            size     = { (size.x + 1) / 2, (size.y + 1) / 2 };
+            windows += size.x * 4 * std::min(tile / 2, size.y);
+        }
+
+        // parallel_for runs a chunk on the calling thread as well
+        auto pixels  = (tile + 2) * (tile + 2);
+        auto encode  = (workers + 1) * (pixels * 4 + encoded_bound(pixels));
+        auto loading = 2 * workers * (pixels * 4 + encoded_bound(pixels));
+
+        return windows + encode + loading;
+    }
+
+    std::optional<std::size_t> TiledImage::plan(const qoipp::Desc& desc, std::size_t memory, std::size_t workers)
+    {
+        for (auto tile = max_tile_size; tile >= min_tile_size; tile /= 2) {
+            if (footprint(desc, tile, workers) <= memory) {
+                return tile;
+            }
+        }
+        return std::nullopt;
+    }
+
+    TiledImage::TiledImage(ThreadPool& pool, const fs::path& file, std::size_t tile)
+        : m_pool{ pool }
+        , m_path{ file }
+        , m_tile{ tile }
+    {
+        if (auto opened = archive::open_input(m_input, file, qoipp::Channels::RGBA); not opened) {
+            auto msg = fmt::format("Failed to read {:?}: {}", file.c_str(), to_string(opened.error()));
+            throw std::runtime_error{ msg };
+        }
+        m_desc = m_input.desc;
+
+        auto dir = cache_dir();
+        if (not dir) {
+            throw std::runtime_error{ "No cache directory for the tile cache, neither XDG_CACHE_HOME nor HOME is set" };
+        }
+
+        auto ec = std::error_code{};
+        fs::create_directories(*dir, ec);
+
+        auto path = *dir / fmt::format("tiles-{}-{:x}.qoitiles", ::getpid(), reinterpret_cast<std::uintptr_t>(this));
+
+        m_file     = std::make_shared<File>();
+        m_file->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (m_file->fd < 0) {
+            throw std::runtime_error{ fmt::format("Failed to create {:?}: {}", path.c_str(), std::strerror(errno)) };
+        }
+
+        // only the descriptor refers to it from now on, nothing is left behind if the viewer is killed
+        ::unlink(path.c_str());
+
+        auto size  = Vec2<std::size_t>{ m_desc.width, m_desc.height };
+        auto first = 0uz;
+        while (true) {
+            auto tiles = Vec2<std::size_t>{ (size.x + tile - 1) / tile, (size.y + tile - 1) / tile };
+            m_levels.push_back({ .size = size, .tiles = tiles, .first = first });
+            m_windows.emplace_back(size.x * 4 * (std::min(tile, size.y) + 2));
+
+            first += tiles.x * tiles.y;
+            if (tiles.x == 1 and tiles.y == 1) {
+                break;
+            }
+            size = { (size.x + 1) / 2, (size.y + 1) / 2 };
+        }
+
+        m_entries = std::make_unique<Entry[]>(first);
+        m_band.resize(m_desc.width * 4uz * std::min(band_rows, std::size_t{ m_desc.height }));
+        m_filled.resize(m_levels.size());
+        m_emitted.resize(m_levels.size());
+
+        spdlog::info(
+            "Tiling {:?}: {}x{} in {} levels of {}px tiles",
+            file.c_str(),
+            m_desc.width,
+            m_desc.height,
+            m_levels.size(),
+            tile
+        );
+
+        m_thread = std::jthread{ [this](std::stop_token token) { run(token); } };
+    }
+
+    TiledImage::~TiledImage()
+    {
+        m_thread.request_stop();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    Vec2<std::size_t> TiledImage::extent(std::size_t level, std::size_t column, std::size_t row) const
+    {
+        const auto& size = m_levels[level].size;
+        return {
+            .x = std::min(m_tile, size.x - column * m_tile),
+            .y = std::min(m_tile, size.y - row * m_tile),
+        };
+    }
+
+    TiledImage::Padded TiledImage::padded(std::size_t level, std::size_t column, std::size_t row) const
+    {
+        const auto& size = m_levels[level].size;
+
+        auto [width, height] = extent(level, column, row);
+
+        auto left   = column > 0 ? 1uz : 0uz;
+        auto top    = row > 0 ? 1uz : 0uz;
+        auto right  = column * m_tile + width < size.x ? 1uz : 0uz;
+        auto bottom = row * m_tile + height < size.y ? 1uz : 0uz;
+
+        return { .origin = { left, top }, .size = { left + width + right, top + height + bottom } };
+    }
+
+    bool TiledImage::available(std::size_t index) const
+    {
+        return m_entries[index].ready.load(Ord::acquire);
+    }
+
+    std::future<qoipp::Result<qoipp::ByteVec>> TiledImage::load(std::size_t index)
+    {
+        const auto& entry = m_entries[index];
+        if (not entry.ready.load(Ord::acquire)) {
+            auto promise = std::promise<qoipp::Result<qoipp::ByteVec>>{};
+            promise.set_value(qoipp::make_error<qoipp::ByteVec>(qoipp::Error::IoError));
+            return promise.get_future();
+        }
+
+        return m_pool.submit([file = m_file, offset = entry.offset, size = entry.size] {
+            auto bytes = qoipp::ByteVec(size);
+            if (not file->read_at(bytes, offset)) {
+                return qoipp::make_error<qoipp::ByteVec>(qoipp::Error::IoError);
+            }
+            auto image = qoipp::decode(bytes, qoipp::Channels::RGBA);
+            if (not image) {
+                return qoipp::make_error<qoipp::ByteVec>(image.error());
+            }
+            return qoipp::Result<qoipp::ByteVec>{ std::move(image->data) };
+        });
+    }
+
+    void TiledImage::run(std::stop_token token)
+    {
+        const auto height = m_levels.front().size.y;
+        const auto stride = m_levels.front().size.x * 4;
+
+        auto line = 0uz;    // first row not decoded yet
+
+        auto strips = pipeline::decode_strips(m_input.decoder, std::move(m_input.reader), m_band, stride, height, token);
+        for (auto&& strip : strips) {
+            if (not strip) {
+                spdlog::error("Failed to decode {:?}: {}", m_path.c_str(), to_string(strip.error()));
+                break;
+            }
+
+            m_histogram += Histogram::compute(m_pool, strip->pixels, 4);
+            if (not push(0, strip->pixels)) {
+                return;
+            }
+
+            line = strip->start + strip->pixels.size() / stride;
+            m_rows.store(line, Ord::release);
+        }
+
+        m_input.stream.reset();
+        if (token.stop_requested()) {
+            return;
+        }
+
+        // the rows missing from a truncated file are left transparent, the levels below still need them
+        if (line < height) {
+            spdlog::warn("Decode of {:?} ended at row {} of {}", m_path.c_str(), line, height);
+            sr::fill(m_band, 0x00);
+        }
+        while (line < height and not token.stop_requested()) {
+            auto count = std::min(m_band.size() / stride, height - line);
+            if (not push(0, std::span{ m_band }.first(count * stride))) {
+                return;
+            }
+            line += count;
+        }
+
+        spdlog::debug("Tiling complete: {} bytes of tiles for {:?}", m_end.load(), m_path.c_str());
+        m_finished.store(true, Ord::release);
+    }
+
+    bool TiledImage::push(std::size_t level, qoipp::ByteCSpan rows)
+    {
+        const auto& current = m_levels[level];
+        const auto  stride  = current.size.x * 4;
+        auto&       window  = m_windows[level];
+        auto&       filled  = m_filled[level];
+
+        // a row of tiles goes out once the row below it, its bottom border, is in as well
+        auto ready = [&] {
+            auto start = m_emitted[level] * m_tile;
+            return start < filled and (filled > start + m_tile or filled == current.size.y);
+        };
+
+        for (auto y = 0uz; y < rows.size() / stride; ++y) {
+            auto start = m_emitted[level] * m_tile;
+            auto at    = window.begin() + static_cast<std::ptrdiff_t>((filled - start + 1) * stride);
+            std::copy_n(rows.begin() + static_cast<std::ptrdiff_t>(y * stride), stride, at);
+            ++filled;
+
+            while (ready()) {
+                if (not emit(level)) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool TiledImage::emit(std::size_t level)
+    {
+        const auto& current = m_levels[level];
+        const auto  stride  = current.size.x * 4;
+        const auto  row     = m_emitted[level];
+        const auto  start   = row * m_tile;
+        const auto  rows    = std::min(m_tile, current.size.y - start);
+        auto&       window  = m_windows[level];
+
+        // row `y` of the level is at row `y - start + 1` of the window, the one above the tiles at row 0
+        auto failed = std::atomic<bool>{ false };
+
+        m_pool.parallel_for(current.tiles.x, [&](std::size_t begin, std::size_t end) {
+            auto pixels = qoipp::ByteVec{};
+            for (auto column = begin; column < end and not failed.load(Ord::relaxed); ++column) {
+                auto [origin, size] = padded(level, column, row);
+                auto left           = column * m_tile - origin.x;
+
+                pixels.resize(size.x * size.y * 4);
+                for (auto y = 0uz; y < size.y; ++y) {
+                    auto from = window.begin() + static_cast<std::ptrdiff_t>((y + 1 - origin.y) * stride + left * 4);
+                    std::copy_n(from, size.x * 4, pixels.begin() + static_cast<std::ptrdiff_t>(y * size.x * 4));
+                }
+
+                auto desc = qoipp::Desc{
+                    .width      = static_cast<std::uint32_t>(size.x),
+                    .height     = static_cast<std::uint32_t>(size.y),
+                    .channels   = qoipp::Channels::RGBA,
+                    .colorspace = m_desc.colorspace,
+                };
+
+                auto encoded = qoipp::encode(pixels, desc);
+                if (not encoded) {
+                    spdlog::error("Failed to encode a tile of {:?}: {}", m_path.c_str(), to_string(encoded.error()));
+                    failed = true;
+                    return;
+                }
+
+                // every tile gets its own range of the file, the workers never write over each other
+                auto offset = m_end.fetch_add(encoded->size(), Ord::relaxed);
+                if (not m_file->write_at(*encoded, offset)) {
+                    spdlog::error("Failed to write the tile cache: {}", std::strerror(errno));
+                    failed = true;
+                    return;
+                }
+
+                auto& entry  = m_entries[index(level, column, row)];
+                entry.offset = offset;
+                entry.size   = encoded->size();
+                entry.ready.store(true, Ord::release);
+            }
+        });
+
+        if (failed) {
+            return false;
+        }
+
+        ++m_emitted[level];
+        if (level + 1 == m_levels.size()) {
+            return true;
+        }
+
+        // pairs of rows never straddle two rows of tiles, they hold an even number of rows unless it's the last
+        const auto out_stride = m_levels[level + 1].size.x * 4;
+        const auto out_rows   = (rows + 1) / 2;
+        const auto tiles      = std::span{ window }.subspan(stride, rows * stride);
+
+        auto shrunk = qoipp::ByteVec(out_rows * out_stride);
+        m_pool.parallel_for(out_rows, [&](std::size_t begin, std::size_t end) {
+            for (auto y = begin; y < end; ++y) {
+                auto a = tiles.subspan(y * 2 * stride, stride);
+                auto b = y * 2 + 1 < rows ? tiles.subspan((y * 2 + 1) * stride, stride) : a;
+                shrink(a, b, std::span{ shrunk }.subspan(y * out_stride, out_stride));
+            }
+        });
+
+        // the last row of these tiles and the first of the next ones become the top of the window
+        if (m_filled[level] > start + m_tile) {
+            auto from = window.begin() + static_cast<std::ptrdiff_t>(m_tile * stride);
+            std::copy_n(from, 2 * stride, window.begin());
+        }
+
+        return push(level + 1, shrunk);
+    }
+}
+
+#else
+
+namespace qoiview
+{
+    struct TiledImage::File
+    {
+    };
+
+    std::size_t TiledImage::footprint(const qoipp::Desc&, std::size_t, std::size_t)
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    std::optional<std::size_t> TiledImage::plan(const qoipp::Desc&, std::size_t, std::size_t)
+    {
+        return std::nullopt;
+    }
+
+    TiledImage::TiledImage(ThreadPool& pool, const fs::path& file, std::size_t tile)
+        : m_pool{ pool }
+        , m_path{ file }
+        , m_tile{ tile }
+    {
+        throw std::runtime_error{ "Tiled images are not supported on this platform" };
+    }
+
+    TiledImage::~TiledImage() = default;
+
+    Vec2<std::size_t> TiledImage::extent(std::size_t, std::size_t, std::size_t) const
+    {
+        return {};
+    }
+
+    TiledImage::Padded TiledImage::padded(std::size_t, std::size_t, std::size_t) const
+    {
+        return {};
+    }
+
+    bool TiledImage::available(std::size_t) const
+    {
+        return false;
+    }
+
+    std::future<qoipp::Result<qoipp::ByteVec>> TiledImage::load(std::size_t)
+    {
+        return {};
+    }
+}
+
+#endif
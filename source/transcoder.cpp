@@ -0,0 +1,85 @@
+#include "qoiview/transcoder.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+
+namespace qoiview
+{
+    Transcoder::Transcoder(std::size_t workers)
+        : m_pool{ workers > 0 ? workers : std::max(std::thread::hardware_concurrency() / 2, 1u) }
+    {
+        m_thread = std::jthread{ [this](std::stop_token token) { run(token); } };
+    }
+
+    Transcoder::~Transcoder()
+    {
+        m_thread.request_stop();
+        m_cv.notify_one();
+    }
+
+    void Transcoder::submit(DecodedCache::Key key, std::shared_ptr<const Image> image)
+    {
+        {
+            auto lock = std::unique_lock{ m_mutex };
+            if (m_jobs.size() >= max_waiting) {
+                m_jobs.pop_front();
+            }
+            m_jobs.push_back({ std::move(key), std::move(image) });
+        }
+        m_cv.notify_one();
+    }
+
+    std::optional<Transcoder::Done> Transcoder::poll()
+    {
+        auto lock = std::unique_lock{ m_mutex };
+        if (m_done.empty()) {
+            return std::nullopt;
+        }
+
+        auto done = std::move(m_done.front());
+        m_done.pop_front();
+        return done;
+    }
+
+    double Transcoder::throughput() const
+    {
+        auto lock = std::unique_lock{ m_mutex };
+        return m_seconds > 0.0 ? static_cast<double>(m_pixels) / m_seconds : 0.0;
+    }
+
+    void Transcoder::run(std::stop_token token)
+    {
+        while (true) {
+            auto job = Job{};
+            {
+                auto lock = std::unique_lock{ m_mutex };
+                if (not m_cv.wait(lock, token, [this] { return not m_jobs.empty(); })) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            auto start   = std::chrono::steady_clock::now();
+            auto texture = etc2::compress(m_pool, *job.image);
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            auto pixels = std::uint64_t{ job.image->desc.width } * job.image->desc.height;
+            spdlog::info(
+                "Transcoded {:?} to ETC2 {}: {:.1f} MPx/s, PSNR {:.2f} dB, {} KiB -> {} KiB",
+                job.key.path.c_str(),
+                texture.format == etc2::Format::Rgb ? "RGB8" : "RGBA8",
+                static_cast<double>(pixels) / seconds / 1e6,
+                texture.psnr(),
+                job.image->pixels().size() / 1024,
+                texture.blocks.size() / 1024
+            );
+
+            auto lock  = std::unique_lock{ m_mutex };
+            m_pixels  += pixels;
+            m_seconds += seconds;
+            m_done.push_back({ std::move(job.key), std::move(texture), seconds });
+        }
+    }
+}